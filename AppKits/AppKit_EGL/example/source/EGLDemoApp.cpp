@@ -0,0 +1,155 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "EGLDemoApp.H"
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace MinVR;
+
+EGLDemoApp::EGLDemoApp() : MinVR::AbstractMVRApp(), _frameNumber(0)
+{
+}
+
+EGLDemoApp::~EGLDemoApp()
+{
+}
+
+void EGLDemoApp::doUserInputAndPreDrawComputation(const std::vector<MinVR::EventRef> &events, double synchronizedTime)
+{
+	_frameNumber++;
+}
+
+void EGLDemoApp::initializeContextSpecificVars(int threadId, MinVR::WindowRef window)
+{
+	initGL();
+	initLights();
+
+	GLenum err;
+	if((err = glGetError()) != GL_NO_ERROR) {
+		std::cout << "openGL ERROR in initializeContextSpecificVars: "<<err<<std::endl;
+	}
+}
+
+void EGLDemoApp::initGL()
+{
+	glShadeModel(GL_SMOOTH);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_CULL_FACE);
+
+	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+	glEnable(GL_COLOR_MATERIAL);
+
+	glClearColor(0, 0, 0, 0);
+	glClearStencil(0);
+	glClearDepth(1.0f);
+	glDepthFunc(GL_LEQUAL);
+}
+
+void EGLDemoApp::initLights()
+{
+	GLfloat lightKa[] = {.2f, .2f, .2f, 1.0f};
+	GLfloat lightKd[] = {.7f, .7f, .7f, 1.0f};
+	GLfloat lightKs[] = {1, 1, 1, 1};
+	glLightfv(GL_LIGHT0, GL_AMBIENT, lightKa);
+	glLightfv(GL_LIGHT0, GL_DIFFUSE, lightKd);
+	glLightfv(GL_LIGHT0, GL_SPECULAR, lightKs);
+
+	float lightPos[4] = {0.5, 0, 3, 1};
+	glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
+
+	glEnable(GL_LIGHT0);
+}
+
+void EGLDemoApp::postInitialization()
+{
+}
+
+void EGLDemoApp::drawGraphics(int threadId, AbstractCameraRef camera, WindowRef window)
+{
+	static const GLfloat normals[6][3] = {{0,0,1}, {1,0,0}, {0,1,0}, {-1,0,0}, {0,-1,0}, {0,0,-1}};
+	static const GLfloat colors[6][3] = {{1,1,1}, {1,0,0}, {0,1,0}, {0,0,1}, {1,1,0}, {0,1,1}};
+	// Counter clockwise corners of each face, seen from outside the cube
+	static const GLfloat corners[6][4][3] = {
+		{{ 1, 1, 1}, {-1, 1, 1}, {-1,-1, 1}, { 1,-1, 1}},
+		{{ 1, 1, 1}, { 1,-1, 1}, { 1,-1,-1}, { 1, 1,-1}},
+		{{ 1, 1, 1}, { 1, 1,-1}, {-1, 1,-1}, {-1, 1, 1}},
+		{{-1, 1, 1}, {-1, 1,-1}, {-1,-1,-1}, {-1,-1, 1}},
+		{{-1,-1,-1}, { 1,-1,-1}, { 1,-1, 1}, {-1,-1, 1}},
+		{{ 1,-1,-1}, {-1,-1,-1}, {-1, 1,-1}, { 1, 1,-1}}};
+
+	glm::dmat4 translate = glm::translate(glm::dmat4(1.0), glm::dvec3(0.0, 0.0, -5.0));
+	glm::dmat4 rotate1 = glm::rotate(translate, 45.0 + _frameNumber, glm::dvec3(0.0, 1.0, 0.0));
+	camera->setObjectToWorldMatrix(glm::rotate(rotate1, -20.0, glm::dvec3(1.0, 0.0, 0.0)));
+
+	glBegin(GL_QUADS);
+	for (int f = 0; f < 6; f++) {
+		glNormal3fv(normals[f]);
+		glColor3fv(colors[f]);
+		for (int c = 0; c < 4; c++) {
+			glVertex3fv(corners[f][c]);
+		}
+	}
+	glEnd();
+}
+
+FrameChecksum::FrameChecksum() : _numFrames(0), _checksum(0)
+{
+}
+
+void FrameChecksum::frameReadBack(const MinVR::ReadbackFrame &frame)
+{
+	// FNV-1a, seeded with the frame number
+	unsigned int hash = 2166136261u ^ (unsigned int)frame.frameNumber;
+	size_t size = (size_t)frame.width * frame.height * frame.bytesPerPixel;
+	for (size_t i = 0; i < size; i++) {
+		hash = (hash ^ frame.pixels[i]) * 16777619u;
+	}
+
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	_numFrames++;
+	_checksum += hash;
+}
+
+int FrameChecksum::getNumFrames()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _numFrames;
+}
+
+unsigned int FrameChecksum::getChecksum()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _checksum;
+}
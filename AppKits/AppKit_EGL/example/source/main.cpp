@@ -32,15 +32,25 @@
 // SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //========================================================================
 
-#version 130
-#extension GL_EXT_gpu_shader4 : enable
-/* Version 130 is needed for the xor operation */
+#include "AppKit_EGL/MVREngineEGL.H"
+#include "EGLDemoApp.H"
+#include "MVRCore/DataFileUtils.H"
 
-uniform sampler2D rightEyeTexture;
-uniform sampler2D leftEyeTexture;  
-uniform vec2 screenSize;
+// Renders a vrsetup offscreen, e.g. to measure throughput at CAVE resolution:
+//   AppKit_EGL_DemoApp umn-cave -c HeadlessNumFrames=300
+int main(int argc, char** argv)
+{
+	MinVR::DataFileUtils::addFileSearchPath("$(G)/src/MinVR/MVRCore/vrsetup");
 
-void main(void){
-	ivec2 test = step(0.5 , floor(mod(gl_TexCoord[0].xy * screenSize.xy, 2.0));
-	gl_FragColor = mix(texture2D(leftEyeTexture,  gl_TexCoord[0].xy), texture2D(rightEyeTexture, gl_TexCoord[0].xy), test.x^test.y);
-}
\ No newline at end of file
+	MinVR::MVREngineEGL *engine = new MinVR::MVREngineEGL();
+	engine->init(argc, argv);
+
+	std::shared_ptr<FrameChecksum> checksum(new FrameChecksum());
+	engine->setReadbackListener(checksum);
+
+	MinVR::AbstractMVRAppRef app(new EGLDemoApp());
+	engine->runApp(app);
+	delete engine;
+
+	std::cout << "Read back " << checksum->getNumFrames() << " frames, checksum " << std::hex << checksum->getChecksum() << std::dec << std::endl;
+}
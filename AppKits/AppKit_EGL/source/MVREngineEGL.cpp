@@ -0,0 +1,170 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "AppKit_EGL/MVREngineEGL.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/TimeService.H"
+#include <EGL/eglext.h>
+#include <string.h>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+namespace MinVR {
+
+MVREngineEGL::MVREngineEGL() : AbstractMVREngine(), _display(EGL_NO_DISPLAY), _stop(false)
+{
+	// The surfaceless platform needs neither X nor a DRM device. Client extensions are
+	// queried without a display, which returns NULL on EGL implementations older than 1.5.
+	const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	if (clientExtensions != NULL && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != NULL) {
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != NULL) {
+			_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		}
+	}
+	if (_display == EGL_NO_DISPLAY) {
+		_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (_display == EGL_NO_DISPLAY || !eglInitialize(_display, &major, &minor)) {
+		BOOST_ASSERT_MSG(false, "Cannot initialize EGL");
+	}
+	MINVR_LOG_INFO(Logger::core()) << "MVREngineEGL: EGL " << major << "." << minor << " (" << eglQueryString(_display, EGL_VENDOR) << ")";
+}
+
+MVREngineEGL::~MVREngineEGL()
+{
+	// The contexts have to be destroyed before the display is terminated
+	stopAssetStreamers();
+	_windows.clear();
+	eglTerminate(_display);
+}
+
+void MVREngineEGL::runApp(AbstractMVRAppRef app)
+{
+	_app = app;
+
+	setupRenderThreads();
+
+	// Wait for threads to finish being initialized
+	waitForRenderThreadsInitialized();
+
+	_app->postInitialization();
+
+	_frameCount = 0;
+	_stop = false;
+
+	int numFrames = 0;
+	if (_configMap->containsKey("HeadlessNumFrames")) {
+		numFrames = _configMap->get(std::string("HeadlessNumFrames"), 0);
+	}
+	boost::posix_time::ptime start = TimeService::localTime();
+
+	// Counts the frames drawn, which with IdleFrameSkipping are fewer than the calls
+	while (!_stop && (numFrames <= 0 || _frameCount < (unsigned long)numFrames)) {
+		runOneFrameOfApp(app);
+	}
+	unsigned long frame = _frameCount;
+
+	double seconds = (TimeService::localTime() - start).total_microseconds() / 1000000.0;
+
+	// Signal threads to terminate and cleanup
+	_startRenderingMutex.lock();
+	RenderThread::renderingState = RenderThread::RENDERING_TERMINATE;
+	_startRenderingCond.notify_all();
+	_startRenderingMutex.unlock();
+
+	_renderThreads.clear();
+	_renderThreadsStarted = false;
+
+	double pixels = 0.0;
+	for (int i = 0; i < _windows.size(); i++) {
+		pixels += (double)_windows[i]->getWidth() * _windows[i]->getHeight();
+		((WindowEGL*)_windows[i].get())->logReadbackStats();
+	}
+	if (frame > 0 && seconds > 0.0) {
+		MINVR_LOG_INFO(Logger::core()) << "MVREngineEGL: " << frame << " frames of " << _windows.size() << " windows in " << seconds << " s, "
+			<< frame / seconds << " frames/s, " << pixels * frame / seconds / 1000000.0 << " Mpixels/s.";
+	}
+}
+
+void MVREngineEGL::stop()
+{
+	_stop = true;
+}
+
+void MVREngineEGL::setReadbackListener(ReadbackListenerRef listener)
+{
+	for (int i = 0; i < _windows.size(); i++) {
+		((WindowEGL*)_windows[i].get())->setReadbackListener(listener);
+	}
+}
+
+WindowRef MVREngineEGL::createWindow(WindowSettingsRef settings, std::vector<AbstractCameraRef> cameras)
+{
+	int numReadbackBuffers = 3;
+	if (_configMap->containsKey("HeadlessReadbackBuffers")) {
+		numReadbackBuffers = _configMap->get("HeadlessReadbackBuffers", 3);
+	}
+	WindowRef shareWindow = getShareWindow(settings);
+	EGLContext shareContext = shareWindow ? ((WindowEGL*)shareWindow.get())->getContext() : EGL_NO_CONTEXT;
+	WindowRef window(new WindowEGL(_display, numReadbackBuffers, settings, cameras, shareContext));
+	return window;
+}
+
+WindowRef MVREngineEGL::createUploadWindow(WindowRef shareWindow)
+{
+	WindowSettingsRef settings(new WindowSettings(*shareWindow->getSettings()));
+	settings->width = 1;
+	settings->height = 1;
+	settings->stereo = false;
+	settings->msaaSamples = 0;
+	settings->windowTitle = "MinVR upload";
+	settings->viewports.clear();
+	WindowRef window(new WindowEGL(_display, 0, settings, std::vector<AbstractCameraRef>(), ((WindowEGL*)shareWindow.get())->getContext()));
+	return window;
+}
+
+EGLDisplay MVREngineEGL::getDisplay()
+{
+	return _display;
+}
+
+} // end namespace
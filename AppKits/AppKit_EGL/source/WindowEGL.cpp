@@ -0,0 +1,180 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "AppKit_EGL/WindowEGL.H"
+#include "MVRCore/Logger.H"
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+WindowEGL::WindowEGL(EGLDisplay display, int numReadbackBuffers, WindowSettingsRef settings, std::vector<AbstractCameraRef> cameras, EGLContext shareContext) :
+	AbstractWindow(settings, cameras), _display(display), _width(settings->width), _height(settings->height), _frameCount(0),
+	_readbackEnabled(numReadbackBuffers > 0), _readbackRing(numReadbackBuffers > 0 ? numReadbackBuffers : 1)
+{
+	if (settings->stereo && settings->stereoType == WindowSettings::STEREOTYPE_QUADBUFFERED) {
+		MINVR_LOG_WARNING(Logger::core()) << "WindowEGL: pbuffers have no quad buffered stereo, drawing " << settings->windowTitle << " side by side instead.";
+		settings->stereoType = WindowSettings::STEREOTYPE_SIDEBYSIDE;
+	}
+
+	eglBindAPI(EGL_OPENGL_API);
+	EGLConfig config = chooseConfig();
+
+	_context = eglCreateContext(_display, config, shareContext, NULL);
+	BOOST_ASSERT_MSG(_context != EGL_NO_CONTEXT, "Cannot create an EGL OpenGL context");
+
+	EGLint surfaceAttributes[] = {EGL_WIDTH, _width, EGL_HEIGHT, _height, EGL_NONE};
+	_surface = eglCreatePbufferSurface(_display, config, surfaceAttributes);
+	BOOST_ASSERT_MSG(_surface != EGL_NO_SURFACE, "Cannot create an EGL pbuffer surface");
+}
+
+WindowEGL::~WindowEGL()
+{
+	eglDestroySurface(_display, _surface);
+	eglDestroyContext(_display, _context);
+}
+
+EGLConfig WindowEGL::chooseConfig()
+{
+	std::vector<EGLint> attributes;
+	attributes.push_back(EGL_SURFACE_TYPE);		attributes.push_back(EGL_PBUFFER_BIT);
+	attributes.push_back(EGL_RENDERABLE_TYPE);	attributes.push_back(EGL_OPENGL_BIT);
+	attributes.push_back(EGL_RED_SIZE);			attributes.push_back(_settings->rgbBits);
+	attributes.push_back(EGL_GREEN_SIZE);		attributes.push_back(_settings->rgbBits);
+	attributes.push_back(EGL_BLUE_SIZE);		attributes.push_back(_settings->rgbBits);
+	attributes.push_back(EGL_ALPHA_SIZE);		attributes.push_back(_settings->alphaBits);
+	attributes.push_back(EGL_DEPTH_SIZE);		attributes.push_back(_settings->depthBits);
+	attributes.push_back(EGL_STENCIL_SIZE);		attributes.push_back(_settings->stencilBits);
+	if (_settings->msaaSamples > 1) {
+		attributes.push_back(EGL_SAMPLE_BUFFERS);	attributes.push_back(1);
+		attributes.push_back(EGL_SAMPLES);			attributes.push_back(_settings->msaaSamples);
+	}
+	attributes.push_back(EGL_NONE);
+
+	EGLConfig config;
+	EGLint numConfigs = 0;
+	if (!eglChooseConfig(_display, &attributes[0], &config, 1, &numConfigs) || numConfigs < 1) {
+		BOOST_ASSERT_MSG(false, "No EGL config matches the window settings");
+	}
+	return config;
+}
+
+void WindowEGL::pollForInput(std::vector<EventRef> &events)
+{
+}
+
+void WindowEGL::swapBuffers()
+{
+	if (_readbackEnabled) {
+		glReadBuffer(GL_BACK);
+		_readbackRing.readPixels(0, 0, _width, _height, _frameCount);
+	}
+	_frameCount++;
+
+	// Swapping a pbuffer does nothing, so flush to get the frame and the readback fence to the GPU
+	eglSwapBuffers(_display, _surface);
+	glFlush();
+
+	// Software renderers usually finish during the flush, so the frame can go out without waiting for the next one
+	if (_readbackEnabled) {
+		_readbackRing.deliverCompleted();
+	}
+}
+
+void WindowEGL::makeContextCurrent()
+{
+	// The bound API is per thread, so it has to be set on the render thread as well
+	eglBindAPI(EGL_OPENGL_API);
+	if (!eglMakeCurrent(_display, _surface, _surface, _context)) {
+		BOOST_ASSERT_MSG(false, "Cannot make the EGL context current");
+	}
+}
+
+void WindowEGL::releaseContext()
+{
+	eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+
+bool WindowEGL::setSwapInterval(int interval)
+{
+	// EGL has no late swap tearing. Pbuffers ignore the interval, but window surfaces would not.
+	if (interval == WindowSettings::SWAPINTERVAL_ADAPTIVE) {
+		MINVR_LOG_WARNING(Logger::core()) << "WindowEGL: adaptive swap interval is not supported, using 1 for " << _settings->windowTitle << ".";
+		interval = 1;
+	}
+	return eglSwapInterval(_display, interval) == EGL_TRUE;
+}
+
+int WindowEGL::getWidth()
+{
+	return _width;
+}
+
+int WindowEGL::getHeight()
+{
+	return _height;
+}
+
+int WindowEGL::getXPos()
+{
+	return _settings->xPos;
+}
+
+int WindowEGL::getYPos()
+{
+	return _settings->yPos;
+}
+
+EGLContext WindowEGL::getContext()
+{
+	return _context;
+}
+
+void WindowEGL::setReadbackListener(ReadbackListenerRef listener)
+{
+	_readbackRing.setListener(listener);
+}
+
+void WindowEGL::logReadbackStats()
+{
+	if (!_readbackEnabled) {
+		return;
+	}
+	MINVR_LOG_INFO(Logger::core()) << "WindowEGL (" << _settings->windowTitle << "): " << _readbackRing.getNumIssued() << " frames read back through "
+		<< _readbackRing.getNumBuffers() << " buffers, " << _readbackRing.getNumDelivered() << " delivered, "
+		<< _readbackRing.getNumSkipped() << " skipped with every buffer in flight.";
+}
+
+} // end namespace
@@ -8,7 +8,7 @@ GLFWDemoApp::GLFWDemoApp() : MinVR::AbstractMVRApp()
 
 GLFWDemoApp::~GLFWDemoApp()
 {
-	glDeleteBuffersARB(1, _vboId.get());
+	// The cube's buffer belongs to the window's resource cache
 }
 
 void GLFWDemoApp::doUserInputAndPreDrawComputation(const std::vector<MinVR::EventRef> &events, double synchronizedTime)
@@ -21,9 +21,19 @@ void GLFWDemoApp::doUserInputAndPreDrawComputation(const std::vector<MinVR::Even
 void GLFWDemoApp::initializeContextSpecificVars(int threadId, WindowRef window)
 {
 	initGL();
-	initVBO();
 	initLights();
 
+	// Windows in the same ShareGroup use the buffer uploaded by whichever thread got here first
+	SharedResourceCacheRef cache = window->getResourceCache();
+	GLuint vbo = cache->acquire("GLFWDemoApp cube");
+	if (vbo == 0) {
+		vbo = initVBO();
+		cache->publish("GLFWDemoApp cube", SharedResourceCache::RESOURCE_BUFFER, vbo);
+	}
+	_vboIdsMutex.lock();
+	_vboIds[threadId] = vbo;
+	_vboIdsMutex.unlock();
+
 	glClearColor(0.f, 0.3f, 1.f, 1.f);
 
 	GLenum err;
@@ -32,7 +42,7 @@ void GLFWDemoApp::initializeContextSpecificVars(int threadId, WindowRef window)
 	}
 }
 
-void GLFWDemoApp::initVBO()
+GLuint GLFWDemoApp::initVBO()
 {
 	// cube ///////////////////////////////////////////////////////////////////////
 	//    v6----- v5
@@ -110,9 +120,9 @@ void GLFWDemoApp::initVBO()
     // glBufferDataARB with NULL pointer reserves only memory space.
     // Copy actual data with 2 calls of glBufferSubDataARB, one for vertex coords and one for normals.
     // target flag is GL_ARRAY_BUFFER_ARB, and usage flag is GL_STATIC_DRAW_ARB
-	_vboId.reset(new GLuint(0));
-	glGenBuffersARB(1, _vboId.get());
-    glBindBufferARB(GL_ARRAY_BUFFER_ARB, *(_vboId.get()));
+	GLuint vboId = 0;
+	glGenBuffersARB(1, &vboId);
+    glBindBufferARB(GL_ARRAY_BUFFER_ARB, vboId);
     glBufferDataARB(GL_ARRAY_BUFFER_ARB, sizeof(vertices)+sizeof(normals)+sizeof(colors), 0, GL_STATIC_DRAW_ARB);
     glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, 0, sizeof(vertices), vertices);                             // copy vertices starting from 0 offest
     glBufferSubDataARB(GL_ARRAY_BUFFER_ARB, sizeof(vertices), sizeof(normals), normals);                // copy normals after vertices
@@ -122,6 +132,7 @@ void GLFWDemoApp::initVBO()
 	if((err = glGetError()) != GL_NO_ERROR) {
 		std::cout << "GLERROR initVBO: "<<err<<std::endl;
 	}
+	return vboId;
  }
  
 void GLFWDemoApp::initGL()
@@ -184,7 +195,7 @@ void GLFWDemoApp::drawGraphics(int threadId, AbstractCameraRef camera, WindowRef
 		std::cout << "GLERROR: "<<err<<std::endl;
 	}
 
-	glBindBufferARB(GL_ARRAY_BUFFER_ARB, *(_vboId.get()));
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, _vboIds[threadId]);
 
     // enable vertex arrays
     glEnableClientState(GL_NORMAL_ARRAY);
@@ -8,7 +8,6 @@ int main(int argc, char** argv)
 	// directory that differs from the MinVR install directory. Note that the $(G) will be replaced
 	// by an environment variable called G.
 	MinVR::DataFileUtils::addFileSearchPath("$(G)/src/MinVR/MVRCore/vrsetup");
-	MinVR::DataFileUtils::addFileSearchPath("$(G)/src/MinVR/MVRCore/shaders");
 
 	MinVR::AbstractMVREngine *engine = new MinVR::MVREngineGLFW();
 	engine->init(argc, argv);
@@ -46,6 +46,7 @@ MVREngineGLFW::MVREngineGLFW() : AbstractMVREngine()
 
 MVREngineGLFW::~MVREngineGLFW()
 {
+	stopAssetStreamers();
 	glfwTerminate();
 }
 
@@ -56,11 +57,7 @@ void MVREngineGLFW::runApp(AbstractMVRAppRef app)
 	setupRenderThreads();
 
 	// Wait for threads to finish being initialized
-	boost::unique_lock<boost::mutex> threadsInitializedLock(_threadsInitializedMutex);
-	while (RenderThread::numThreadsInitComplete < _windows.size()) {
-		_threadsInitializedCond.wait(threadsInitializedLock);
-	}
-	threadsInitializedLock.unlock();
+	waitForRenderThreadsInitialized();
 
 	_app->postInitialization();
 
@@ -84,11 +81,35 @@ void MVREngineGLFW::runApp(AbstractMVRAppRef app)
 	_startRenderingMutex.unlock();
 
 	_renderThreads.clear();
+	_renderThreadsStarted = false;
+}
+
+void MVREngineGLFW::pollUserInput()
+{
+	glfwPollEvents();
+	AbstractMVREngine::pollUserInput();
 }
 
 WindowRef MVREngineGLFW::createWindow(WindowSettingsRef settings, std::vector<AbstractCameraRef> cameras)
 {
-	WindowRef window(new WindowGLFW(settings, cameras));
+	WindowRef shareWindow = getShareWindow(settings);
+	GLFWwindow* shareWith = shareWindow ? ((WindowGLFW*)shareWindow.get())->getWindowPtr() : NULL;
+	WindowRef window(new WindowGLFW(settings, cameras, shareWith));
+	return window;
+}
+
+WindowRef MVREngineGLFW::createUploadWindow(WindowRef shareWindow)
+{
+	WindowSettingsRef settings(new WindowSettings(*shareWindow->getSettings()));
+	settings->width = 1;
+	settings->height = 1;
+	settings->visible = false;
+	settings->fullScreen = false;
+	settings->stereo = false;
+	settings->msaaSamples = 0;
+	settings->windowTitle = "MinVR upload";
+	settings->viewports.clear();
+	WindowRef window(new WindowGLFW(settings, std::vector<AbstractCameraRef>(), ((WindowGLFW*)shareWindow.get())->getWindowPtr()));
 	return window;
 }
 
@@ -33,6 +33,7 @@
 //========================================================================
 
 #include "AppKit_GLFW/WindowGLFW.H"
+#include "MVRCore/Logger.H"
 
 namespace MinVR {
 
@@ -40,17 +41,25 @@ namespace MinVR {
 
 using namespace std;
 
-std::map<GLFWwindow*, WindowRef> WindowGLFW::pointerToObjectMap(WindowGLFW::initPointerToObjectMap()); 
+bool WindowGLFW::glewInitialized = false;
 
-std::map<GLFWwindow*, WindowRef> WindowGLFW::initPointerToObjectMap()
-{
-	std::map<GLFWwindow*, WindowRef> map;
-	return map;
-}
+// GLFW reports modifiers as the bits SHIFT, CONTROL, ALT and SUPER
+#define NUM_MOD_COMBINATIONS 16
+#define NUM_ACTIONS 3
+
+std::vector<std::string> WindowGLFW::keyEventNames((GLFW_KEY_LAST + 2) * NUM_MOD_COMBINATIONS * NUM_ACTIONS);
+std::vector<std::string> WindowGLFW::keyEventValues;
+std::vector<std::string> WindowGLFW::buttonEventNames((GLFW_MOUSE_BUTTON_LAST + 1) * NUM_MOD_COMBINATIONS * NUM_ACTIONS);
+
+static const std::string mousePointerName("mouse_pointer");
+static const std::string mouseEnteredName("mouse_pointer_entered");
+static const std::string mouseLeftName("mouse_pointer_left");
+static const std::string mouseScrollName("mouse_scroll");
 
-WindowGLFW::WindowGLFW(WindowSettingsRef settings, std::vector<AbstractCameraRef> cameras) : AbstractWindow(settings, cameras)
+WindowGLFW::WindowGLFW(WindowSettingsRef settings, std::vector<AbstractCameraRef> cameras, GLFWwindow* shareWith) : AbstractWindow(settings, cameras)
 {
 	firstTime = true;
+	_cursorMoved = false;
 
 	initGLEW();
 
@@ -165,17 +174,17 @@ WindowGLFW::WindowGLFW(WindowSettingsRef settings, std::vector<AbstractCameraRef
 				closestDist = curDist;
 			}
 		}
-		_window = glfwCreateWindow(settings->width, settings->height, settings->windowTitle.c_str(), monitors[closestInd], NULL);
+		_window = glfwCreateWindow(settings->width, settings->height, settings->windowTitle.c_str(), monitors[closestInd], shareWith);
 	}
 	else {
-		_window = glfwCreateWindow(settings->width, settings->height, settings->windowTitle.c_str(), NULL, NULL);
+		_window = glfwCreateWindow(settings->width, settings->height, settings->windowTitle.c_str(), NULL, shareWith);
 	}
 	if (!_window) {
 		glfwTerminate();
 		BOOST_ASSERT_MSG(false, "Unable to create new GLFW window");
 	}
 
-	WindowGLFW::pointerToObjectMap.insert(std::pair<GLFWwindow*, WindowRef>(_window, WindowRef(this)));
+	glfwSetWindowUserPointer(_window, this);
 
 	glfwSetWindowPos(_window, settings->xPos, settings->yPos);
 
@@ -198,12 +207,17 @@ WindowGLFW::WindowGLFW(WindowSettingsRef settings, std::vector<AbstractCameraRef
 
 WindowGLFW::~WindowGLFW()
 {
-	WindowGLFW::pointerToObjectMap.erase(WindowGLFW::pointerToObjectMap.find(_window));
+	glfwSetWindowUserPointer(_window, NULL);
 }
 
 
 void WindowGLFW::initGLEW()
 {
+	// Windows are always created from the main thread, so no locking is needed here
+	if (glewInitialized) {
+		return;
+	}
+
 	// Initialize glew
 	// Requires that a context exists and is current before it will work, so we create a temporary one here
 	glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
@@ -217,15 +231,15 @@ void WindowGLFW::initGLEW()
 	}
 	glfwMakeContextCurrent(NULL);
 	glfwDestroyWindow(tempWin);
+	glewInitialized = true;
 }
 
 void WindowGLFW::pollForInput(std::vector<EventRef> &events)
 {
-	for(auto event_it=_currentEvents.begin(); event_it!=_currentEvents.end(); ++event_it) {
-		events.push_back(*event_it);
-	}
+	// MVREngineGLFW calls glfwPollEvents() once per frame before the windows are polled
+	flushCursorMotion();
+	events.insert(events.end(), _currentEvents.begin(), _currentEvents.end());
 	_currentEvents.clear();
-	glfwPollEvents();
 }
 
 void WindowGLFW::swapBuffers()
@@ -253,6 +267,17 @@ void WindowGLFW::releaseContext()
 	glfwMakeContextCurrent(NULL);
 }
 
+bool WindowGLFW::setSwapInterval(int interval)
+{
+	// Negative intervals only tear late frames with EXT_swap_control_tear
+	if (interval == WindowSettings::SWAPINTERVAL_ADAPTIVE && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+		MINVR_LOG_WARNING(Logger::core()) << "WindowGLFW: the driver has no adaptive swap interval, using 1 for " << _settings->windowTitle << ".";
+		interval = 1;
+	}
+	glfwSwapInterval(interval);
+	return true;
+}
+
 int WindowGLFW::getWidth()
 {
 	//TODO: This returns the size of the window, should we be returning the size of the framebuffer instead?
@@ -299,16 +324,25 @@ void WindowGLFW::setPosition(int xPos, int yPos, bool actuallySet)
 	}
 }
 
+WindowGLFW* WindowGLFW::getObject(GLFWwindow* window)
+{
+	return static_cast<WindowGLFW*>(glfwGetWindowUserPointer(window));
+}
+
 void WindowGLFW::window_size_callback(GLFWwindow* window, int width, int height)
 {
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>((WindowGLFW::pointerToObjectMap.find(window))->second.get());
-	obj->setSize(width, height, false);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->setSize(width, height, false);
+	}
 }
 
 void WindowGLFW::window_pos_callback(GLFWwindow* window, int xpos, int ypos)
 {
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>((WindowGLFW::pointerToObjectMap.find(window))->second.get());
-	obj->setPosition(xpos, ypos, false);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->setPosition(xpos, ypos, false);
+	}
 }
 
 GLFWwindow* WindowGLFW::getWindowPtr()
@@ -318,6 +352,8 @@ GLFWwindow* WindowGLFW::getWindowPtr()
 
 void WindowGLFW::appendEvent(EventRef newEvent)
 {
+	// Keep pending motion ahead of the event that followed it
+	flushCursorMotion();
 	_currentEvents.push_back(newEvent);
 }
 
@@ -325,6 +361,21 @@ void WindowGLFW::setCursorPosition(double x, double y)
 {
 	_cursorPosition.x = x;
 	_cursorPosition.y = y;
+
+	if (_settings->mouseMotionHistory) {
+		_currentEvents.push_back(EventRef(new Event(mousePointerName, _cursorPosition, shared_from_this())));
+	}
+	else {
+		_cursorMoved = true;
+	}
+}
+
+void WindowGLFW::flushCursorMotion()
+{
+	if (_cursorMoved) {
+		_cursorMoved = false;
+		_currentEvents.push_back(EventRef(new Event(mousePointerName, _cursorPosition, shared_from_this())));
+	}
 }
 
 glm::dvec2 WindowGLFW::getCursorPosition()
@@ -334,64 +385,100 @@ glm::dvec2 WindowGLFW::getCursorPosition()
 
 void WindowGLFW::mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 {
-	string name = getButtonName(button);
-
-    if (mods) {
-		name = name + "_" + getModsName(mods);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->appendEvent(EventRef(new Event(getButtonEventName(button, mods, action), obj->getCursorPosition(), obj->shared_from_this())));
 	}
-
-    name = name + "_" + getActionName(action);
-
-	WindowRef objRef = (WindowGLFW::pointerToObjectMap.find(window))->second;
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>(objRef.get());
-	EventRef newEvent(new Event(name, obj->getCursorPosition(), objRef));
-	obj->appendEvent(newEvent);
 }
 
 void WindowGLFW::cursor_position_callback(GLFWwindow* window, double x, double y)
 {
-	string name = "mouse_pointer";
-    WindowRef objRef = (WindowGLFW::pointerToObjectMap.find(window))->second;
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>(objRef.get());
-	obj->setCursorPosition(x, y);
-	EventRef newEvent(new Event(name, obj->getCursorPosition(), objRef));
-	obj->appendEvent(newEvent);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->setCursorPosition(x, y);
+	}
 }
 
 void WindowGLFW::cursor_enter_callback(GLFWwindow* window, int entered)
 {
-	string name = "mouse_pointer_" + entered ? "entered" : "left";
-    WindowRef objRef = (WindowGLFW::pointerToObjectMap.find(window))->second;
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>(objRef.get());
-	EventRef newEvent(new Event(name, objRef));
-	obj->appendEvent(newEvent);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->appendEvent(EventRef(new Event(entered ? mouseEnteredName : mouseLeftName, obj->shared_from_this())));
+	}
 }
 
 void WindowGLFW::scroll_callback(GLFWwindow* window, double x, double y)
 {
-	string name = "mouse_scroll";
-	WindowRef objRef = (WindowGLFW::pointerToObjectMap.find(window))->second;
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>(objRef.get());
-	EventRef newEvent(new Event(name, glm::dvec2(x, y), objRef));
-	obj->appendEvent(newEvent);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->appendEvent(EventRef(new Event(mouseScrollName, glm::dvec2(x, y), obj->shared_from_this())));
+	}
 }
 
 void WindowGLFW::key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
-    string name = "kbd_" + getKeyName(key);
-	
-	if (mods) {
-		name = name + "_" + getModsName(mods);
+	WindowGLFW* obj = getObject(window);
+	if (obj) {
+		obj->appendEvent(EventRef(new Event(getKeyEventName(key, mods, action), getKeyEventValue(key, mods), obj->shared_from_this())));
+	}
+}
+
+const std::string& WindowGLFW::getKeyEventName(int key, int mods, int action)
+{
+	static std::string outOfRange;
+	mods &= NUM_MOD_COMBINATIONS - 1;
+	if ((key < GLFW_KEY_UNKNOWN) || (key > GLFW_KEY_LAST) || (action < 0) || (action >= NUM_ACTIONS)) {
+		outOfRange = "kbd__" + getActionName(action);
+		return outOfRange;
+	}
+
+	std::string &name = keyEventNames[((key + 1) * NUM_MOD_COMBINATIONS + mods) * NUM_ACTIONS + action];
+	if (name.empty()) {
+		name = "kbd_" + getKeyName(key);
+		if (mods) {
+			name = name + "_" + getModsName(mods);
+		}
+		name = name + "_" + getActionName(action);
+	}
+	return name;
+}
+
+const std::string& WindowGLFW::getKeyEventValue(int key, int mods)
+{
+	static std::string outOfRange;
+	if ((key < GLFW_KEY_UNKNOWN) || (key > GLFW_KEY_LAST)) {
+		return outOfRange;
 	}
 
-	string value = getKeyValue(key, mods);
+	// Only shift changes the value and most keys have none, so the whole table is built at once
+	if (keyEventValues.empty()) {
+		keyEventValues.resize((GLFW_KEY_LAST + 2) * 2);
+		for (int k = GLFW_KEY_UNKNOWN; k <= GLFW_KEY_LAST; k++) {
+			keyEventValues[(k + 1) * 2] = getKeyValue(k, 0);
+			keyEventValues[(k + 1) * 2 + 1] = getKeyValue(k, GLFW_MOD_SHIFT);
+		}
+	}
+	return keyEventValues[(key + 1) * 2 + ((mods & GLFW_MOD_SHIFT) ? 1 : 0)];
+}
 
-    name = name + "_" + getActionName(action);
+const std::string& WindowGLFW::getButtonEventName(int button, int mods, int action)
+{
+	static std::string outOfRange;
+	mods &= NUM_MOD_COMBINATIONS - 1;
+	if ((button < 0) || (button > GLFW_MOUSE_BUTTON_LAST) || (action < 0) || (action >= NUM_ACTIONS)) {
+		outOfRange = getButtonName(button) + "_" + getActionName(action);
+		return outOfRange;
+	}
 
-	WindowRef objRef = (WindowGLFW::pointerToObjectMap.find(window))->second;
-	WindowGLFW* obj = dynamic_cast<WindowGLFW*>(objRef.get());
-	EventRef newEvent(new Event(name, value, objRef));
-	obj->appendEvent(newEvent);
+	std::string &name = buttonEventNames[(button * NUM_MOD_COMBINATIONS + mods) * NUM_ACTIONS + action];
+	if (name.empty()) {
+		name = getButtonName(button);
+		if (mods) {
+			name = name + "_" + getModsName(mods);
+		}
+		name = name + "_" + getActionName(action);
+	}
+	return name;
 }
 
 string WindowGLFW::getKeyName(int key)
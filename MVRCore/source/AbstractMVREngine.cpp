@@ -36,37 +36,102 @@
 
 #define BOOST_ASSERT_MSG_OSTREAM std::cout
 #include <boost/assert.hpp>
+#include <cmath>
 
 namespace MinVR {
 
+// Milliseconds an idle engine waits on the input reactor between polls of the windows and the other devices
+#define IDLE_POLL_INTERVAL 10
+
+// Returns the value of a key that setups may leave out, or defaultVal without logging a ConfigMap error
+template <class T>
+static T getOptional(ConfigMapRef configMap, const std::string &key, const T &defaultVal)
+{
+	return configMap->containsKey(key) ? configMap->get(key, defaultVal) : defaultVal;
+}
+
 AbstractMVREngine::AbstractMVREngine()
 {
+	_startupProfiler.reset(new StartupProfiler());
+	_renderThreadsStarted = false;
+	_lastFrameStart = -1.0;
+	_lastFramePeriod = 0.0;
+	_syncTimeStart = 0.0;
+	_frameCount = 0;
+	_lastFrameSlack = 0.0;
+	_idleTimeout = 0.0;
 }
 
 AbstractMVREngine::~AbstractMVREngine()
 {
+	if (_mainThreadStats.getNumSamples() > 0) {
+		_mainThreadStats.log("Main");
+	}
+#ifdef USE_VRPN
+	VRPNConnectionRegistry::logStats();
+#endif
+	if (_captureWriters) {
+		_captureWriters->flush();
+		_captureWriters->logStats();
+	}
+	stopAssetStreamers();
+	if (_swapGroups.size() > 1) {
+		for (size_t i = 0; i < _swapGroups.size(); i++) {
+			_swapGroups[i]->logStats();
+		}
+	}
+	if (_jobSystem) {
+		_jobSystem->logStats();
+	}
+	if (_framePacer) {
+		_framePacer->logStats();
+	}
+	if (_idleFrameSkipper) {
+		_idleFrameSkipper->logStats();
+	}
+	if (_latencyTracer) {
+		_latencyTracer->logSummary();
+		std::string latencyFile = getOptional(_configMap, "LatencyTracingFile", std::string());
+		if (!latencyFile.empty()) {
+			_latencyTracer->writeCSV(latencyFile);
+		}
+	}
 }
 
 BOOST_LOG_ATTRIBUTE_KEYWORD(tag_attr, "Tag", std::string)
 
+// Hands Boost.Log records (e.g. from BOOST_LOG_TRIVIAL in apps) to the asynchronous Logger
+class LoggerSinkBackend : public boost::log::sinks::basic_formatted_sink_backend<char, boost::log::sinks::concurrent_feeding>
+{
+public:
+	void consume(const boost::log::record_view &rec, const string_type &message) {
+		static LogChannel &appChannel = Logger::getChannel("Application");
+
+		LogLevel level = LOG_INFO;
+		boost::log::value_ref<boost::log::trivial::severity_level> severity = boost::log::extract<boost::log::trivial::severity_level>("Severity", rec);
+		if (severity) {
+			if (severity.get() >= boost::log::trivial::error) {
+				level = LOG_ERROR;
+			}
+			else if (severity.get() == boost::log::trivial::warning) {
+				level = LOG_WARNING;
+			}
+		}
+
+		boost::log::value_ref<std::string> tag = boost::log::extract<std::string>("Tag", rec);
+		LogChannel &channel = (tag && tag.get() == "MinVR Core") ? Logger::core() : appChannel;
+		MINVR_LOG(channel, level) << message;
+	}
+};
+
 void AbstractMVREngine::initializeLogging()
 {
-    boost::shared_ptr<boost::log::core> core = boost::log::core::get();
-
-    // Create a backend and attach a couple of streams to it
-    boost::shared_ptr<boost::log::sinks::text_ostream_backend> backend = boost::make_shared<boost::log::sinks::text_ostream_backend>();
-    backend->add_stream(boost::shared_ptr< std::ostream >(&std::cout, boost::empty_deleter()));
-    backend->add_stream(boost::shared_ptr< std::ostream >(new std::ofstream("log.txt")));
-
-    // Enable auto-flushing after each log record written
-    backend->auto_flush(true);
-
-    // Wrap it into the frontend and register in the core.
-    // The backend requires synchronization in the frontend.
-    typedef boost::log::sinks::synchronous_sink<boost::log::sinks::text_ostream_backend> sink_t;
-    boost::shared_ptr< sink_t > sink(new sink_t(backend));
-    core->add_sink(sink);
-	boost::log::add_common_attributes();
+	Logger::addStream(boost::shared_ptr<std::ostream>(new std::ofstream("log.txt")));
+
+	boost::shared_ptr<boost::log::core> core = boost::log::core::get();
+	typedef boost::log::sinks::unlocked_sink<LoggerSinkBackend> sink_t;
+	boost::shared_ptr< sink_t > sink(new sink_t());
+	core->add_sink(sink);
 	sink->set_filter
     (
 	boost::log::trivial::severity >= boost::log::trivial::info || (boost::log::expressions::has_attr(tag_attr) && tag_attr == "MinVR Core")
@@ -76,12 +141,12 @@ void AbstractMVREngine::initializeLogging()
 void AbstractMVREngine::init(int argc, char **argv)
 {
 	initializeLogging();
-	_configMap.reset(new ConfigMap(argc, argv, false));
-	ConfigValMap::map = _configMap;
-	
-	_syncTimeStart = boost::posix_time::microsec_clock::local_time();
-	setupWindowsAndViewports();
-	setupInputDevices();
+
+	_startupProfiler->beginPhase("Config parse");
+	ConfigMapRef configMap(new ConfigMap(argc, argv, false));
+	_startupProfiler->endPhase("Config parse");
+
+	init(configMap);
 }
 
 void AbstractMVREngine::init(ConfigMapRef configMap)
@@ -89,9 +154,110 @@ void AbstractMVREngine::init(ConfigMapRef configMap)
 	_configMap = configMap;
 	ConfigValMap::map = _configMap;
 
-	_syncTimeStart = boost::posix_time::microsec_clock::local_time();
+	// Place the main thread first so the windows, devices and their data are allocated on its node.
+	// Input devices are polled on this thread, so this covers input as well.
+	ThreadPlacement(_configMap, "MainThread_").applyToCurrentThread("Main");
+	_mainThreadStats.begin();
+
+	// Compiled stereo shaders are cached here, an empty value disables the on disk cache
+	if (_configMap->containsKey("ShaderCacheDirectory")) {
+		ShaderProgramCache::setCacheDirectory(_configMap->get("ShaderCacheDirectory", ""));
+	}
+
+	if (getOptional(_configMap, "LatencyTracing", false)) {
+		_latencyTracer.reset(new LatencyTracer());
+	}
+
+	RenderThread::nextThreadId = 0;
+	RenderThread::numThreadsInitComplete = 0;
+
+	_syncTimeStart = TimeService::seconds();
+	_displayTimePredictor = DisplayTimePredictor(getOptional(_configMap, "DisplayRefreshRate", 0.0));
+	if (getOptional(_configMap, "FramePacing", false)) {
+		_framePacer.reset(new FramePacer(getOptional(_configMap, "FramePacingMargin", 2.0) / 1000.0));
+	}
+	if (getOptional(_configMap, "IdleFrameSkipping", false)) {
+		_idleFrameSkipper.reset(new IdleFrameSkipper(getOptional(_configMap, "IdleMotionThreshold", 0.001), getOptional(_configMap, "IdleRotationThreshold", 0.1)));
+		_idleTimeout = getOptional(_configMap, "IdleTimeout", 100.0) / 1000.0;
+	}
 	setupWindowsAndViewports();
+
+	_startupProfiler->beginPhase("Input device setup");
 	setupInputDevices();
+	_startupProfiler->endPhase("Input device setup");
+}
+
+CaptureWriterPoolRef AbstractMVREngine::getCaptureWriterPool()
+{
+	boost::mutex::scoped_lock lock(_captureWritersMutex);
+	if (!_captureWriters) {
+		_captureWriters.reset(new CaptureWriterPool(getOptional(_configMap, "CaptureWriterThreads", 2), getOptional(_configMap, "CaptureQueueDepth", 8)));
+	}
+	return _captureWriters;
+}
+
+JobSystemRef AbstractMVREngine::getJobSystem()
+{
+	boost::mutex::scoped_lock lock(_jobSystemMutex);
+	if (_jobSystem) {
+		return _jobSystem;
+	}
+
+	int numWindows = _configMap->get(std::string("NumWindows"), 1);
+	int numWorkers = getOptional(_configMap, "JobWorkerThreads", -1);
+	if (numWorkers < 0) {
+		numWorkers = JobSystem::getDefaultNumWorkers(numWindows + 1);
+	}
+
+	ThreadPlacement placement(_configMap, "JobWorker_");
+	if (placement.isDefault()) {
+		// Keep the workers off the CPUs the main and render threads are pinned to
+		std::vector<bool> reserved(boost::thread::hardware_concurrency(), false);
+		bool anyReserved = false;
+		std::vector<std::string> prefixes;
+		prefixes.push_back("MainThread_");
+		for (int w = 0; w < numWindows; w++) {
+			prefixes.push_back("Window" + intToString(w+1) + "_");
+		}
+		for (size_t i = 0; i < prefixes.size(); i++) {
+			std::vector<int> cpus = ThreadPlacement::parseCPUList(getOptional(_configMap, prefixes[i] + "CPUAffinity", std::string()));
+			for (size_t c = 0; c < cpus.size(); c++) {
+				if (cpus[c] >= 0 && cpus[c] < (int)reserved.size()) {
+					reserved[cpus[c]] = true;
+					anyReserved = true;
+				}
+			}
+		}
+
+		std::string freeCPUs;
+		for (size_t c = 0; c < reserved.size(); c++) {
+			if (!reserved[c]) {
+				freeCPUs += (freeCPUs.empty() ? "" : ",") + intToString((int)c);
+			}
+		}
+		if (anyReserved && !freeCPUs.empty()) {
+			placement = ThreadPlacement(freeCPUs, -1, 0);
+		}
+	}
+
+	_jobSystem.reset(new JobSystem(numWorkers, placement));
+	return _jobSystem;
+}
+
+StartupProfilerRef AbstractMVREngine::getStartupProfiler()
+{
+	return _startupProfiler;
+}
+
+const SampleRing<InputSample>* AbstractMVREngine::getSampleHistory(const std::string &eventName)
+{
+	for (size_t i = 0; i < _inputDevices.size(); i++) {
+		const SampleRing<InputSample>* history = _inputDevices[i]->getSampleHistory(eventName);
+		if (history != nullptr) {
+			return history;
+		}
+	}
+	return nullptr;
 }
 
 void AbstractMVREngine::setupWindowsAndViewports()
@@ -127,6 +293,24 @@ void AbstractMVREngine::setupWindowsAndViewports()
 		wSettings->visible      = _configMap->get(winStr + "Visible", wSettings->visible);
 		wSettings->useGPUAffinity = _configMap->get(winStr + "UseGPUAffinity", wSettings->useGPUAffinity);
 		wSettings->stereo		= _configMap->get(winStr + "Stereo", wSettings->stereo);
+		wSettings->mouseMotionHistory = getOptional(_configMap, winStr + "MouseMotionHistory", wSettings->mouseMotionHistory);
+		wSettings->cpuAffinity  = getOptional(_configMap, winStr + "CPUAffinity", wSettings->cpuAffinity);
+		wSettings->numaNode     = getOptional(_configMap, winStr + "NUMANode", wSettings->numaNode);
+		wSettings->threadPriority = getOptional(_configMap, winStr + "ThreadPriority", wSettings->threadPriority);
+		wSettings->captureSink  = getOptional(_configMap, winStr + "CaptureSink", wSettings->captureSink);
+		wSettings->capturePath  = getOptional(_configMap, winStr + "CapturePath", wSettings->capturePath);
+		wSettings->captureRate  = getOptional(_configMap, winStr + "CaptureRate", wSettings->captureRate);
+		wSettings->captureWidth = getOptional(_configMap, winStr + "CaptureWidth", wSettings->captureWidth);
+		wSettings->captureHeight = getOptional(_configMap, winStr + "CaptureHeight", wSettings->captureHeight);
+		wSettings->captureBuffers = getOptional(_configMap, winStr + "CaptureBuffers", wSettings->captureBuffers);
+		wSettings->shareGroup   = getOptional(_configMap, winStr + "ShareGroup", wSettings->shareGroup);
+		wSettings->swapGroup    = getOptional(_configMap, winStr + "SwapGroup", wSettings->swapGroup);
+		wSettings->headTracked  = getOptional(_configMap, winStr + "HeadTracked", wSettings->headTracked);
+		wSettings->splitWorkers = getOptional(_configMap, winStr + "SplitWorkers", wSettings->splitWorkers);
+		wSettings->splitMode    = getOptional(_configMap, winStr + "SplitMode", wSettings->splitMode);
+		wSettings->reprojection = getOptional(_configMap, winStr + "Reprojection", wSettings->reprojection);
+		wSettings->reprojectionDeadline = getOptional(_configMap, winStr + "ReprojectionDeadline", wSettings->reprojectionDeadline);
+		wSettings->gpuTiming = getOptional(_configMap, winStr + "GPUTiming", wSettings->gpuTiming);
 
 		//wSettings.mouseVisible = _configMap->get(winStr + "MouseVisible", wSettings.mouseVisible);
 
@@ -155,6 +339,22 @@ void AbstractMVREngine::setupWindowsAndViewports()
 			BOOST_ASSERT_MSG(false, ss.str().c_str());
 		}
 
+		std::string swapIntervalStr = getOptional(_configMap, winStr + "SwapInterval", std::string("Default"));
+		if (swapIntervalStr == "Default") {
+			wSettings->swapInterval = WindowSettings::SWAPINTERVAL_DEFAULT;
+		}
+		else if (swapIntervalStr == "Adaptive") {
+			wSettings->swapInterval = WindowSettings::SWAPINTERVAL_ADAPTIVE;
+		}
+		else if (!swapIntervalStr.empty() && swapIntervalStr.find_first_not_of("0123456789") == std::string::npos) {
+			wSettings->swapInterval = stringToInt(swapIntervalStr);
+		}
+		else {
+			std::stringstream ss;
+			ss << "Fatal error: Unrecognized value for " + winStr + "SwapInterval: " + swapIntervalStr;
+			BOOST_ASSERT_MSG(false, ss.str().c_str());
+		}
+
 
 		// Within each window, you can have multiple viewports.  Each viewport will render
 		// with a separate projection matrix, so this is used for drawing left and right eyes
@@ -195,12 +395,17 @@ void AbstractMVREngine::setupWindowsAndViewports()
 			}
 		}
 
+		std::string phaseName = "Window creation (Window" + intToString(w+1) + ")";
+		_startupProfiler->beginPhase(phaseName);
 		WindowRef window = createWindow(wSettings, cameras);
+		_startupProfiler->endPhase(phaseName);
 		_windows.push_back(window);
-	}
 
-	for (int i=0;i<_windows.size();i++) {
-		_windows[i]->updateHeadTrackingForAllViewports(initialHeadFrame);
+		// The render thread replaces the cameras with its own copies, so set them up before it starts
+		window->updateHeadTrackingForAllViewports(initialHeadFrame);
+
+		// Let this window's context initialize while the next one is created
+		startRenderThread(window);
 	}
 }
 
@@ -230,11 +435,15 @@ void AbstractMVREngine::setupInputDevices()
 			else if (type == "InputDeviceSpaceNav") {
 				_inputDevices.push_back(AbstractInputDeviceRef(new InputDeviceSpaceNav(devnames[i], devicesMap)));
 			}
+			else if (type == "InputDeviceSynthetic") {
+				_inputDevices.push_back(AbstractInputDeviceRef(new InputDeviceSynthetic(devnames[i], devicesMap)));
+			}
 			else {
 				std::stringstream ss;
 				ss << "Fatal error: Unrecognized input device type" << type;
 				BOOST_ASSERT_MSG(false, ss.str().c_str());
 			}
+			_inputReactor.addDevice(_inputDevices.back());
 		}
 	}
 }
@@ -243,37 +452,220 @@ void AbstractMVREngine::initializeContextSpecificVars(int threadId, WindowRef wi
 {
 }
 
+WindowRef AbstractMVREngine::getShareWindow(WindowSettingsRef settings)
+{
+	if (settings->shareGroup < 0) {
+		return WindowRef();
+	}
+	for (size_t i = 0; i < _windows.size(); i++) {
+		if (_windows[i]->getSettings()->shareGroup == settings->shareGroup) {
+			return _windows[i];
+		}
+	}
+	return WindowRef();
+}
+
+SharedResourceCacheRef AbstractMVREngine::getResourceCache(int shareGroup)
+{
+	if (shareGroup < 0) {
+		return SharedResourceCacheRef(new SharedResourceCache(-1));
+	}
+	SharedResourceCacheRef &cache = _resourceCaches[shareGroup];
+	if (!cache) {
+		cache.reset(new SharedResourceCache(shareGroup));
+	}
+	return cache;
+}
+
+WindowRef AbstractMVREngine::createUploadWindow(WindowRef shareWindow)
+{
+	return WindowRef();
+}
+
+AssetStreamerRef AbstractMVREngine::getAssetStreamer(WindowRef window)
+{
+	SharedResourceCacheRef cache = window->getResourceCache();
+	std::map<SharedResourceCacheRef, AssetStreamerRef>::iterator it = _assetStreamers.find(cache);
+	if (it != _assetStreamers.end()) {
+		return it->second;
+	}
+
+	AssetStreamerRef streamer;
+	WindowRef uploadWindow = createUploadWindow(window);
+	if (uploadWindow) {
+		int numThreads = getOptional(_configMap, "AssetLoaderThreads", 2);
+		size_t uploadBudget = (size_t)getOptional(_configMap, "AssetUploadBudget", 16777216.0);
+		size_t stagingBytes = (size_t)getOptional(_configMap, "AssetStagingBytes", 33554432.0);
+		streamer.reset(new AssetStreamer(uploadWindow, cache, numThreads, uploadBudget, stagingBytes));
+	}
+	else {
+		MINVR_LOG_WARNING(Logger::core()) << "AssetStreaming is set, but this app kit cannot create upload contexts.";
+	}
+	_assetStreamers[cache] = streamer;
+	return streamer;
+}
+
+void AbstractMVREngine::stopAssetStreamers()
+{
+	for (std::map<SharedResourceCacheRef, AssetStreamerRef>::iterator it = _assetStreamers.begin(); it != _assetStreamers.end(); ++it) {
+		if (it->second) {
+			it->second->stop();
+		}
+	}
+}
+
+void AbstractMVREngine::startRenderThread(WindowRef window)
+{
+	if (!window->getResourceCache()) {
+		window->setResourceCache(getResourceCache(window->getSettings()->shareGroup));
+	}
+	if (!window->getAssetStreamer() && getOptional(_configMap, "AssetStreaming", false)) {
+		window->setAssetStreamer(getAssetStreamer(window));
+	}
+
+	// RenderThreads -1 gives every window a thread, 0 renders them all on the main thread
+	int numThreads = getOptional(_configMap, "RenderThreads", -1);
+	int windowIndex = 0;
+	for (size_t i = 0; i < _renderThreads.size(); i++) {
+		windowIndex += (int)_renderThreads[i]->getWindowRenderers().size();
+	}
+
+	int threadIndex = 0;
+	std::string threadName = "Main";
+	if (numThreads < 0) {
+		threadIndex = windowIndex;
+		threadName = "Window" + intToString(windowIndex+1);
+	}
+	else if (numThreads > 0) {
+		threadIndex = getOptional(_configMap, "Window" + intToString(windowIndex+1) + "_RenderThread", windowIndex % numThreads + 1) - 1;
+		threadName = "RenderThread" + intToString(threadIndex+1);
+	}
+
+	RenderThreadRef thread;
+	for (size_t i = 0; i < _renderThreads.size(); i++) {
+		if (_renderThreads[i]->getIndex() == threadIndex) {
+			thread = _renderThreads[i];
+		}
+	}
+	if (!thread) {
+		thread.reset(new RenderThread(threadIndex, threadName, numThreads == 0, this, &_threadsInitializedMutex, &_threadsInitializedCond, &_startRenderingMutex, &_renderingCompleteMutex, &_startRenderingCond, &_renderingCompleteCond));
+		_renderThreads.push_back(thread);
+	}
+
+	// Hidden windows created here on the main thread draw the frames of split or re-projected windows
+	std::vector<WindowRef> workerWindows;
+	WindowSettingsRef settings = window->getSettings();
+	std::string windowStr = "Window" + intToString(windowIndex+1);
+	int numWorkers = settings->splitWorkers;
+	bool supported = SplitRenderer::isSupported(window);
+	if (settings->reprojection) {
+		if (numWorkers > 0) {
+			MINVR_LOG_WARNING(Logger::core()) << windowStr << "_SplitWorkers is ignored, the window is re-projected.";
+		}
+		numWorkers = 1;
+		supported = ReprojectionRenderer::isSupported(window);
+	}
+	if (numWorkers > 0 && !supported) {
+		MINVR_LOG_WARNING(Logger::core()) << windowStr << " is split or re-projected, but its stereo type or cameras do not allow it.";
+		numWorkers = 0;
+	}
+	for (int i = 0; i < numWorkers; i++) {
+		WindowRef workerWindow = createUploadWindow(window);
+		if (!workerWindow) {
+			MINVR_LOG_WARNING(Logger::core()) << windowStr << " is split or re-projected, but this app kit cannot create worker contexts.";
+			workerWindows.clear();
+			break;
+		}
+		workerWindows.push_back(workerWindow);
+	}
+	thread->addWindow(window, workerWindows);
+}
+
 void AbstractMVREngine::setupRenderThreads()
 {
-	_renderThreads.clear();
+	// Engines that override setupWindowsAndViewports may not have started threads for their windows
+	size_t numAssigned = 0;
+	for (size_t i = 0; i < _renderThreads.size(); i++) {
+		numAssigned += _renderThreads[i]->getWindowRenderers().size();
+	}
+	for(size_t i=numAssigned; i < _windows.size(); i++) {
+		startRenderThread(_windows[i]);
+	}
 
-	RenderThread::numRenderingThreads = _windows.size();
+	RenderThread::numRenderingThreads = _renderThreads.size();
 	RenderThread::renderingState = RenderThread::RENDERING_WAIT;
 	RenderThread::numThreadsReceivedRenderingComplete = 0;
-	RenderThread::numThreadsReceivedStartRendering = 0;
-	RenderThread::nextThreadId = 0;
-	RenderThread::numThreadsInitComplete = 0;
 
-	_swapBarrier = boost::shared_ptr<boost::barrier>(new boost::barrier(RenderThread::numRenderingThreads));
+	// Windows swap together with the other windows of their swap group, the lowest group is the primary one.
+	// The group's barrier waits for each thread that renders any of its windows.
+	std::map<int, int> numWindowsInGroup;
+	std::map<int, int> numThreadsInGroup;
+	for (size_t t = 0; t < _renderThreads.size(); t++) {
+		std::map<int, bool> threadInGroup;
+		const std::vector<WindowRendererRef> &renderers = _renderThreads[t]->getWindowRenderers();
+		for (size_t i = 0; i < renderers.size(); i++) {
+			int id = renderers[i]->getWindow()->getSettings()->swapGroup;
+			numWindowsInGroup[id]++;
+			if (!threadInGroup[id]) {
+				threadInGroup[id] = true;
+				numThreadsInGroup[id]++;
+			}
+		}
+	}
+	std::map<int, SwapGroupRef> groups;
+	_swapGroups.clear();
+	for (std::map<int, int>::iterator it = numWindowsInGroup.begin(); it != numWindowsInGroup.end(); ++it) {
+		double targetRate = getOptional(_configMap, "SwapGroup" + intToString(it->first) + "_TargetRate", 0.0);
+		SwapGroupRef group(new SwapGroup(it->first, it->second, numThreadsInGroup[it->first], targetRate, _swapGroups.empty()));
+		groups[it->first] = group;
+		_swapGroups.push_back(group);
+	}
+	if (_swapGroups.size() > 1 && _swapGroups[0]->getTargetRate() <= 0.0) {
+		MINVR_LOG_WARNING(Logger::core()) << "SwapGroup" << _swapGroups[0]->getId() << " has no TargetRate, so the other swap groups are never skipped to keep it within budget.";
+	}
+	// A configured refresh rate is paced by the slowest swap interval of the primary group
+	int swapInterval = 1;
+	for (size_t t = 0; t < _renderThreads.size(); t++) {
+		const std::vector<WindowRendererRef> &renderers = _renderThreads[t]->getWindowRenderers();
+		for (size_t i = 0; i < renderers.size(); i++) {
+			WindowSettingsRef settings = renderers[i]->getWindow()->getSettings();
+			renderers[i]->setSwapGroup(groups[settings->swapGroup]);
+			if (renderers[i]->getSwapGroup()->isPrimary()) {
+				swapInterval = std::max(swapInterval, settings->swapInterval);
+			}
+		}
+	}
+	_displayTimePredictor.setSwapInterval(swapInterval);
 
-	for(int i=0; i < _windows.size(); i++) {
-		RenderThreadRef thread(new RenderThread(_windows[i], this, _app, _swapBarrier.get(), &_threadsInitializedMutex, &_threadsInitializedCond, &_startRenderingMutex, &_renderingCompleteMutex, &_startRenderingCond, &_renderingCompleteCond));
-		_renderThreads.push_back(thread);
+	if (!_app->getJobSystem()) {
+		_app->setJobSystem(getJobSystem());
+	}
+
+	for(int i=0; i < _renderThreads.size(); i++) {
+		_renderThreads[i]->start(_app);
 	}
+	_renderThreadsStarted = true;
 }
 
-void AbstractMVREngine::runApp(AbstractMVRAppRef app)
+void AbstractMVREngine::waitForRenderThreadsInitialized()
 {
-	_app = app;
-
-	setupRenderThreads();
-	// Wait for threads to finish being initialized
 	boost::unique_lock<boost::mutex> threadsInitializedLock(_threadsInitializedMutex);
 	while (RenderThread::numThreadsInitComplete < _windows.size()) {
 		_threadsInitializedCond.wait(threadsInitializedLock);
 	}
 	threadsInitializedLock.unlock();
 
+	_startupProfiler->logReport();
+}
+
+void AbstractMVREngine::runApp(AbstractMVRAppRef app)
+{
+	_app = app;
+
+	setupRenderThreads();
+	// Wait for threads to finish being initialized
+	waitForRenderThreadsInitialized();
+
 	_app->postInitialization();
 
 	_frameCount = 0;
@@ -287,44 +679,176 @@ void AbstractMVREngine::runApp(AbstractMVRAppRef app)
 void AbstractMVREngine::runOneFrameOfApp(AbstractMVRAppRef app)
 {
 	// It is possible that this is called by itself rather than from runApp(), if so make sure _app is assigned
-	// and that the renderthreads are created.
+	// and that the renderthreads are started.
 	if (_app != app) {
 		_app = app;
 		_frameCount = 0;
 	}
-	if (_renderThreads.size() == 0) {
+	if (!_renderThreadsStarted) {
 		setupRenderThreads();
 		// Wait for threads to finish being initialized
-		boost::unique_lock<boost::mutex> threadsInitializedLock(_threadsInitializedMutex);
-		while (RenderThread::numThreadsInitComplete < _windows.size()) {
-			_threadsInitializedCond.wait(threadsInitializedLock);
-		}
-		threadsInitializedLock.unlock();
+		waitForRenderThreadsInitialized();
 		_app->postInitialization();
 	}
 
+	// Without a change the windows keep showing the last frame
+	if (_idleFrameSkipper && !waitForChange()) {
+		return;
+	}
+
+	// With pacing, sleep so the frame starts as late as it can and still make the next refresh
+	double frameStart = _framePacer ? _framePacer->waitForFrameStart(_displayTimePredictor, _syncTimeStart) : TimeService::seconds() - _syncTimeStart;
+	if (_lastFrameStart >= 0.0) {
+		_lastFramePeriod = frameStart - _lastFrameStart;
+	}
+	_lastFrameStart = frameStart;
+
+	_mainThreadStats.sample();
+	for (std::map<SharedResourceCacheRef, AssetStreamerRef>::iterator it = _assetStreamers.begin(); it != _assetStreamers.end(); ++it) {
+		if (it->second) {
+			it->second->beginFrame();
+		}
+	}
 	pollUserInput();
+	if (_idleFrameSkipper) {
+		_idleFrameSkipper->frameDrawn(_events);
+	}
+	if (_latencyTracer) {
+		_frameTrace = _latencyTracer->beginFrame(_events);
+		_latencyTracer->record(_frameTrace, LatencyTracer::STAGE_POLL);
+	}
 	updateProjectionForHeadTracking();
+	if (_latencyTracer) {
+		_latencyTracer->record(_frameTrace, LatencyTracer::STAGE_CAMERA);
+	}
 
-	boost::posix_time::ptime now = boost::posix_time::microsec_clock::local_time();
-	boost::posix_time::time_duration diff = now - _syncTimeStart;
-	double syncTime = diff.total_seconds();
+	FrameTiming timing = _displayTimePredictor.predict(_frameCount, frameStart);
+	timing.lastFrameSlack = _lastFrameSlack;
+	_app->setFrameTiming(timing);
+	double syncTime = TimeService::seconds() - _syncTimeStart;
 	_app->doUserInputAndPreDrawComputation(_events, syncTime);
+	if (_latencyTracer) {
+		_latencyTracer->record(_frameTrace, LatencyTracer::STAGE_APP);
+	}
 
-	//std::cout << "Notifying rendering threads to start rendering frame: "<<_frameCount++<<std::endl;
-	_startRenderingMutex.lock();
-	RenderThread::renderingState = RenderThread::RENDERING_START;
-	_startRenderingCond.notify_all();
-	_startRenderingMutex.unlock();
+	//std::cout << "Notifying rendering threads to start rendering frame: "<<_frameCount<<std::endl;
+	int numRequested = requestFrames(frameStart);
 
 	// Wait for threads to finish rendering
-	boost::unique_lock<boost::mutex> renderingCompleteLock(_renderingCompleteMutex);
-	while (RenderThread::numThreadsReceivedRenderingComplete < _windows.size()) {
-		_renderingCompleteCond.wait(renderingCompleteLock);
+	if (numRequested > 0) {
+		boost::unique_lock<boost::mutex> renderingCompleteLock(_renderingCompleteMutex);
+		while (RenderThread::numThreadsReceivedRenderingComplete < numRequested) {
+			_renderingCompleteCond.wait(renderingCompleteLock);
+		}
+		//std::cout << "All threads finished rendering"<<std::endl;
+		RenderThread::numThreadsReceivedRenderingComplete = 0;
+		renderingCompleteLock.unlock();
 	}
-	//std::cout << "All threads finished rendering"<<std::endl;
-	RenderThread::numThreadsReceivedRenderingComplete = 0;
-	renderingCompleteLock.unlock();
+
+	// The windows of the primary swap group have swapped by now. The frame's slack is the shortest wait in a swap.
+	double presentTime = TimeService::seconds() - _syncTimeStart;
+	bool first = true;
+	for (size_t t = 0; t < _renderThreads.size(); t++) {
+		const std::vector<WindowRendererRef> &renderers = _renderThreads[t]->getWindowRenderers();
+		for (size_t i = 0; i < renderers.size(); i++) {
+			if (renderers[i]->getSwapGroup()->isPrimary()) {
+				_lastFrameSlack = first ? renderers[i]->getSwapWaitTime() : std::min(_lastFrameSlack, renderers[i]->getSwapWaitTime());
+				first = false;
+			}
+		}
+	}
+	_displayTimePredictor.framePresented(frameStart, presentTime);
+	if (_framePacer) {
+		_framePacer->framePresented(frameStart, presentTime, _lastFrameSlack);
+	}
+	_frameCount++;
+}
+
+bool AbstractMVREngine::waitForChange()
+{
+	double start = TimeService::seconds();
+	bool changed = false;
+	bool waited = false;
+	while (true) {
+		if (_frameCount == 0 || _app->takeRedrawRequest()) {
+			changed = true;
+			break;
+		}
+		pollUserInput();
+		if (_idleFrameSkipper->holdEvents(_events)) {
+			changed = true;
+			break;
+		}
+		double remaining = start + _idleTimeout - TimeService::seconds();
+		if (remaining <= 0.0) {
+			break;
+		}
+		_inputReactor.waitForInput(std::min(IDLE_POLL_INTERVAL, (int)std::ceil(remaining * 1000.0)));
+		waited = true;
+	}
+	_idleFrameSkipper->waited(TimeService::seconds() - start, changed);
+
+	// The time spent idle is not part of the next frame's period
+	if (waited) {
+		_lastFrameStart = -1.0;
+	}
+	return changed;
+}
+
+int AbstractMVREngine::requestFrames(double frameStart)
+{
+	std::vector<bool> renders(_swapGroups.size(), false);
+	for (size_t g = 0; g < _swapGroups.size(); g++) {
+		SwapGroupRef group = _swapGroups[g];
+		if (!group->isDue(frameStart, _lastFramePeriod)) {
+			continue;
+		}
+		if (!group->isPrimary()) {
+			if (_swapGroups[0]->isOverBudget(_lastFramePeriod)) {
+				group->skippedOverBudget();
+				continue;
+			}
+			bool idle = true;
+			for (size_t t = 0; t < _renderThreads.size(); t++) {
+				const std::vector<WindowRendererRef> &renderers = _renderThreads[t]->getWindowRenderers();
+				for (size_t i = 0; i < renderers.size(); i++) {
+					if (renderers[i]->getSwapGroup() == group && !renderers[i]->isIdle()) {
+						idle = false;
+					}
+				}
+			}
+			if (!idle) {
+				group->skippedBusy();
+				continue;
+			}
+		}
+		group->rendered(frameStart);
+		renders[g] = true;
+	}
+
+	// Inline rendering needs no locking, the main thread renders the windows itself
+	bool renderInline = !_renderThreads.empty() && _renderThreads[0]->isInline();
+	int numRequested = 0;
+	if (!renderInline) {
+		_startRenderingMutex.lock();
+	}
+	for (size_t t = 0; t < _renderThreads.size(); t++) {
+		const std::vector<WindowRendererRef> &renderers = _renderThreads[t]->getWindowRenderers();
+		for (size_t i = 0; i < renderers.size(); i++) {
+			size_t g = std::find(_swapGroups.begin(), _swapGroups.end(), renderers[i]->getSwapGroup()) - _swapGroups.begin();
+			if (g < renders.size() && renders[g]) {
+				renderers[i]->requestFrame(_frameTrace);
+				numRequested++;
+			}
+		}
+	}
+	if (renderInline) {
+		_renderThreads[0]->renderInline();
+		return 0;
+	}
+	_startRenderingCond.notify_all();
+	_startRenderingMutex.unlock();
+	return numRequested;
 }
 
 void AbstractMVREngine::pollUserInput()
@@ -333,9 +857,7 @@ void AbstractMVREngine::pollUserInput()
 	for (int i=0;i<_windows.size();i++) {
 		_windows[i]->pollForInput(_events);
 	}
-	for (int i=0;i<_inputDevices.size();i++) { 
-		_inputDevices[i]->pollForInput(_events);
-	}
+	_inputReactor.pollForInput(_events);
 	
 	//TODO: ideally we want to sort the events by time stamp, but this seems to be flipping some tracker events
 	// out of order. Currently we get better results not sorting. Still needs to be debugged
@@ -351,6 +873,9 @@ void AbstractMVREngine::updateProjectionForHeadTracking()
 	}
 	if (i >= 0) {
 		for (int j=0;j<_windows.size();j++) {
+			if (!_windows[j]->getSettings()->headTracked) {
+				continue;
+			}
 			_windows[j]->updateHeadTrackingForAllViewports(_events[i]->getCoordinateFrameData());
 		}
 	}
@@ -54,5 +54,15 @@ void AbstractWindow::updateHeadTrackingForAllViewports(glm::dmat4 headFrame)
 	}
 }
 
+void AbstractWindow::cloneCamerasForCurrentThread()
+{
+	for (int i=0;i<_cameras.size();i++) {
+		AbstractCameraRef camera = _cameras[i]->clone();
+		if (camera) {
+			_cameras[i] = camera;
+		}
+	}
+}
+
 } // end namespace
 
@@ -0,0 +1,631 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/AssetStreamer.H"
+#include "MVRCore/Logger.H"
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <fstream>
+#include <string.h>
+#include <stdio.h>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+// True if the current context has at least the GL version, or the extension
+static bool hasVersionOrExtension(int requiredMajor, int requiredMinor, const char* extension)
+{
+	int major = 0;
+	int minor = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (version != NULL && sscanf(version, "%d.%d", &major, &minor) == 2) {
+		if (major > requiredMajor || (major == requiredMajor && minor >= requiredMinor)) {
+			return true;
+		}
+	}
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	return (extensions != NULL) && (strstr(extensions, extension) != NULL);
+}
+
+const void* AssetStaging::getUnpackPointer() const
+{
+	if (buffer != 0) {
+		return (const void*)offset;
+	}
+	return pointer;
+}
+
+void AssetStaging::copyToBuffer(GLenum target, GLenum usage) const
+{
+	if (buffer != 0) {
+		glBufferData(target, size, NULL, usage);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, target, offset, 0, size);
+	}
+	else {
+		glBufferData(target, size, pointer, usage);
+	}
+}
+
+FileBufferRequest::FileBufferRequest(const std::string &path, GLenum target) : _path(path), _target(target)
+{
+}
+
+bool FileBufferRequest::load(std::vector<unsigned char> &data)
+{
+	std::ifstream file(_path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	std::streamoff size = file.tellg();
+	file.seekg(0, std::ios::beg);
+	data.resize((size_t)size);
+	if (size > 0 && !file.read((char*)&data[0], size)) {
+		return false;
+	}
+	return true;
+}
+
+GLuint FileBufferRequest::upload(const AssetStaging &staging)
+{
+	GLuint name = 0;
+	glGenBuffers(1, &name);
+	glBindBuffer(_target, name);
+	staging.copyToBuffer(_target, GL_STATIC_DRAW);
+	glBindBuffer(_target, 0);
+	return name;
+}
+
+SharedResourceCache::ResourceType FileBufferRequest::getResourceType()
+{
+	return SharedResourceCache::RESOURCE_BUFFER;
+}
+
+AssetHandle::AssetHandle(const std::string &id, AssetRequestRef request, int priority, long sequence) :
+	_id(id), _request(request), _sequence(sequence), _state(STATE_QUEUED), _priority(priority), _cancelled(false), _name(0)
+{
+}
+
+const std::string& AssetHandle::getId()
+{
+	return _id;
+}
+
+AssetHandle::State AssetHandle::getState()
+{
+	return (State)_state.load();
+}
+
+bool AssetHandle::isReady()
+{
+	return _state.load() == STATE_READY;
+}
+
+bool AssetHandle::isDone()
+{
+	int state = _state.load();
+	return state == STATE_READY || state == STATE_FAILED || state == STATE_CANCELLED;
+}
+
+GLuint AssetHandle::getName()
+{
+	return isReady() ? _name.load() : 0;
+}
+
+int AssetHandle::getPriority()
+{
+	return _priority.load();
+}
+
+void AssetHandle::setPriority(int priority)
+{
+	_priority.store(priority);
+}
+
+void AssetHandle::cancel()
+{
+	_cancelled.store(true);
+}
+
+bool AssetHandle::isCancelled()
+{
+	return _cancelled.load();
+}
+
+AssetStreamer::AssetStreamer(WindowRef uploadWindow, SharedResourceCacheRef cache, int numLoaderThreads, size_t uploadBudget, size_t stagingBytes) :
+	_uploadWindow(uploadWindow), _cache(cache), _uploadBudget(uploadBudget), _nextSequence(0), _frameBytes(0), _stopping(false),
+	_stagingMode(STAGING_NONE), _syncSupported(false), _stagingBuffer(0), _stagingBytes(stagingBytes), _stagingHead(0), _stagingMemory(NULL),
+	_numReady(0), _numFailed(0), _numCancelled(0), _bytesUploaded(0), _numFrames(0), _peakFrameBytes(0)
+{
+	for (int i = 0; i < std::max(numLoaderThreads, 1); i++) {
+		_loaderThreads.create_thread(boost::bind(&AssetStreamer::runLoader, this));
+	}
+	_uploadThread.reset(new boost::thread(&AssetStreamer::runUploader, this));
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	stop();
+}
+
+AssetHandleRef AssetStreamer::request(const std::string &id, AssetRequestRef request, int priority)
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	std::map<std::string, AssetHandleRef>::iterator it = _handles.find(id);
+	if (it != _handles.end()) {
+		if (priority > it->second->getPriority()) {
+			it->second->setPriority(priority);
+		}
+		return it->second;
+	}
+
+	AssetHandleRef handle(new AssetHandle(id, request, priority, _nextSequence++));
+	_handles[id] = handle;
+	if (_stopping) {
+		finish(handle, AssetHandle::STATE_CANCELLED);
+		return handle;
+	}
+	_pendingLoads.push_back(handle);
+	_loadCond.notify_one();
+	return handle;
+}
+
+void AssetStreamer::beginFrame()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	_frameBytes = 0;
+	_numFrames++;
+	_uploadCond.notify_all();
+}
+
+size_t AssetStreamer::findHighestPriority(const std::vector<AssetHandleRef> &handles)
+{
+	// Priorities can change while an asset waits, so pick when taking rather than keeping a heap
+	size_t best = 0;
+	for (size_t i = 1; i < handles.size(); i++) {
+		int priority = handles[i]->getPriority();
+		int bestPriority = handles[best]->getPriority();
+		if (priority > bestPriority || (priority == bestPriority && handles[i]->_sequence < handles[best]->_sequence)) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+AssetHandleRef AssetStreamer::takeHighestPriority(std::vector<AssetHandleRef> &handles)
+{
+	size_t best = findHighestPriority(handles);
+	AssetHandleRef handle = handles[best];
+	handles.erase(handles.begin() + best);
+	return handle;
+}
+
+void AssetStreamer::finish(AssetHandleRef handle, AssetHandle::State state)
+{
+	handle->_state.store(state);
+	handle->_request.reset();
+	std::vector<unsigned char>().swap(handle->_data);
+
+	if (state == AssetHandle::STATE_READY) {
+		_numReady++;
+		return;
+	}
+	if (state == AssetHandle::STATE_FAILED) {
+		_numFailed++;
+	}
+	else {
+		_numCancelled++;
+	}
+	// The id can be requested again
+	std::map<std::string, AssetHandleRef>::iterator it = _handles.find(handle->_id);
+	if (it != _handles.end() && it->second == handle) {
+		_handles.erase(it);
+	}
+}
+
+void AssetStreamer::runLoader()
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	while (true) {
+		while (!_stopping && _pendingLoads.empty()) {
+			_loadCond.wait(lock);
+		}
+		if (_stopping) {
+			return;
+		}
+
+		AssetHandleRef handle = takeHighestPriority(_pendingLoads);
+		if (handle->isCancelled()) {
+			finish(handle, AssetHandle::STATE_CANCELLED);
+			continue;
+		}
+		handle->_state.store(AssetHandle::STATE_LOADING);
+		AssetRequestRef request = handle->_request;
+		lock.unlock();
+
+		std::vector<unsigned char> data;
+		bool loaded = request->load(data);
+
+		lock.lock();
+		if (handle->isCancelled()) {
+			finish(handle, AssetHandle::STATE_CANCELLED);
+		}
+		else if (!loaded) {
+			MINVR_LOG_WARNING(Logger::core()) << "AssetStreamer: Cannot load " << handle->_id << ".";
+			finish(handle, AssetHandle::STATE_FAILED);
+		}
+		else {
+			handle->_data.swap(data);
+			handle->_state.store(AssetHandle::STATE_LOADED);
+			_pendingUploads.push_back(handle);
+			_uploadCond.notify_all();
+		}
+	}
+}
+
+void AssetStreamer::runUploader()
+{
+	_uploadWindow->makeContextCurrent();
+	GLExtensions::init();
+	_cache->addContext();
+	initStaging();
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	while (!_stopping) {
+		// An asset must fit in what is left of the frame's budget. One larger than the whole
+		// budget waits for the start of a frame and goes out alone.
+		AssetHandleRef handle;
+		if (!_pendingUploads.empty()) {
+			size_t best = findHighestPriority(_pendingUploads);
+			size_t size = _pendingUploads[best]->_data.size();
+			if (_pendingUploads[best]->isCancelled() || _uploadBudget == 0 || _frameBytes == 0 || _frameBytes + size <= _uploadBudget) {
+				handle = _pendingUploads[best];
+				_pendingUploads.erase(_pendingUploads.begin() + best);
+			}
+		}
+		if (handle) {
+			if (handle->isCancelled()) {
+				finish(handle, AssetHandle::STATE_CANCELLED);
+				continue;
+			}
+			size_t size = handle->_data.size();
+			lock.unlock();
+			uploadAsset(handle);
+			retireUploads(false);
+			lock.lock();
+			_frameBytes += size;
+			_bytesUploaded += size;
+			_peakFrameBytes = std::max(_peakFrameBytes, _frameBytes);
+			continue;
+		}
+
+		if (!_uploads.empty()) {
+			// Poll the fences of the assets still on the GPU
+			lock.unlock();
+			bool retired = retireUploads(false);
+			lock.lock();
+			if (!retired && !_stopping) {
+				_uploadCond.timed_wait(lock, boost::posix_time::milliseconds(1));
+			}
+			continue;
+		}
+
+		_uploadCond.wait(lock);
+	}
+	lock.unlock();
+
+	// Assets already on the GPU are published so the cache deletes them
+	while (!_uploads.empty()) {
+		retireUploads(true);
+	}
+	releaseStaging();
+	_cache->removeContext();
+	_uploadWindow->releaseContext();
+}
+
+void AssetStreamer::initStaging()
+{
+#ifdef _WIN32
+	_syncSupported = pglFenceSync && pglClientWaitSync && pglDeleteSync;
+	bool buffersSupported = pglGenBuffers && pglDeleteBuffers && pglBufferData && pglMapBufferRange && pglUnmapBuffer && pglCopyBufferSubData;
+	bool storageSupported = (pglBufferStorage != NULL);
+#else
+	_syncSupported = true;
+	bool buffersSupported = true;
+	bool storageSupported = true;
+#endif
+	buffersSupported = buffersSupported && hasVersionOrExtension(3, 1, "GL_ARB_copy_buffer");
+	storageSupported = storageSupported && hasVersionOrExtension(4, 4, "GL_ARB_buffer_storage");
+
+	// Regions of the staging buffer are reused once the fence of the upload that used them signals
+	if (_stagingBytes == 0 || !buffersSupported || !_syncSupported) {
+		_stagingMode = STAGING_NONE;
+		return;
+	}
+
+	glGenBuffers(1, &_stagingBuffer);
+	glBindBuffer(GL_COPY_READ_BUFFER, _stagingBuffer);
+	if (storageSupported) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_READ_BUFFER, _stagingBytes, NULL, flags);
+		_stagingMemory = (unsigned char*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, _stagingBytes, flags);
+		if (_stagingMemory != NULL) {
+			_stagingMode = STAGING_PERSISTENT;
+		}
+		else {
+			// Storage is immutable, so start over with a plain buffer
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			glDeleteBuffers(1, &_stagingBuffer);
+			glGenBuffers(1, &_stagingBuffer);
+			glBindBuffer(GL_COPY_READ_BUFFER, _stagingBuffer);
+		}
+	}
+	if (_stagingMode != STAGING_PERSISTENT) {
+		glBufferData(GL_COPY_READ_BUFFER, _stagingBytes, NULL, GL_STREAM_DRAW);
+		_stagingMode = STAGING_MAPPED;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+void AssetStreamer::releaseStaging()
+{
+	if (_stagingBuffer == 0) {
+		return;
+	}
+	if (_stagingMode == STAGING_PERSISTENT) {
+		glBindBuffer(GL_COPY_READ_BUFFER, _stagingBuffer);
+		glUnmapBuffer(GL_COPY_READ_BUFFER);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		_stagingMemory = NULL;
+	}
+	glDeleteBuffers(1, &_stagingBuffer);
+	_stagingBuffer = 0;
+}
+
+bool AssetStreamer::allocateStaging(size_t size, size_t &offset)
+{
+	// The regions in use run from the oldest staged upload still on the GPU up to _stagingHead
+	const Upload* oldest = NULL;
+	for (size_t i = 0; i < _uploads.size(); i++) {
+		if (_uploads[i].stagingSize > 0) {
+			oldest = &_uploads[i];
+			break;
+		}
+	}
+	if (oldest == NULL) {
+		offset = 0;
+	}
+	else {
+		size_t tail = oldest->stagingOffset;
+		if (_stagingHead > tail) {
+			if (_stagingHead + size <= _stagingBytes) {
+				offset = _stagingHead;
+			}
+			else if (size <= tail) {
+				offset = 0;
+			}
+			else {
+				return false;
+			}
+		}
+		else if (_stagingHead < tail && _stagingHead + size <= tail) {
+			offset = _stagingHead;
+		}
+		else {
+			return false;
+		}
+	}
+	_stagingHead = offset + size;
+	return true;
+}
+
+void AssetStreamer::uploadAsset(AssetHandleRef handle)
+{
+	const std::vector<unsigned char> &data = handle->_data;
+
+	AssetStaging staging;
+	staging.buffer = 0;
+	staging.offset = 0;
+	staging.pointer = data.empty() ? NULL : &data[0];
+	staging.size = data.size();
+
+	Upload upload;
+	upload.handle = handle;
+	upload.fence = 0;
+	upload.stagingOffset = 0;
+	upload.stagingSize = 0;
+
+	if (_stagingMode != STAGING_NONE && staging.size > 0 && staging.size <= _stagingBytes) {
+		size_t offset = 0;
+		while (!allocateStaging(staging.size, offset)) {
+			retireUploads(true);
+		}
+
+		glBindBuffer(GL_COPY_READ_BUFFER, _stagingBuffer);
+		bool staged = true;
+		if (_stagingMode == STAGING_PERSISTENT) {
+			memcpy(_stagingMemory + offset, staging.pointer, staging.size);
+		}
+		else {
+			// Nothing else uses this region until its fence signals, so the driver need not synchronize
+			void* memory = glMapBufferRange(GL_COPY_READ_BUFFER, offset, staging.size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (memory != NULL) {
+				memcpy(memory, staging.pointer, staging.size);
+				glUnmapBuffer(GL_COPY_READ_BUFFER);
+			}
+			else {
+				staged = false;
+				_stagingHead = offset;
+			}
+		}
+
+		if (staged) {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _stagingBuffer);
+			staging.buffer = _stagingBuffer;
+			staging.offset = offset;
+			upload.stagingOffset = offset;
+			upload.stagingSize = staging.size;
+		}
+		else {
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		}
+	}
+
+	upload.name = handle->_request->upload(staging);
+
+	if (staging.buffer != 0) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	}
+
+	// The asset becomes ready once this fence signals
+	if (_syncSupported) {
+		upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+	}
+	else {
+		glFinish();
+	}
+
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	std::vector<unsigned char>().swap(handle->_data);
+	_uploads.push_back(upload);
+}
+
+bool AssetStreamer::retireUploads(bool wait)
+{
+	bool retired = false;
+	while (!_uploads.empty()) {
+		Upload &upload = _uploads.front();
+		if (upload.fence != 0) {
+			GLuint64 timeout = wait ? 1000000000 : 0;
+			GLenum result = glClientWaitSync(upload.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+			if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+				if (result == GL_WAIT_FAILED) {
+					MINVR_LOG_WARNING(Logger::core()) << "AssetStreamer: Waiting for the upload of " << upload.handle->_id << " failed.";
+				}
+				else {
+					return retired;
+				}
+			}
+			glDeleteSync(upload.fence);
+		}
+
+		AssetHandleRef handle = upload.handle;
+		GLuint name = upload.name;
+		SharedResourceCache::ResourceType type = handle->_request->getResourceType();
+		if (name != 0) {
+			_cache->publish(handle->_id, type, name);
+		}
+
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		_uploads.pop_front();
+		if (name != 0) {
+			handle->_name.store(name);
+			finish(handle, AssetHandle::STATE_READY);
+		}
+		else {
+			MINVR_LOG_WARNING(Logger::core()) << "AssetStreamer: Cannot upload " << handle->_id << ".";
+			finish(handle, AssetHandle::STATE_FAILED);
+		}
+		retired = true;
+		wait = false;
+	}
+	return retired;
+}
+
+void AssetStreamer::stop()
+{
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		if (!_uploadThread) {
+			return;
+		}
+		_stopping = true;
+		_loadCond.notify_all();
+		_uploadCond.notify_all();
+	}
+
+	_loaderThreads.join_all();
+	_uploadThread->join();
+	_uploadThread.reset();
+	_uploadWindow.reset();
+
+	{
+		boost::lock_guard<boost::mutex> lock(_mutex);
+		while (!_pendingLoads.empty()) {
+			finish(_pendingLoads.back(), AssetHandle::STATE_CANCELLED);
+			_pendingLoads.pop_back();
+		}
+		while (!_pendingUploads.empty()) {
+			finish(_pendingUploads.back(), AssetHandle::STATE_CANCELLED);
+			_pendingUploads.pop_back();
+		}
+	}
+	logStats();
+}
+
+int AssetStreamer::getNumQueued()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _pendingLoads.size() + _pendingUploads.size() + _uploads.size();
+}
+
+long AssetStreamer::getNumReady()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _numReady;
+}
+
+long AssetStreamer::getBytesUploaded()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _bytesUploaded;
+}
+
+void AssetStreamer::logStats()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	if (_numReady + _numFailed + _numCancelled == 0) {
+		return;
+	}
+	const char* modes[] = {"client memory", "a mapped staging buffer", "a persistently mapped staging buffer"};
+	MINVR_LOG_INFO(Logger::core()) << "AssetStreamer (ShareGroup " << _cache->getShareGroup() << "): " << _numReady << " assets ready, "
+		<< _numFailed << " failed, " << _numCancelled << " cancelled.";
+	MINVR_LOG_INFO(Logger::core()) << "AssetStreamer (ShareGroup " << _cache->getShareGroup() << "): " << _bytesUploaded / 1048576.0
+		<< " MB uploaded through " << modes[_stagingMode] << " over " << _numFrames << " frames, at most " << _peakFrameBytes / 1048576.0 << " MB in one frame.";
+}
+
+} // end namespace
@@ -210,6 +210,11 @@ void CameraOffAxis::setObjectToWorldMatrix(glm::dmat4 obj2World)
 }
 
 
+AbstractCameraRef CameraOffAxis::clone()
+{
+	return AbstractCameraRef(new CameraOffAxis(*this));
+}
+
 void CameraOffAxis::applyProjectionAndCameraMatrices(const glm::dmat4& projectionMat, const glm::dmat4& viewMat)
 {
 	_currentViewMatrix = viewMat;
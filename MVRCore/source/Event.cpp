@@ -34,7 +34,9 @@
 
 #include "MVRCore/Event.H"
 #include "MVRCore/StringUtils.H"
+#include "MVRCore/TimeService.H"
 #include <boost/format.hpp>
+#include <cstdio>
 
 #define BOOST_ASSERT_MSG_OSTREAM std::cout
 #include <boost/assert.hpp>
@@ -46,7 +48,7 @@ namespace MinVR {
 Event::Event(const std::string &name, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp)
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -60,7 +62,7 @@ Event::Event(const std::string &name, const WindowRef window/*= nullptr*/, const
 Event::Event(const std::string &name, const double data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp)
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -75,7 +77,7 @@ Event::Event(const std::string &name, const double data, const WindowRef window/
 Event::Event(const std::string &name, const glm::dvec2 &data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp)
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -90,7 +92,7 @@ Event::Event(const std::string &name, const glm::dvec2 &data, const WindowRef wi
 Event::Event(const std::string &name, const glm::dvec3 &data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp) 
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -105,7 +107,7 @@ Event::Event(const std::string &name, const glm::dvec3 &data, const WindowRef wi
 Event::Event(const std::string &name, const glm::dvec4 &data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp) 
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -121,7 +123,7 @@ Event::Event(const std::string &name, const glm::dvec4 &data, const WindowRef wi
 Event::Event(const std::string &name, const glm::dmat4 &data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp) 
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -136,7 +138,7 @@ Event::Event(const std::string &name, const glm::dmat4 &data, const WindowRef wi
 Event::Event(const std::string &name, const std::string &data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp )
 { 
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -148,10 +150,25 @@ Event::Event(const std::string &name, const std::string &data, const WindowRef w
 	_window = window;
 }
 
+Event::Event(const std::string &name, const std::vector<TouchContact> &data, const WindowRef window/*= nullptr*/, const int id/*= -1*/, const boost::posix_time::ptime &timestamp)
+{
+	if (timestamp.is_not_a_date_time()) {
+		_timestamp = TimeService::localTime();
+	}
+	else {
+		_timestamp = timestamp;
+	}
+	_name = name;
+	_dataTouches = data;
+	_type = EVENTTYPE_TOUCHFRAME;
+	_id = id;
+	_window = window;
+}
+
 Event::Event(const std::string &eventString, const boost::posix_time::ptime &timestamp)
 {
 	if (timestamp.is_not_a_date_time()) {
-		_timestamp = boost::posix_time::microsec_clock::local_time();
+		_timestamp = TimeService::localTime();
 	}
 	else {
 		_timestamp = timestamp;
@@ -203,6 +220,22 @@ Event::Event(const std::string &eventString, const boost::posix_time::ptime &tim
 				_dataMsg = "\n";
 			}
 			break;
+		case 7:
+			_type = EVENTTYPE_TOUCHFRAME;
+			{
+				// Contacts are written as (id, sessionId, x, y, speed, accel, phase) groups
+				std::string::size_type start = data.find('(');
+				while (start != std::string::npos) {
+					TouchContact c;
+					int phase = 0;
+					if (sscanf(data.c_str() + start, "(%d, %ld, %lf, %lf, %lf, %lf, %d)", &c.id, &c.sessionId, &c.position.x, &c.position.y, &c.speed, &c.accel, &phase) == 7) {
+						c.phase = (TouchContact::Phase)phase;
+						_dataTouches.push_back(c);
+					}
+					start = data.find('(', start + 1);
+				}
+			}
+			break;
 		default:
 			BOOST_ASSERT_MSG(false, "Unknown Event type in Event constructor from event string");
 	}
@@ -269,6 +302,11 @@ std::string	Event::getMsgData()
 	return _dataMsg;
 }
 
+const std::vector<TouchContact>& Event::getTouchFrameData()
+{
+	return _dataTouches;
+}
+
 boost::posix_time::ptime Event::getTimestamp()
 {
 	return _timestamp;
@@ -312,6 +350,16 @@ std::string	Event::toString()
 	case EVENTTYPE_MSG:
 		return boost::str(boost::format("%s %d (Data: %s; Id: %d; Window ptr: %s)") % _name.c_str() % EVENTTYPE_MSG % escapedMessage % _id % _window);
 		break;
+	case EVENTTYPE_TOUCHFRAME:
+		{
+			std::string contacts;
+			for (int i = 0; i < _dataTouches.size(); i++) {
+				const TouchContact &c = _dataTouches[i];
+				contacts += boost::str(boost::format("%s(%d, %d, %.6f, %.6f, %.6f, %.6f, %d)") % (i ? " " : "") % c.id % c.sessionId % c.position.x % c.position.y % c.speed % c.accel % (int)c.phase);
+			}
+			return boost::str(boost::format("%s %d (Data: %s; Id: %d; Window ptr: %s)") % _name.c_str() % EVENTTYPE_TOUCHFRAME % contacts % _id % _window);
+		}
+		break;
 	default:
 		return _name;
 		break;
@@ -343,6 +391,9 @@ EventRef createCopyOfEvent(EventRef e)
 		case Event::EVENTTYPE_MSG:
 			return std::shared_ptr<Event>(new Event(e->getName(),e->getMsgData(), e->getWindow(), e->getId()));
 			break;
+		case Event::EVENTTYPE_TOUCHFRAME:
+			return std::shared_ptr<Event>(new Event(e->getName(),e->getTouchFrameData(), e->getWindow(), e->getId()));
+			break;
 		default:
 			BOOST_ASSERT_MSG(false, "createCopyOfEvent: Unknown event type!");
 			return NULL;
@@ -0,0 +1,365 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/FrameCapture.H"
+#include "MVRCore/StringUtils.H"
+#include "MVRCore/Logger.H"
+#include <cstring>
+
+namespace MinVR {
+
+CaptureWriterPool::CaptureWriterPool(int numThreads, int maxQueueDepth) : _maxQueueDepth(std::max(1, maxQueueDepth)), _numBusy(0), _stopping(false),
+	_deepestQueue(0), _numWritten(0), _numDropped(0), _numFailed(0), _totalQueueDepth(0.0), _numSubmitted(0)
+{
+	for (int i = 0; i < std::max(1, numThreads); i++) {
+		_threads.create_thread(boost::bind(&CaptureWriterPool::run, this));
+	}
+}
+
+CaptureWriterPool::~CaptureWriterPool()
+{
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_stopping = true;
+		_jobCond.notify_all();
+	}
+	// The writers empty the queue before they exit
+	_threads.join_all();
+}
+
+CapturedFrameRef CaptureWriterPool::acquireFrame()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	if (_freeFrames.empty()) {
+		return CapturedFrameRef(new CapturedFrame());
+	}
+	CapturedFrameRef frame = _freeFrames.back();
+	_freeFrames.pop_back();
+	return frame;
+}
+
+bool CaptureWriterPool::submit(CapturedFrameRef frame, FrameSinkRef sink)
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	if (_queue.size() >= (size_t)_maxQueueDepth) {
+		_numDropped++;
+		recycle(frame);
+		return false;
+	}
+
+	Job job;
+	job.frame = frame;
+	job.sink = sink;
+	_queue.push_back(job);
+
+	_numSubmitted++;
+	_totalQueueDepth += _queue.size();
+	_deepestQueue = std::max(_deepestQueue, (int)_queue.size());
+	_jobCond.notify_one();
+	return true;
+}
+
+void CaptureWriterPool::recycle(CapturedFrameRef frame)
+{
+	// Enough buffers for a full queue and a frame on every writer, the rest are freed
+	if (_freeFrames.size() < (size_t)_maxQueueDepth + _threads.size()) {
+		_freeFrames.push_back(frame);
+	}
+}
+
+void CaptureWriterPool::run()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	while (true) {
+		while (_queue.empty() && !_stopping) {
+			_jobCond.wait(lock);
+		}
+		if (_queue.empty()) {
+			return;
+		}
+
+		Job job = _queue.front();
+		_queue.pop_front();
+		_numBusy++;
+		lock.unlock();
+
+		bool written = job.sink->writeFrame(*job.frame);
+
+		lock.lock();
+		_numBusy--;
+		if (written) {
+			_numWritten++;
+		}
+		else {
+			_numFailed++;
+		}
+		recycle(job.frame);
+		if (_queue.empty() && _numBusy == 0) {
+			_idleCond.notify_all();
+		}
+	}
+}
+
+void CaptureWriterPool::flush()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	while (!_queue.empty() || _numBusy > 0) {
+		_idleCond.wait(lock);
+	}
+}
+
+int CaptureWriterPool::getQueueDepth()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return (int)_queue.size();
+}
+
+int CaptureWriterPool::getMaxQueueDepth()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return _deepestQueue;
+}
+
+long CaptureWriterPool::getNumWritten()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return _numWritten;
+}
+
+long CaptureWriterPool::getNumDropped()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return _numDropped;
+}
+
+long CaptureWriterPool::getNumFailed()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return _numFailed;
+}
+
+void CaptureWriterPool::logStats()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	MINVR_LOG_INFO(Logger::core()) << "Frame capture: " << _numWritten << " frames written by " << _threads.size() << " threads, "
+		<< _numFailed << " failed, " << _numDropped << " dropped with the queue full. Queue depth averaged "
+		<< (_numSubmitted > 0 ? _totalQueueDepth / _numSubmitted : 0.0) << " and peaked at " << _deepestQueue << " of " << _maxQueueDepth << ".";
+}
+
+FrameCapture::Submitter::Submitter(int windowId, FrameSinkRef sink, CaptureWriterPoolRef writers) : _windowId(windowId), _sink(sink), _writers(writers),
+	_start(boost::chrono::steady_clock::now()), _numQueued(0), _numDropped(0)
+{
+}
+
+void FrameCapture::Submitter::frameReadBack(const ReadbackFrame &frame)
+{
+	CapturedFrameRef captured = _writers->acquireFrame();
+	captured->windowId = _windowId;
+	captured->frameNumber = frame.frameNumber;
+	captured->width = frame.width;
+	captured->height = frame.height;
+	// Frames are read back in the order they were issued
+	while (!_issueTimes.empty() && _issueTimes.front().first < frame.frameNumber) {
+		_issueTimes.pop_front();
+	}
+	if (!_issueTimes.empty() && _issueTimes.front().first == frame.frameNumber) {
+		captured->timestampMicroseconds = _issueTimes.front().second;
+		_issueTimes.pop_front();
+	}
+	else {
+		captured->timestampMicroseconds = 0;
+	}
+	captured->pixels.resize((size_t)frame.width * frame.height * frame.bytesPerPixel);
+	memcpy(&captured->pixels[0], frame.pixels, captured->pixels.size());
+
+	if (_writers->submit(captured, _sink)) {
+		_numQueued++;
+	}
+	else {
+		_numDropped++;
+	}
+}
+
+FrameCapture::FrameCapture(int windowId, WindowSettingsRef settings, FrameSinkRef sink, CaptureWriterPoolRef writers) :
+	_settings(settings), _submitter(new Submitter(windowId, sink, writers)), _readbackRing(std::max(1, settings->captureBuffers)),
+	_frameNumber(0), _interval(boost::chrono::steady_clock::duration::zero()), _width(0), _height(0), _scaleFBO(0), _scaleRBO(0)
+{
+	_readbackRing.setListener(_submitter);
+
+	if (settings->captureRate > 0.0) {
+		_interval = boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(boost::chrono::duration<double>(1.0 / settings->captureRate));
+	}
+	_nextCapture = boost::chrono::steady_clock::now();
+
+	initScaling();
+
+	MINVR_LOG_INFO(Logger::core()) << "Window" << windowId + 1 << " capturing " << (_scaleFBO ? intToString(_width) + "x" + intToString(_height) : std::string("full size"))
+		<< " frames " << (settings->captureRate > 0.0 ? "at up to " + realToString(settings->captureRate) + " Hz" : std::string("every frame"))
+		<< " to " << sink->getDescription() << ".";
+}
+
+FrameCapture::~FrameCapture()
+{
+}
+
+FrameSinkRef FrameCapture::createSink(int windowId, WindowSettingsRef settings)
+{
+	std::string sinkType = settings->captureSink;
+	if (sinkType == "" || sinkType == "None") {
+		return FrameSinkRef();
+	}
+
+	std::string windowStr = "Window" + intToString(windowId + 1);
+	if (sinkType == "Raw" || sinkType == "PNG") {
+		std::string path = settings->capturePath != "" ? settings->capturePath : "MinVR-Capture/" + windowStr;
+		return FrameSinkRef(new FileSequenceSink(path, sinkType == "PNG" ? FileSequenceSink::FORMAT_PNG : FileSequenceSink::FORMAT_RAW));
+	}
+	if (sinkType == "SharedMemory") {
+		std::string name = settings->capturePath != "" ? settings->capturePath : "/minvr-window" + intToString(windowId + 1);
+		int width = settings->captureWidth > 0 ? settings->captureWidth : settings->width;
+		int height = settings->captureHeight > 0 ? settings->captureHeight : settings->height;
+		std::shared_ptr<SharedMemorySink> sink(new SharedMemorySink(name, 3, width, height));
+		if (!sink->isOpen()) {
+			return FrameSinkRef();
+		}
+		return sink;
+	}
+
+	MINVR_LOG_WARNING(Logger::core()) << "Unrecognized value for " << windowStr << "_CaptureSink: " << sinkType << ". Frames will not be captured.";
+	return FrameSinkRef();
+}
+
+void FrameCapture::initScaling()
+{
+	_width = _settings->captureWidth > 0 ? _settings->captureWidth : _settings->width;
+	_height = _settings->captureHeight > 0 ? _settings->captureHeight : _settings->height;
+	if (_width == _settings->width && _height == _settings->height) {
+		return;
+	}
+
+#ifdef _WIN32
+	if (!pglBlitFramebuffer) {
+		MINVR_LOG_WARNING(Logger::core()) << "Frame capture: glBlitFramebuffer is not available, capturing at the window size.";
+		return;
+	}
+#endif
+	// Multisampled buffers can only be blitted at the same size
+	if (_settings->msaaSamples > 1) {
+		MINVR_LOG_WARNING(Logger::core()) << "Frame capture: cannot scale a multisampled window, capturing at the window size.";
+		return;
+	}
+
+	glGenRenderbuffers(1, &_scaleRBO);
+	glBindRenderbuffer(GL_RENDERBUFFER, _scaleRBO);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, _width, _height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &_scaleFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, _scaleFBO);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, _scaleRBO);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		MINVR_LOG_WARNING(Logger::core()) << "Frame capture: cannot create a " << _width << "x" << _height << " framebuffer, capturing at the window size.";
+		glDeleteFramebuffers(1, &_scaleFBO);
+		glDeleteRenderbuffers(1, &_scaleRBO);
+		_scaleFBO = 0;
+		_scaleRBO = 0;
+	}
+}
+
+void FrameCapture::captureFrame(int windowWidth, int windowHeight)
+{
+	long frameNumber = _frameNumber++;
+
+	// Hand out finished frames every frame, so a low capture rate does not delay them
+	_readbackRing.deliverCompleted();
+
+	boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+	if (_interval > boost::chrono::steady_clock::duration::zero()) {
+		if (now < _nextCapture) {
+			return;
+		}
+		_nextCapture += _interval;
+		if (_nextCapture < now) {
+			_nextCapture = now + _interval;
+		}
+	}
+	boost::int64_t timestamp = boost::chrono::duration_cast<boost::chrono::microseconds>(now - _submitter->_start).count();
+
+	bool issued;
+	GLenum backBuffer = (_settings->stereo && _settings->stereoType == WindowSettings::STEREOTYPE_QUADBUFFERED) ? GL_BACK_LEFT : GL_BACK;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(backBuffer);
+	if (_scaleFBO) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _scaleFBO);
+		glBlitFramebuffer(0, 0, windowWidth, windowHeight, 0, 0, _width, _height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, _scaleFBO);
+		glReadBuffer(GL_COLOR_ATTACHMENT0);
+		issued = _readbackRing.readPixels(0, 0, _width, _height, frameNumber);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	}
+	else {
+		issued = _readbackRing.readPixels(0, 0, windowWidth, windowHeight, frameNumber);
+	}
+	glReadBuffer(GL_BACK);
+
+	// Only frames the ring took are in flight, a skipped frame must not take another's timestamp
+	if (issued) {
+		_submitter->_issueTimes.push_back(std::make_pair(frameNumber, timestamp));
+	}
+}
+
+void FrameCapture::finish()
+{
+	_readbackRing.finish();
+	_readbackRing.releaseGLObjects();
+	if (_scaleFBO) {
+		glDeleteFramebuffers(1, &_scaleFBO);
+		glDeleteRenderbuffers(1, &_scaleRBO);
+		_scaleFBO = 0;
+		_scaleRBO = 0;
+	}
+}
+
+void FrameCapture::logStats(const std::string &name)
+{
+	MINVR_LOG_INFO(Logger::core()) << name << " capture: " << _submitter->_numQueued << " frames queued, "
+		<< _readbackRing.getNumSkipped() << " dropped waiting on the GPU, " << _submitter->_numDropped << " dropped with the writer queue full.";
+}
+
+} // end namespace
@@ -0,0 +1,133 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/FramePacer.H"
+#include "MVRCore/Logger.H"
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace MinVR {
+
+// Frames the work time is predicted from
+#define MAX_WORK_TIMES 16
+
+// The last part of the wait is spent yielding, sleeps can overshoot by about this much
+#define SPIN_SECONDS 0.001
+
+FramePacer::FramePacer(double margin)
+{
+	_margin = margin;
+	_period = 0.0;
+	_target = -1.0;
+	_lastRefresh = -1.0;
+	_numFrames = 0;
+	_numPaced = 0;
+	_numMissed = 0;
+	_totalSleep = 0.0;
+	_totalSlack = 0.0;
+	_minSlack = 0.0;
+}
+
+double FramePacer::getPredictedWorkTime() const
+{
+	if (_workTimes.empty()) {
+		return 0.0;
+	}
+	return *std::max_element(_workTimes.begin(), _workTimes.end());
+}
+
+double FramePacer::waitForFrameStart(const DisplayTimePredictor &predictor, double clockOrigin)
+{
+	double now = TimeService::seconds() - clockOrigin;
+	_period = predictor.getRefreshPeriod();
+	if (_period <= 0.0 || _lastRefresh < 0.0 || _workTimes.empty()) {
+		_target = -1.0;
+		return now;
+	}
+
+	// The first refresh the frame can make if it starts now
+	double lead = getPredictedWorkTime() + _margin;
+	double refreshes = std::max(std::ceil((now + lead - _lastRefresh) / _period), 1.0);
+	_target = _lastRefresh + refreshes * _period;
+	_numPaced++;
+
+	double start = _target - lead;
+	if (start - now > SPIN_SECONDS) {
+		boost::this_thread::sleep_for(boost::chrono::nanoseconds(static_cast<boost::int64_t>((start - now - SPIN_SECONDS) * 1.0e9)));
+	}
+	while (TimeService::seconds() - clockOrigin < start) {
+		boost::this_thread::yield();
+	}
+	double frameStart = TimeService::seconds() - clockOrigin;
+	_totalSleep += frameStart - now;
+	return frameStart;
+}
+
+void FramePacer::framePresented(double frameStart, double presentTime, double slack)
+{
+	_workTimes.push_back(std::max(presentTime - frameStart - slack, 0.0));
+	if (_workTimes.size() > MAX_WORK_TIMES) {
+		_workTimes.pop_front();
+	}
+
+	// A frame that made its refresh keeps the grid, even if the swap returned early or a little late
+	if (_target >= 0.0 && presentTime <= _target + 0.5 * _period) {
+		_lastRefresh = _target;
+	}
+	else {
+		if (_target >= 0.0 && presentTime > _target) {
+			_numMissed++;
+		}
+		_lastRefresh = presentTime;
+	}
+
+	_minSlack = (_numFrames == 0) ? slack : std::min(_minSlack, slack);
+	_totalSlack += slack;
+	_numFrames++;
+}
+
+void FramePacer::logStats()
+{
+	if (_numFrames == 0) {
+		return;
+	}
+	MINVR_LOG_INFO(Logger::core()) << "FramePacer: " << _numPaced << " of " << _numFrames << " frames paced, sleeping "
+		<< 1000.0 * _totalSleep / _numFrames << " ms per frame, " << _numMissed << " missed their refresh.";
+	MINVR_LOG_INFO(Logger::core()) << "FramePacer: slack " << 1000.0 * _totalSlack / _numFrames << " ms on average, "
+		<< 1000.0 * _minSlack << " ms at least, last predicted work time " << 1000.0 * getPredictedWorkTime() << " ms.";
+}
+
+} // end namespace
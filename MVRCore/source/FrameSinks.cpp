@@ -0,0 +1,354 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/FrameSinks.H"
+#include "MVRCore/Logger.H"
+#include <boost/atomic.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/once.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+namespace MinVR {
+
+FileSequenceSink::FileSequenceSink(const std::string &pathPrefix, Format format) : _pathPrefix(pathPrefix), _format(format)
+{
+	boost::filesystem::path directory = boost::filesystem::path(pathPrefix).parent_path();
+	if (!directory.empty()) {
+		boost::system::error_code error;
+		boost::filesystem::create_directories(directory, error);
+		if (error) {
+			MINVR_LOG_WARNING(Logger::core()) << "FileSequenceSink: Cannot create " << directory.string() << " (" << error.message() << ").";
+		}
+	}
+}
+
+bool FileSequenceSink::writeFrame(const CapturedFrame &frame)
+{
+	std::stringstream filename;
+	filename << _pathPrefix << "_" << std::setw(6) << std::setfill('0') << frame.frameNumber;
+
+	if (_format == FORMAT_PNG) {
+		filename << ".png";
+		return writePNG(filename.str(), frame.width, frame.height, &frame.pixels[0]);
+	}
+
+	filename << "_" << frame.width << "x" << frame.height << ".rgba";
+	std::ofstream file(filename.str().c_str(), std::ios::out | std::ios::binary);
+	if (!file) {
+		return false;
+	}
+	size_t rowBytes = (size_t)frame.width * 4;
+	for (int y = frame.height - 1; y >= 0; y--) {
+		file.write((const char*)&frame.pixels[y * rowBytes], rowBytes);
+	}
+	return file.good();
+}
+
+std::string FileSequenceSink::getDescription()
+{
+	return (_format == FORMAT_PNG ? "PNG files " : "raw files ") + _pathPrefix + "_*";
+}
+
+static boost::uint32_t crcTable[256];
+static boost::once_flag crcTableBuilt = BOOST_ONCE_INIT;
+
+static void buildCRCTable()
+{
+	for (boost::uint32_t n = 0; n < 256; n++) {
+		boost::uint32_t c = n;
+		for (int k = 0; k < 8; k++) {
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		crcTable[n] = c;
+	}
+}
+
+// Writes PNG chunks and a zlib stream made of stored deflate blocks, updating the chunk
+// CRC and the zlib Adler-32 checksum as the bytes go out.
+class PNGStreamWriter
+{
+public:
+	PNGStreamWriter(std::ostream &out) : _out(out), _crc(0), _adlerA(1), _adlerB(0), _rawLeft(0), _blockLeft(0) {
+		boost::call_once(&buildCRCTable, crcTableBuilt);
+	}
+
+	void beginChunk(const char* type, boost::uint32_t length) {
+		writeBigEndian(length, false);
+		_crc = 0xFFFFFFFFu;
+		write((const unsigned char*)type, 4);
+	}
+
+	void endChunk() {
+		writeBigEndian(_crc ^ 0xFFFFFFFFu, false);
+	}
+
+	void writeBigEndian(boost::uint32_t value, bool updateCRC = true) {
+		unsigned char bytes[4] = {(unsigned char)(value >> 24), (unsigned char)(value >> 16), (unsigned char)(value >> 8), (unsigned char)value};
+		if (updateCRC) {
+			write(bytes, 4);
+		}
+		else {
+			_out.write((const char*)bytes, 4);
+		}
+	}
+
+	void write(const unsigned char* data, size_t length) {
+		boost::uint32_t c = _crc;
+		for (size_t i = 0; i < length; i++) {
+			c = crcTable[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+		}
+		_crc = c;
+		_out.write((const char*)data, length);
+	}
+
+	static size_t storedStreamLength(size_t rawLength) {
+		size_t numBlocks = std::max((size_t)1, (rawLength + 65534) / 65535);
+		return 2 + numBlocks * 5 + rawLength + 4;
+	}
+
+	void beginStoredStream(size_t rawLength) {
+		// zlib header: deflate with a 32K window, no preset dictionary
+		const unsigned char header[2] = {0x78, 0x01};
+		write(header, 2);
+		_rawLeft = rawLength;
+		_blockLeft = 0;
+		_adlerA = 1;
+		_adlerB = 0;
+		if (rawLength == 0) {
+			beginBlock();
+		}
+	}
+
+	void writeStored(const unsigned char* data, size_t length) {
+		while (length > 0) {
+			if (_blockLeft == 0) {
+				beginBlock();
+			}
+			size_t n = std::min(length, _blockLeft);
+			write(data, n);
+			updateAdler(data, n);
+			data += n;
+			length -= n;
+			_blockLeft -= n;
+		}
+	}
+
+	void endStoredStream() {
+		writeBigEndian((_adlerB << 16) | _adlerA);
+	}
+
+private:
+	void beginBlock() {
+		size_t n = std::min(_rawLeft, (size_t)65535);
+		_rawLeft -= n;
+		unsigned char header[5] = {(unsigned char)(_rawLeft == 0 ? 1 : 0), (unsigned char)(n & 0xFF), (unsigned char)(n >> 8),
+			(unsigned char)(~n & 0xFF), (unsigned char)((~n >> 8) & 0xFF)};
+		write(header, 5);
+		_blockLeft = n;
+	}
+
+	void updateAdler(const unsigned char* data, size_t length) {
+		// 5552 is the most bytes that can be summed before the 32 bit sums can overflow
+		while (length > 0) {
+			size_t n = std::min(length, (size_t)5552);
+			for (size_t i = 0; i < n; i++) {
+				_adlerA += data[i];
+				_adlerB += _adlerA;
+			}
+			_adlerA %= 65521;
+			_adlerB %= 65521;
+			data += n;
+			length -= n;
+		}
+	}
+
+	std::ostream &_out;
+	boost::uint32_t _crc;
+	boost::uint32_t _adlerA;
+	boost::uint32_t _adlerB;
+	size_t _rawLeft;
+	size_t _blockLeft;
+};
+
+bool FileSequenceSink::writePNG(const std::string &filename, int width, int height, const unsigned char* pixels)
+{
+	std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+	file.write((const char*)signature, 8);
+
+	PNGStreamWriter png(file);
+
+	// 8 bit RGBA, deflate, no interlacing
+	png.beginChunk("IHDR", 13);
+	png.writeBigEndian(width);
+	png.writeBigEndian(height);
+	const unsigned char format[5] = {8, 6, 0, 0, 0};
+	png.write(format, 5);
+	png.endChunk();
+
+	// Every row starts with filter type 0 (none), and PNG rows go top to bottom
+	size_t rowBytes = (size_t)width * 4;
+	size_t rawLength = (rowBytes + 1) * height;
+	png.beginChunk("IDAT", (boost::uint32_t)PNGStreamWriter::storedStreamLength(rawLength));
+	png.beginStoredStream(rawLength);
+	const unsigned char filter = 0;
+	for (int y = height - 1; y >= 0; y--) {
+		png.writeStored(&filter, 1);
+		png.writeStored(pixels + y * rowBytes, rowBytes);
+	}
+	png.endStoredStream();
+	png.endChunk();
+
+	png.beginChunk("IEND", 0);
+	png.endChunk();
+
+	return file.good();
+}
+
+SharedMemorySink::SharedMemorySink(const std::string &name, int numSlots, int maxWidth, int maxHeight) :
+	_name(name), _memory(NULL), _memorySize(0), _slotStride(0), _header(NULL), _sequence(0)
+{
+#ifdef _WIN32
+	MINVR_LOG_WARNING(Logger::core()) << "SharedMemorySink: Shared memory capture is only supported on POSIX systems.";
+#else
+	size_t slotBytes = (size_t)maxWidth * maxHeight * 4;
+	// Keep every slot's pixels 64 byte aligned
+	size_t headerSize = (sizeof(SharedFrameRingHeader) + 63) & ~(size_t)63;
+	_slotStride = ((sizeof(SharedFrameSlot) + 63) & ~(size_t)63) + ((slotBytes + 63) & ~(size_t)63);
+	_memorySize = headerSize + _slotStride * numSlots;
+
+	int fd = shm_open(_name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0) {
+		MINVR_LOG_WARNING(Logger::core()) << "SharedMemorySink: Cannot open " << _name << " (" << strerror(errno) << ").";
+		return;
+	}
+	if (ftruncate(fd, _memorySize) != 0) {
+		MINVR_LOG_WARNING(Logger::core()) << "SharedMemorySink: Cannot size " << _name << " (" << strerror(errno) << ").";
+		close(fd);
+		shm_unlink(_name.c_str());
+		return;
+	}
+	void* memory = mmap(NULL, _memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED) {
+		MINVR_LOG_WARNING(Logger::core()) << "SharedMemorySink: Cannot map " << _name << " (" << strerror(errno) << ").";
+		shm_unlink(_name.c_str());
+		return;
+	}
+
+	_memory = (unsigned char*)memory;
+	memset(_memory, 0, _memorySize);
+	_header = (SharedFrameRingHeader*)_memory;
+	_header->numSlots = numSlots;
+	_header->slotBytes = (boost::uint32_t)slotBytes;
+	_header->version = MINVR_SHARED_FRAME_VERSION;
+	_header->latestSequence = 0;
+	boost::atomic_thread_fence(boost::memory_order_release);
+	// Written last, so a viewer that sees the magic sees a valid header
+	_header->magic = MINVR_SHARED_FRAME_MAGIC;
+
+	MINVR_LOG_INFO(Logger::core()) << "SharedMemorySink: Publishing frames up to " << maxWidth << "x" << maxHeight << " in " << _name << " (" << numSlots << " slots).";
+#endif
+}
+
+SharedMemorySink::~SharedMemorySink()
+{
+#ifndef _WIN32
+	if (_memory != NULL) {
+		munmap(_memory, _memorySize);
+		shm_unlink(_name.c_str());
+	}
+#endif
+}
+
+bool SharedMemorySink::isOpen()
+{
+	return _memory != NULL;
+}
+
+SharedFrameSlot* SharedMemorySink::getSlot(boost::uint64_t index)
+{
+	size_t headerSize = (sizeof(SharedFrameRingHeader) + 63) & ~(size_t)63;
+	return (SharedFrameSlot*)(_memory + headerSize + _slotStride * (index % _header->numSlots));
+}
+
+bool SharedMemorySink::writeFrame(const CapturedFrame &frame)
+{
+	if (_memory == NULL || frame.pixels.size() > _header->slotBytes) {
+		return false;
+	}
+
+	boost::mutex::scoped_lock lock(_writeMutex);
+	boost::uint64_t sequence = ++_sequence;
+	SharedFrameSlot* slot = getSlot(sequence - 1);
+	unsigned char* pixels = (unsigned char*)slot + ((sizeof(SharedFrameSlot) + 63) & ~(size_t)63);
+
+	// An odd sequence tells readers the slot is being rewritten
+	slot->sequence = 2 * sequence - 1;
+	boost::atomic_thread_fence(boost::memory_order_release);
+
+	slot->frameNumber = frame.frameNumber;
+	slot->timestampMicroseconds = frame.timestampMicroseconds;
+	slot->width = frame.width;
+	slot->height = frame.height;
+	memcpy(pixels, &frame.pixels[0], frame.pixels.size());
+
+	boost::atomic_thread_fence(boost::memory_order_release);
+	slot->sequence = 2 * sequence;
+	_header->latestSequence = sequence;
+	return true;
+}
+
+std::string SharedMemorySink::getDescription()
+{
+	return "shared memory " + _name;
+}
+
+} // end namespace
@@ -0,0 +1,226 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/GLExtensions.H"
+#include <boost/thread/once.hpp>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+#ifdef _WIN32
+// Framebuffer object
+PFNGLGENFRAMEBUFFERSPROC pglGenFramebuffers = NULL;
+PFNGLDELETEFRAMEBUFFERSPROC pglDeleteFramebuffers = NULL;
+PFNGLBINDFRAMEBUFFERPROC pglBindFramebuffer = NULL;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC pglCheckFramebufferStatus = NULL;
+PFNGLGETFRAMEBUFFERATTACHMENTPARAMETERIVPROC pglGetFramebufferAttachmentParameteriv = NULL;
+PFNGLGENERATEMIPMAPPROC pglGenerateMipmap = NULL;
+PFNGLFRAMEBUFFERTEXTURE2DPROC pglFramebufferTexture2D = NULL;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC pglFramebufferRenderbuffer = NULL;
+// Renderbuffer object
+PFNGLGENRENDERBUFFERSPROC pglGenRenderbuffers = NULL;
+PFNGLDELETERENDERBUFFERSPROC pglDeleteRenderbuffers = NULL;
+PFNGLBINDRENDERBUFFERPROC pglBindRenderbuffer = NULL;
+PFNGLRENDERBUFFERSTORAGEPROC pglRenderbufferStorage = NULL;
+PFNGLGETRENDERBUFFERPARAMETERIVPROC pglGetRenderbufferParameteriv = NULL;
+PFNGLISRENDERBUFFERPROC pglIsRenderbuffer = NULL;
+// Shaders
+PFNGLCREATEPROGRAMPROC pglCreateProgram = NULL;
+PFNGLCREATESHADERPROC pglCreateShader = NULL;
+PFNGLSHADERSOURCEPROC pglShaderSource = NULL;
+PFNGLCOMPILESHADERPROC pglCompileShader = NULL;
+PFNGLGETOBJECTPARAMETERIVARBPROC pglGetObjectParameterivARB = NULL;
+PFNGLATTACHSHADERPROC pglAttachShader = NULL;
+PFNGLLINKPROGRAMPROC pglLinkProgram = NULL;
+PFNGLGETSHADERIVPROC pglGetShaderiv = NULL;
+PFNGLGETPROGRAMIVARBPROC pglGetProgramivARB = NULL;
+PFNGLUSEPROGRAMPROC pglUseProgram = NULL;
+PFNGLGETUNIFORMLOCATIONPROC pglGetUniformLocation = NULL;
+PFNGLUNIFORM2FPROC pglUniform2f = NULL;
+PFNGLUNIFORM1IPROC pglUniform1i = NULL;
+PFNGLUNIFORM4FPROC pglUniform4f = NULL;
+PFNGLUNIFORMMATRIX4FVPROC pglUniformMatrix4fv = NULL;
+PFNGLGETPROGRAMIVPROC pglGetProgramiv = NULL;
+PFNGLGETSHADERINFOLOGPROC pglGetShaderInfoLog = NULL;
+PFNGLGETPROGRAMINFOLOGPROC pglGetProgramInfoLog = NULL;
+PFNGLDETACHSHADERPROC pglDetachShader = NULL;
+PFNGLDELETESHADERPROC pglDeleteShader = NULL;
+PFNGLDELETEPROGRAMPROC pglDeleteProgram = NULL;
+// Program binaries (optional, GL 4.1 or ARB_get_program_binary)
+PFNGLGETPROGRAMBINARYPROC pglGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC pglProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC pglProgramParameteri = NULL;
+// VBO
+PFNGLBINDBUFFERPROC pglBindBuffer = NULL;
+PFNGLGENBUFFERSPROC pglGenBuffers = NULL;
+PFNGLBUFFERDATAPROC pglBufferData = NULL;
+// Pixel buffer readback and fences (optional, GL 3.2 or ARB_sync)
+PFNGLDELETEBUFFERSPROC pglDeleteBuffers = NULL;
+PFNGLMAPBUFFERRANGEPROC pglMapBufferRange = NULL;
+PFNGLUNMAPBUFFERPROC pglUnmapBuffer = NULL;
+PFNGLFENCESYNCPROC pglFenceSync = NULL;
+PFNGLCLIENTWAITSYNCPROC pglClientWaitSync = NULL;
+PFNGLDELETESYNCPROC pglDeleteSync = NULL;
+PFNGLWAITSYNCPROC pglWaitSync = NULL;
+// Framebuffer blits (optional, GL 3.0 or ARB_framebuffer_object)
+PFNGLBLITFRAMEBUFFERPROC pglBlitFramebuffer = NULL;
+PFNGLCOPYBUFFERSUBDATAPROC pglCopyBufferSubData = NULL;
+PFNGLBUFFERSTORAGEPROC pglBufferStorage = NULL;
+// Timer queries (optional, GL 3.3 or ARB_timer_query)
+PFNGLGENQUERIESPROC pglGenQueries = NULL;
+PFNGLDELETEQUERIESPROC pglDeleteQueries = NULL;
+PFNGLQUERYCOUNTERPROC pglQueryCounter = NULL;
+PFNGLGETQUERYOBJECTIVPROC pglGetQueryObjectiv = NULL;
+PFNGLGETQUERYOBJECTUI64VPROC pglGetQueryObjectui64v = NULL;
+PFNGLGETQUERYIVPROC pglGetQueryiv = NULL;
+PFNGLGETINTEGER64VPROC pglGetInteger64v = NULL;
+// Textures
+PFNGLACTIVETEXTUREPROC pglActiveTexture = NULL;
+#endif
+
+static boost::once_flag extensionsLoaded = BOOST_ONCE_INIT;
+
+void GLExtensions::init()
+{
+	boost::call_once(&GLExtensions::load, extensionsLoaded);
+}
+
+void GLExtensions::load()
+{
+#ifdef _WIN32
+	// get pointers to GL functions
+	pglGenFramebuffers                     = (PFNGLGENFRAMEBUFFERSPROC)wglGetProcAddress("glGenFramebuffers");
+	pglDeleteFramebuffers                  = (PFNGLDELETEFRAMEBUFFERSPROC)wglGetProcAddress("glDeleteFramebuffers");
+	pglBindFramebuffer                     = (PFNGLBINDFRAMEBUFFERPROC)wglGetProcAddress("glBindFramebuffer");
+	pglCheckFramebufferStatus              = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)wglGetProcAddress("glCheckFramebufferStatus");
+	pglGetFramebufferAttachmentParameteriv = (PFNGLGETFRAMEBUFFERATTACHMENTPARAMETERIVPROC)wglGetProcAddress("glGetFramebufferAttachmentParameteriv");
+	pglGenerateMipmap                      = (PFNGLGENERATEMIPMAPPROC)wglGetProcAddress("glGenerateMipmap");
+	pglFramebufferTexture2D                = (PFNGLFRAMEBUFFERTEXTURE2DPROC)wglGetProcAddress("glFramebufferTexture2D");
+	pglFramebufferRenderbuffer             = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)wglGetProcAddress("glFramebufferRenderbuffer");
+	pglGenRenderbuffers                    = (PFNGLGENRENDERBUFFERSPROC)wglGetProcAddress("glGenRenderbuffers");
+	pglDeleteRenderbuffers                 = (PFNGLDELETERENDERBUFFERSPROC)wglGetProcAddress("glDeleteRenderbuffers");
+	pglBindRenderbuffer                    = (PFNGLBINDRENDERBUFFERPROC)wglGetProcAddress("glBindRenderbuffer");
+	pglRenderbufferStorage                 = (PFNGLRENDERBUFFERSTORAGEPROC)wglGetProcAddress("glRenderbufferStorage");
+	pglGetRenderbufferParameteriv          = (PFNGLGETRENDERBUFFERPARAMETERIVPROC)wglGetProcAddress("glGetRenderbufferParameteriv");
+	pglIsRenderbuffer                      = (PFNGLISRENDERBUFFERPROC)wglGetProcAddress("glIsRenderbuffer");
+
+	// check once again FBO extension
+	if(!pglGenFramebuffers || !pglDeleteFramebuffers || !pglBindFramebuffer || !pglCheckFramebufferStatus ||
+		!pglGetFramebufferAttachmentParameteriv || !pglGenerateMipmap || !pglFramebufferTexture2D || !pglFramebufferRenderbuffer ||
+		!pglGenRenderbuffers || !pglDeleteRenderbuffers || !pglBindRenderbuffer || !pglRenderbufferStorage ||
+		!pglGetRenderbufferParameteriv || !pglIsRenderbuffer)
+	{
+		BOOST_ASSERT_MSG(false, "Video card does NOT support GL_ARB_framebuffer_object.");
+	}
+	
+	pglCreateProgram = (PFNGLCREATEPROGRAMPROC)wglGetProcAddress("glCreateProgram");
+	pglCreateShader = (PFNGLCREATESHADERPROC)wglGetProcAddress("glCreateShader");
+	pglShaderSource = (PFNGLSHADERSOURCEPROC)wglGetProcAddress("glShaderSource");
+	pglCompileShader = (PFNGLCOMPILESHADERPROC)wglGetProcAddress("glCompileShader");
+	pglGetObjectParameterivARB = (PFNGLGETOBJECTPARAMETERIVARBPROC)wglGetProcAddress("glGetObjectParameterivARB");
+	pglAttachShader = (PFNGLATTACHSHADERPROC)wglGetProcAddress("glAttachShader");
+	pglLinkProgram = (PFNGLLINKPROGRAMPROC)wglGetProcAddress("glLinkProgram");
+	pglGetShaderiv = (PFNGLGETSHADERIVPROC)wglGetProcAddress("glGetShaderiv");
+	pglGetProgramivARB = (PFNGLGETPROGRAMIVARBPROC)wglGetProcAddress("glGetProgramivARB");
+	pglUseProgram = (PFNGLUSEPROGRAMPROC)wglGetProcAddress("glUseProgram");
+	pglGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC)wglGetProcAddress("glGetUniformLocation");
+	pglUniform2f = (PFNGLUNIFORM2FPROC)wglGetProcAddress("glUniform2f");
+	pglUniform1i = (PFNGLUNIFORM1IPROC)wglGetProcAddress("glUniform1i");
+	pglUniform4f = (PFNGLUNIFORM4FPROC)wglGetProcAddress("glUniform4f");
+	pglUniformMatrix4fv = (PFNGLUNIFORMMATRIX4FVPROC)wglGetProcAddress("glUniformMatrix4fv");
+	pglGetProgramiv = (PFNGLGETPROGRAMIVPROC)wglGetProcAddress("glGetProgramiv");
+	pglGetShaderInfoLog = (PFNGLGETSHADERINFOLOGPROC)wglGetProcAddress("glGetShaderInfoLog");
+	pglGetProgramInfoLog = (PFNGLGETPROGRAMINFOLOGPROC)wglGetProcAddress("glGetProgramInfoLog");
+	pglDetachShader = (PFNGLDETACHSHADERPROC)wglGetProcAddress("glDetachShader");
+	pglDeleteShader = (PFNGLDELETESHADERPROC)wglGetProcAddress("glDeleteShader");
+	pglDeleteProgram = (PFNGLDELETEPROGRAMPROC)wglGetProcAddress("glDeleteProgram");
+
+	if (!pglCreateProgram || !pglCreateShader || !pglShaderSource || !pglCompileShader || !pglGetObjectParameterivARB ||
+		!pglAttachShader || !pglLinkProgram || !pglGetShaderiv || !pglGetProgramivARB || !pglUseProgram ||
+		!pglGetUniformLocation || !pglUniform2f || !pglUniform1i || !pglUniform4f || !pglUniformMatrix4fv || !pglGetProgramiv || !pglGetShaderInfoLog ||
+		!pglGetProgramInfoLog || !pglDetachShader || !pglDeleteShader || !pglDeleteProgram)
+	{
+		BOOST_ASSERT_MSG(false, "Video card does NOT support loading shader extensions.");
+	}
+
+	// Not required, programBinarySupported() checks for these before the shader cache is used
+	pglGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)wglGetProcAddress("glGetProgramBinary");
+	pglProgramBinary = (PFNGLPROGRAMBINARYPROC)wglGetProcAddress("glProgramBinary");
+	pglProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)wglGetProcAddress("glProgramParameteri");
+
+	pglBindBuffer = (PFNGLBINDBUFFERPROC)wglGetProcAddress("glBindBuffer");
+	pglGenBuffers = (PFNGLGENBUFFERSPROC)wglGetProcAddress("glGenBuffers");
+	pglBufferData = (PFNGLBUFFERDATAPROC)wglGetProcAddress("glBufferData");
+
+	if (!pglBindBuffer || !pglGenBuffers || !pglBufferData) {
+		BOOST_ASSERT_MSG(false, "Video card does NOT support vertex buffer objects.");
+	}
+
+	// Not required, PixelReadbackRing::isSupported() checks for these
+	pglDeleteBuffers = (PFNGLDELETEBUFFERSPROC)wglGetProcAddress("glDeleteBuffers");
+	pglMapBufferRange = (PFNGLMAPBUFFERRANGEPROC)wglGetProcAddress("glMapBufferRange");
+	pglUnmapBuffer = (PFNGLUNMAPBUFFERPROC)wglGetProcAddress("glUnmapBuffer");
+	pglFenceSync = (PFNGLFENCESYNCPROC)wglGetProcAddress("glFenceSync");
+	pglClientWaitSync = (PFNGLCLIENTWAITSYNCPROC)wglGetProcAddress("glClientWaitSync");
+	pglDeleteSync = (PFNGLDELETESYNCPROC)wglGetProcAddress("glDeleteSync");
+	pglWaitSync = (PFNGLWAITSYNCPROC)wglGetProcAddress("glWaitSync");
+
+	// Not required, frame capture only scales frames if this is available
+	pglBlitFramebuffer = (PFNGLBLITFRAMEBUFFERPROC)wglGetProcAddress("glBlitFramebuffer");
+
+	// Not required, the AssetStreamer uploads from client memory without these
+	pglCopyBufferSubData = (PFNGLCOPYBUFFERSUBDATAPROC)wglGetProcAddress("glCopyBufferSubData");
+	pglBufferStorage = (PFNGLBUFFERSTORAGEPROC)wglGetProcAddress("glBufferStorage");
+
+	// Not required, GPUTimer::isSupported() checks for these
+	pglGenQueries = (PFNGLGENQUERIESPROC)wglGetProcAddress("glGenQueries");
+	pglDeleteQueries = (PFNGLDELETEQUERIESPROC)wglGetProcAddress("glDeleteQueries");
+	pglQueryCounter = (PFNGLQUERYCOUNTERPROC)wglGetProcAddress("glQueryCounter");
+	pglGetQueryObjectiv = (PFNGLGETQUERYOBJECTIVPROC)wglGetProcAddress("glGetQueryObjectiv");
+	pglGetQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VPROC)wglGetProcAddress("glGetQueryObjectui64v");
+	pglGetQueryiv = (PFNGLGETQUERYIVPROC)wglGetProcAddress("glGetQueryiv");
+	pglGetInteger64v = (PFNGLGETINTEGER64VPROC)wglGetProcAddress("glGetInteger64v");
+
+	pglActiveTexture = (PFNGLACTIVETEXTUREPROC)wglGetProcAddress("glActiveTexture");
+
+	if (!pglActiveTexture) {
+		BOOST_ASSERT_MSG(false, "Video card does NOT support glActiveTexture");
+	}
+
+#endif
+}
+
+} // end namespace
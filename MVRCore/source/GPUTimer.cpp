@@ -0,0 +1,252 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/GPUTimer.H"
+#include "MVRCore/Logger.H"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace MinVR {
+
+GPUTimer::GPUTimer(int numFrames) : _oldest(0), _numInFlight(0), _current(NULL), _hasGPUOrigin(false), _gpuOrigin(0),
+	_numFrames(0), _numTimed(0), _numSkipped(0)
+{
+	Slot empty;
+	empty.lastQuery = 0;
+	_slots.resize(std::max(numFrames, 1), empty);
+}
+
+GPUTimer::~GPUTimer()
+{
+}
+
+bool GPUTimer::isSupported()
+{
+#ifdef _WIN32
+	if (!pglGenQueries || !pglDeleteQueries || !pglQueryCounter || !pglGetQueryObjectiv || !pglGetQueryObjectui64v || !pglGetQueryiv || !pglGetInteger64v) {
+		return false;
+	}
+#endif
+
+	int major = 0;
+	int minor = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (version == NULL || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		return false;
+	}
+	bool supported = (major > 3) || (major == 3 && minor >= 3);
+	if (!supported) {
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		supported = (extensions != NULL) && (strstr(extensions, "GL_ARB_timer_query") != NULL);
+	}
+
+	// Timestamps may have no bits at all
+	GLint bits = 0;
+	if (supported) {
+		glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	}
+	return bits > 0;
+}
+
+double GPUTimer::toGPUSeconds(GLuint64 timestamp)
+{
+	// Relative to the first timestamp, since the GPU clock's epoch can be large enough to cost precision
+	if (!_hasGPUOrigin) {
+		_gpuOrigin = timestamp;
+		_hasGPUOrigin = true;
+	}
+	return (double)(boost::int64_t)(timestamp - _gpuOrigin) * 1.0e-9;
+}
+
+GLuint GPUTimer::getQuery(Slot &slot, size_t index)
+{
+	while (slot.queries.size() <= index) {
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		slot.queries.push_back(query);
+	}
+	return slot.queries[index];
+}
+
+void GPUTimer::beginFrame()
+{
+	if (_current) {
+		endFrame();
+	}
+	_numFrames++;
+
+	while (_numInFlight > 0 && readBackOldest()) {
+	}
+
+	// Read the CPU clock after the GPU's, so the delay of the call only ever adds to the difference
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	_clockSync.addSample(toGPUSeconds((GLuint64)gpuTime), TimeService::seconds());
+
+	if (_numInFlight == _slots.size()) {
+		_numSkipped++;
+		return;
+	}
+	_current = &_slots[(_oldest + _numInFlight) % _slots.size()];
+	_current->frame.frameNumber = _numFrames - 1;
+	_current->frame.sections.clear();
+	_openSections.clear();
+}
+
+void GPUTimer::beginSection(const std::string &name)
+{
+	if (!_current) {
+		return;
+	}
+	size_t index = _current->frame.sections.size();
+	_current->lastQuery = getQuery(*_current, 2 * index);
+	glQueryCounter(_current->lastQuery, GL_TIMESTAMP);
+
+	GPUSection section;
+	section.name = name;
+	section.depth = (int)_openSections.size();
+	section.cpuBegin = TimeService::seconds();
+	section.cpuEnd = section.cpuBegin;
+	section.gpuBegin = 0.0;
+	section.gpuEnd = 0.0;
+	_current->frame.sections.push_back(section);
+	_openSections.push_back(index);
+}
+
+void GPUTimer::endSection()
+{
+	if (!_current || _openSections.empty()) {
+		return;
+	}
+	size_t index = _openSections.back();
+	_openSections.pop_back();
+	_current->lastQuery = getQuery(*_current, 2 * index + 1);
+	glQueryCounter(_current->lastQuery, GL_TIMESTAMP);
+	_current->frame.sections[index].cpuEnd = TimeService::seconds();
+}
+
+void GPUTimer::endFrame()
+{
+	if (!_current) {
+		return;
+	}
+	while (!_openSections.empty()) {
+		endSection();
+	}
+	if (!_current->frame.sections.empty()) {
+		_numInFlight++;
+		_numTimed++;
+	}
+	_current = NULL;
+}
+
+bool GPUTimer::readBackOldest()
+{
+	Slot &slot = _slots[_oldest];
+
+	// Timestamps are written in order, so the frame is done once its last query is
+	GLint available = 0;
+	glGetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return false;
+	}
+
+	// Sections are told apart by the names of the sections they are nested in
+	std::vector<std::string> path;
+	for (size_t i = 0; i < slot.frame.sections.size(); i++) {
+		GPUSection &section = slot.frame.sections[i];
+		path.resize(section.depth);
+		path.push_back(section.name);
+		std::string key;
+		for (size_t p = 0; p < path.size(); p++) {
+			key += (p == 0 ? "" : "/") + path[p];
+		}
+
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(slot.queries[2 * i], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(slot.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		section.gpuBegin = _clockSync.toLocal(toGPUSeconds(begin));
+		section.gpuEnd = _clockSync.toLocal(toGPUSeconds(end));
+
+		double seconds = section.gpuEnd - section.gpuBegin;
+		size_t s = 0;
+		while (s < _stats.size() && _stats[s].key != key) {
+			s++;
+		}
+		if (s == _stats.size()) {
+			SectionStats stats = {key, section.name, section.depth, 0, 0.0, 0.0};
+			_stats.push_back(stats);
+		}
+		_stats[s].count++;
+		_stats[s].totalSeconds += seconds;
+		_stats[s].maxSeconds = std::max(_stats[s].maxSeconds, seconds);
+	}
+
+	std::swap(_lastFrame, slot.frame);
+	_oldest = (_oldest + 1) % _slots.size();
+	_numInFlight--;
+	return true;
+}
+
+void GPUTimer::logStats(const std::string &name)
+{
+	if (_numFrames == 0) {
+		return;
+	}
+	MINVR_LOG_INFO(Logger::core()) << name << ": " << _numTimed << " of " << _numFrames << " frames timed on the GPU, "
+		<< _numSkipped << " skipped with every frame of queries in flight.";
+	for (size_t s = 0; s < _stats.size(); s++) {
+		const SectionStats &stats = _stats[s];
+		MINVR_LOG_INFO(Logger::core()) << name << ": GPU " << std::string(2 * stats.depth, ' ') << stats.name << " "
+			<< 1000.0 * stats.totalSeconds / stats.count << " ms on average, " << 1000.0 * stats.maxSeconds << " ms at most.";
+	}
+}
+
+void GPUTimer::releaseGLObjects()
+{
+	for (size_t i = 0; i < _slots.size(); i++) {
+		if (!_slots[i].queries.empty()) {
+			glDeleteQueries((GLsizei)_slots[i].queries.size(), &_slots[i].queries[0]);
+			_slots[i].queries.clear();
+		}
+		_slots[i].lastQuery = 0;
+	}
+	_oldest = 0;
+	_numInFlight = 0;
+	_current = NULL;
+}
+
+} // end namespace
@@ -0,0 +1,121 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/IdleFrameSkipper.H"
+#include "MVRCore/Logger.H"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace MinVR {
+
+IdleFrameSkipper::IdleFrameSkipper(double motionThreshold, double rotationThreshold)
+{
+	_motionThreshold = motionThreshold;
+	_cosRotationThreshold = std::cos(rotationThreshold * glm::pi<double>() / 180.0);
+	_numDrawn = 0;
+	_numTimeouts = 0;
+	_secondsWaited = 0.0;
+}
+
+bool IdleFrameSkipper::movedSinceDrawn(EventRef event)
+{
+	std::map<std::string, glm::dmat4>::iterator drawn = _drawnPoses.find(event->getName());
+	if (drawn == _drawnPoses.end()) {
+		return true;
+	}
+	glm::dmat4 pose = event->getCoordinateFrameData();
+	if (glm::length(glm::dvec3(pose[3]) - glm::dvec3(drawn->second[3])) > _motionThreshold) {
+		return true;
+	}
+
+	// The angle of the rotation between the two poses, from the trace of its matrix
+	glm::dmat3 rotation = glm::transpose(glm::dmat3(drawn->second)) * glm::dmat3(pose);
+	double cosAngle = (rotation[0][0] + rotation[1][1] + rotation[2][2] - 1.0) / 2.0;
+	return cosAngle < _cosRotationThreshold;
+}
+
+bool IdleFrameSkipper::holdEvents(std::vector<EventRef> &events)
+{
+	bool changed = false;
+	for (size_t i = 0; i < events.size(); i++) {
+		EventRef event = events[i];
+		if (event->getType() == Event::EVENTTYPE_COORDINATEFRAME && !movedSinceDrawn(event)) {
+			// Only the latest pose of a tracker that has not moved is kept
+			size_t h = 0;
+			while (h < _heldEvents.size() && !(_heldEvents[h]->getType() == Event::EVENTTYPE_COORDINATEFRAME && _heldEvents[h]->getName() == event->getName())) {
+				h++;
+			}
+			if (h < _heldEvents.size()) {
+				_heldEvents.erase(_heldEvents.begin() + h);
+			}
+		}
+		else {
+			changed = true;
+		}
+		_heldEvents.push_back(event);
+	}
+	events.clear();
+	return changed;
+}
+
+void IdleFrameSkipper::frameDrawn(std::vector<EventRef> &events)
+{
+	if (!_heldEvents.empty()) {
+		events.insert(events.begin(), _heldEvents.begin(), _heldEvents.end());
+		_heldEvents.clear();
+	}
+	for (size_t i = 0; i < events.size(); i++) {
+		if (events[i]->getType() == Event::EVENTTYPE_COORDINATEFRAME) {
+			_drawnPoses[events[i]->getName()] = events[i]->getCoordinateFrameData();
+		}
+	}
+	_numDrawn++;
+}
+
+void IdleFrameSkipper::waited(double seconds, bool changed)
+{
+	_secondsWaited += seconds;
+	if (!changed) {
+		_numTimeouts++;
+	}
+}
+
+void IdleFrameSkipper::logStats()
+{
+	MINVR_LOG_INFO(Logger::core()) << "IdleFrameSkipper: " << _numDrawn << " frames drawn, " << _numTimeouts << " timeouts without a change, "
+		<< _secondsWaited << " s spent waiting for input.";
+}
+
+} // end namespace
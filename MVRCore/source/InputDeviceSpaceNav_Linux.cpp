@@ -61,6 +61,12 @@ InputDeviceSpaceNav::~InputDeviceSpaceNav() {
 	spnav_close();
 }
 
+bool InputDeviceSpaceNav::attachWakeSource(InputWakeSourceRef source)
+{
+	// spacenavd talks over a Unix socket, so there is nothing to poll until it is readable
+	return connected && source->watchFileDescriptor(spnav_fd());
+}
+
 void InputDeviceSpaceNav::pollForInput(std::vector<EventRef> &events) {
 	//Just sayin, the open source library is way nicer than the closed
 	if(connected){
@@ -0,0 +1,135 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/InputDeviceSynthetic.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/StringUtils.H"
+#include "MVRCore/TimeService.H"
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+// Polls after a long stall report at most this many samples, and skip the rest
+#define MAX_SAMPLES_PER_POLL 1000
+
+InputDeviceSynthetic::InputDeviceSynthetic(const std::string name, const ConfigMapRef map)
+{
+	std::vector<std::string> eventNames(1, "Head_Tracker");
+	if (map->containsKey(name + "_EventsToGenerate")) {
+		eventNames = splitStringIntoArray(map->get(name + "_EventsToGenerate", "Head_Tracker"));
+	}
+	BOOST_ASSERT_MSG(!eventNames.empty(), "InputDeviceSynthetic needs the name of its tracker event.");
+	_trackerEventName = eventNames[0];
+	if (eventNames.size() > 1) {
+		_buttonEventName = eventNames[1];
+	}
+
+	_rate = 120.0;
+	_delay = 0.0;
+	_center = glm::dvec3(0.0, 0.0, 1.0);
+	_amplitude = 0.1;
+	_period = 2.0;
+	_buttonPeriod = 1.0;
+	if (map->containsKey(name + "_Rate")) {
+		_rate = map->get(name + "_Rate", _rate);
+	}
+	if (map->containsKey(name + "_Delay")) {
+		_delay = map->get(name + "_Delay", 0.0) / 1000.0;
+	}
+	if (map->containsKey(name + "_Center")) {
+		_center = map->get(name + "_Center", _center);
+	}
+	if (map->containsKey(name + "_Amplitude")) {
+		_amplitude = map->get(name + "_Amplitude", _amplitude);
+	}
+	if (map->containsKey(name + "_Period")) {
+		_period = map->get(name + "_Period", _period);
+	}
+	if (map->containsKey(name + "_ButtonPeriod")) {
+		_buttonPeriod = map->get(name + "_ButtonPeriod", _buttonPeriod);
+	}
+	BOOST_ASSERT_MSG(_rate > 0.0, "InputDeviceSynthetic needs a positive rate.");
+	BOOST_ASSERT_MSG(_period > 0.0, "InputDeviceSynthetic needs a positive period.");
+
+	_start = TimeService::localTime();
+	_nextSample = 0;
+	_nextToggle = 1;
+
+	MINVR_LOG_INFO(Logger::core()) << "Synthetic device " << name << " sends " << _trackerEventName << " at " << _rate << " Hz with " << 1000.0 * _delay << " ms delay.";
+}
+
+InputDeviceSynthetic::~InputDeviceSynthetic()
+{
+}
+
+void InputDeviceSynthetic::pollForInput(std::vector<EventRef> &events)
+{
+	double elapsed = (TimeService::localTime() - _start).total_microseconds() / 1000000.0 - _delay;
+	if (elapsed < 0.0) {
+		return;
+	}
+
+	// Samples that fell behind a long stall would only add latency outliers
+	long lastSample = (long)(elapsed * _rate);
+	if (lastSample - _nextSample >= MAX_SAMPLES_PER_POLL) {
+		_nextSample = lastSample - MAX_SAMPLES_PER_POLL + 1;
+	}
+	for (; _nextSample <= lastSample; _nextSample++) {
+		double t = _nextSample / _rate;
+		glm::dvec3 position = _center + glm::dvec3(_amplitude * std::sin(2.0 * glm::pi<double>() * t / _period), 0.0, 0.0);
+		boost::posix_time::ptime due = _start + boost::posix_time::microseconds((long)(1000000.0 * t));
+		events.push_back(EventRef(new Event(_trackerEventName, glm::translate(glm::dmat4(1.0), position), nullptr, 0, due)));
+	}
+
+	if (_buttonEventName.empty() || _buttonPeriod <= 0.0) {
+		return;
+	}
+	long lastToggle = (long)(elapsed / _buttonPeriod);
+	if (lastToggle - _nextToggle >= MAX_SAMPLES_PER_POLL) {
+		_nextToggle = lastToggle - MAX_SAMPLES_PER_POLL + 1;
+	}
+	for (; _nextToggle <= lastToggle; _nextToggle++) {
+		boost::posix_time::ptime due = _start + boost::posix_time::microseconds((long)(1000000.0 * _nextToggle * _buttonPeriod));
+		// Odd toggles press the button, even ones release it
+		std::string suffix = (_nextToggle % 2 == 1) ? "_down" : "_up";
+		events.push_back(EventRef(new Event(_buttonEventName + suffix, nullptr, 0, due)));
+	}
+}
+
+} // end namespace
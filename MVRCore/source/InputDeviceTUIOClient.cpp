@@ -36,7 +36,7 @@
 
 #include "MVRCore/StringUtils.H"
 #include "MVRCore/ConfigMap.H"
-#include <list>
+#include "MVRCore/Logger.H"
 
 namespace MinVR {
 
@@ -44,21 +44,14 @@ namespace MinVR {
 
 using namespace TUIO;
 
-InputDeviceTUIOClient::InputDeviceTUIOClient(int port, double xScale, double yScale)
+InputDeviceTUIOClient::InputDeviceTUIOClient(int port, double xScale, double yScale, bool touchFrameEvents)
 {
 	_xScale = xScale;
 	_yScale = yScale;
-	_tuioClient = new TuioClient(port);
-	_tuioClient->connect();
-
-	if (!_tuioClient->isConnected())
-	{  
-		std::cout << "InputDeviceTUIOClient: Cannot connect on port " << port << "." << std::endl;
-	}
+	_touchFrameEvents = touchFrameEvents;
+	connect(port);
 }
 
-
-
 InputDeviceTUIOClient::InputDeviceTUIOClient(const std::string name, const ConfigMapRef map)
 {
 	int  port = map->get( name + "_Port", TUIO_PORT );
@@ -67,89 +60,272 @@ InputDeviceTUIOClient::InputDeviceTUIOClient(const std::string name, const Confi
 
 	_xScale = xs;
 	_yScale = ys;
+	_touchFrameEvents = map->containsKey(name + "_TouchFrameEvents") && map->get( name + "_TouchFrameEvents", false );
+	connect(port);
+}
+
+InputDeviceTUIOClient::~InputDeviceTUIOClient()
+{
+	if (_tuioClient) {
+		_tuioClient->removeTuioListener(this);
+		_tuioClient->disconnect();
+		delete _tuioClient;
+	}
+}
+
+void InputDeviceTUIOClient::connect(int port)
+{
 	_tuioClient = new TuioClient(port);
+	_tuioClient->addTuioListener(this);
 	_tuioClient->connect();
 
 	if (!_tuioClient->isConnected())
-	{ 
-		std::cout << "InputDeviceTUIOClient: Cannot connect on port " << port << "." << std::endl;
+	{  
+		MINVR_LOG_WARNING(Logger::core()) << "InputDeviceTUIOClient: Cannot connect on port " << port << ".";
 	}
 }
 
-InputDeviceTUIOClient::~InputDeviceTUIOClient()
+bool InputDeviceTUIOClient::attachWakeSource(InputWakeSourceRef source)
 {
-	if (_tuioClient) {
-		_tuioClient->disconnect();
-		delete _tuioClient;
+	// The TUIO receive thread calls notify() whenever it changes the state buffer
+	boost::mutex::scoped_lock lock(_stateMutex);
+	_wakeSource = source;
+	return true;
+}
+
+void InputDeviceTUIOClient::addTuioCursor(TuioCursor *tcur)
+{
+	boost::mutex::scoped_lock lock(_stateMutex);
+
+	// TUIO never reuses session ids, so a repeated add is a duplicate message
+	if (_cursorIndex.find(tcur->getSessionID()) != _cursorIndex.end()) {
+		return;
 	}
+
+	CursorState state;
+	state.sessionId = tcur->getSessionID();
+	state.cursorId = tcur->getCursorID();
+	state.position = glm::dvec2(_xScale*tcur->getX(), _yScale*tcur->getY());
+	state.speed = tcur->getMotionSpeed();
+	state.accel = tcur->getMotionAccel();
+	state.added = true;
+	state.updated = false;
+	state.removed = false;
+
+	_cursorIndex[state.sessionId] = _cursors.size();
+	_cursors.push_back(state);
+	notifyReactor();
 }
 
-void InputDeviceTUIOClient::pollForInput(std::vector<EventRef> &events)
+void InputDeviceTUIOClient::updateTuioCursor(TuioCursor *tcur)
 {
-	// Send out events for TUIO "cursors" by polling the TuioClient for the current state  
-	std::list<TuioCursor*> cursorList = _tuioClient->getTuioCursors();
-	//_tuioClient->lockCursorList();
-
-	// Send "button" up events for cursors that were down last frame, but are now up.
-	for ( auto downLast_it = _cursorsDown.begin(); downLast_it!= _cursorsDown.end(); ++downLast_it ) {
-		bool stillDown = false;
-		for (std::list<TuioCursor*>::iterator iter = cursorList.begin(); iter!=cursorList.end(); iter++) {
-			TuioCursor *tcur = (*iter);
-			if (tcur->getCursorID() == *downLast_it) {
-				stillDown = true;
-			}
+	boost::mutex::scoped_lock lock(_stateMutex);
+	auto it = _cursorIndex.find(tcur->getSessionID());
+	if (it == _cursorIndex.end()) {
+		return;
+	}
+
+	CursorState &state = _cursors[it->second];
+	if (state.removed) {
+		return;
+	}
+	state.position = glm::dvec2(_xScale*tcur->getX(), _yScale*tcur->getY());
+	state.speed = tcur->getMotionSpeed();
+	state.accel = tcur->getMotionAccel();
+	state.updated = true;
+	notifyReactor();
+}
+
+void InputDeviceTUIOClient::removeTuioCursor(TuioCursor *tcur)
+{
+	boost::mutex::scoped_lock lock(_stateMutex);
+	auto it = _cursorIndex.find(tcur->getSessionID());
+	if (it != _cursorIndex.end()) {
+		_cursors[it->second].removed = true;
+		notifyReactor();
+	}
+}
+
+void InputDeviceTUIOClient::addTuioObject(TuioObject *tobj)
+{
+	boost::mutex::scoped_lock lock(_stateMutex);
+	auto it = _objectIndex.find(tobj->getSessionID());
+	size_t index;
+	if (it == _objectIndex.end()) {
+		index = _objects.size();
+		_objectIndex[tobj->getSessionID()] = index;
+		_objects.push_back(ObjectState());
+		_objects[index].sessionId = tobj->getSessionID();
+	}
+	else {
+		index = it->second;
+	}
+
+	ObjectState &state = _objects[index];
+	state.symbolId = tobj->getSymbolID();
+	state.data = glm::dvec3(_xScale*tobj->getX(), _yScale*tobj->getY(), tobj->getAngle()/M_PI*180.0);
+	state.updated = true;
+	notifyReactor();
+}
+
+void InputDeviceTUIOClient::updateTuioObject(TuioObject *tobj)
+{
+	addTuioObject(tobj);
+}
+
+void InputDeviceTUIOClient::removeTuioObject(TuioObject *tobj)
+{
+	boost::mutex::scoped_lock lock(_stateMutex);
+	auto it = _objectIndex.find(tobj->getSessionID());
+	if (it == _objectIndex.end()) {
+		return;
+	}
+
+	// Swap the last object into the freed slot so the buffer stays contiguous
+	size_t index = it->second;
+	_objectIndex.erase(it);
+	if (index != _objects.size() - 1) {
+		_objects[index] = _objects.back();
+		_objectIndex[_objects[index].sessionId] = index;
+	}
+	_objects.pop_back();
+}
+
+void InputDeviceTUIOClient::refresh(TuioTime frameTime)
+{
+}
+
+void InputDeviceTUIOClient::notifyReactor()
+{
+	if (_wakeSource) {
+		_wakeSource->notify();
+	}
+}
+
+const InputDeviceTUIOClient::CursorEventNames& InputDeviceTUIOClient::getCursorEventNames(int cursorId)
+{
+	// TUIO reuses small cursor ids, so the names are built once per id and then looked up
+	if (cursorId >= _cursorEventNames.size()) {
+		size_t first = _cursorEventNames.size();
+		_cursorEventNames.resize(cursorId + 1);
+		for (size_t i = first; i < _cursorEventNames.size(); i++) {
+			std::string id = intToString(i);
+			_cursorEventNames[i].down = "TUIO_Cursor" + id + "_down";
+			_cursorEventNames[i].up = "TUIO_Cursor" + id + "_up";
+			_cursorEventNames[i].move = "TUIO_CursorMove" + id;
 		}
-		if (!stillDown) {
-			events.push_back(EventRef(new Event("TUIO_Cursor" + intToString(*downLast_it) + "_up", nullptr, *downLast_it)));
-			_cursorsDown.erase (downLast_it);
+	}
+	return _cursorEventNames[cursorId];
+}
+
+const std::string& InputDeviceTUIOClient::getObjectEventName(int symbolId)
+{
+	if (symbolId >= _objectEventNames.size()) {
+		size_t first = _objectEventNames.size();
+		_objectEventNames.resize(symbolId + 1);
+		for (size_t i = first; i < _objectEventNames.size(); i++) {
+			_objectEventNames[i] = "TUIO_Obj" + intToString(i);
 		}
 	}
+	return _objectEventNames[symbolId];
+}
 
-	// Send "button" down events for cursors that are new and updated positions for all cursors
-	for (std::list<TuioCursor*>::iterator iter = cursorList.begin(); iter!=cursorList.end(); iter++) {
-		TuioCursor *tcur = (*iter);
-		glm::dvec2 pos = glm::vec2(_xScale*tcur->getX(), _yScale*tcur->getY());
+void InputDeviceTUIOClient::pollForInput(std::vector<EventRef> &events)
+{
+	boost::mutex::scoped_lock lock(_stateMutex);
 
-		if (_cursorsDown.find(tcur->getCursorID()) != _cursorsDown.end()) {
-			events.push_back(EventRef(new Event("TUIO_Cursor" + intToString(tcur->getCursorID()) + "_down", pos, nullptr, tcur->getCursorID())));
-			_cursorsDown.insert(tcur->getCursorID());
-		}
+	if (_touchFrameEvents) {
+		emitTouchFrameEvent(events);
+	}
+	else {
+		emitCursorEvents(events);
+	}
+	removeReleasedCursors();
 
-		if (tcur->getMotionSpeed() > 0.0) {
-			glm::dvec4 data = glm::vec4(pos, tcur->getMotionSpeed(), tcur->getMotionAccel());
-			events.push_back(EventRef(new Event("TUIO_CursorMove" + intToString(tcur->getCursorID()), data, nullptr, tcur->getCursorID())));
+	// Unsure what TUIO "objects" are -- perhaps tangible props. Events are sent for objects that were added or moved.
+	for (int i = 0; i < _objects.size(); i++) {
+		ObjectState &state = _objects[i];
+		if (state.updated && state.symbolId >= 0) {
+			events.push_back(EventRef(new Event(getObjectEventName(state.symbolId), state.data)));
 		}
+		state.updated = false;
+	}
+}
 
-		// Can also access several other properties of cursors (speed, acceleration, path followed, etc.)
-		//std::cout << "cur " << tcur->getCursorID() << " (" <<  tcur->getSessionID() << ") " << tcur->getX() << " " << tcur->getY() 
-		// << " " << tcur->getMotionSpeed() << " " << tcur->getMotionAccel() << " " << std::endl;
+void InputDeviceTUIOClient::emitCursorEvents(std::vector<EventRef> &events)
+{
+	for (int i = 0; i < _cursors.size(); i++) {
+		const CursorState &state = _cursors[i];
+		if (state.cursorId < 0) {
+			continue;
+		}
+		const CursorEventNames &names = getCursorEventNames(state.cursorId);
 
-		// This is how to access all the points in the path that a cursor follows:     
-		//std::list<TuioPoint> path = tuioCursor->getPath();
-		//if (path.size() > 0) {
-		//  TuioPoint last_point = path.front();
-		//  for (std::list<TuioPoint>::iterator point = path.begin(); point!=path.end(); point++) {
-		//    last_point.update(point->getX(),point->getY());   
-		//  }
-		//}
+		if (state.added) {
+			events.push_back(EventRef(new Event(names.down, state.position, nullptr, state.cursorId)));
+		}
+		if (state.updated) {
+			events.push_back(EventRef(new Event(names.move, glm::dvec4(state.position, state.speed, state.accel), nullptr, state.cursorId)));
+		}
+		if (state.removed) {
+			events.push_back(EventRef(new Event(names.up, nullptr, state.cursorId)));
+		}
 	}
-	_tuioClient->unlockCursorList();
+}
 
+void InputDeviceTUIOClient::emitTouchFrameEvent(std::vector<EventRef> &events)
+{
+	bool changed = false;
+	_touchFrame.clear();
+	for (int i = 0; i < _cursors.size(); i++) {
+		const CursorState &state = _cursors[i];
+		TouchContact contact;
+		contact.id = state.cursorId;
+		contact.sessionId = state.sessionId;
+		contact.position = state.position;
+		contact.speed = state.speed;
+		contact.accel = state.accel;
+		if (state.removed) {
+			contact.phase = TouchContact::TOUCH_UP;
+		}
+		else if (state.added) {
+			contact.phase = TouchContact::TOUCH_DOWN;
+		}
+		else if (state.updated) {
+			contact.phase = TouchContact::TOUCH_MOVE;
+		}
+		else {
+			contact.phase = TouchContact::TOUCH_STATIONARY;
+		}
+		changed = changed || (contact.phase != TouchContact::TOUCH_STATIONARY);
+		_touchFrame.push_back(contact);
+	}
 
-	// Unsure what TUIO "objects" are -- perhaps tangible props.  In any case, this is how to access object data:
-	std::list<TuioObject*> objectList = _tuioClient->getTuioObjects();
-	_tuioClient->lockObjectList();
-	for (std::list<TuioObject*>::iterator iter = objectList.begin(); iter!=objectList.end(); iter++) {
-		TuioObject* tuioObject = (*iter);    
-		int   id    = tuioObject->getSymbolID();
-		double xpos  = _xScale*tuioObject->getX();
-		double ypos  = _yScale*tuioObject->getY();
-		double angle = tuioObject->getAngle()/M_PI*180.0;
+	if (changed) {
+		events.push_back(EventRef(new Event("TUIO_TouchFrame", _touchFrame)));
+	}
+}
 
-		std::string name = "TUIO_Obj" + intToString(id);
-		events.push_back(EventRef(new Event(name, glm::dvec3(xpos, ypos, angle))));
+void InputDeviceTUIOClient::removeReleasedCursors()
+{
+	size_t i = 0;
+	while (i < _cursors.size()) {
+		CursorState &state = _cursors[i];
+		if (state.removed) {
+			// Swap the last cursor into the freed slot and look at slot i again
+			_cursorIndex.erase(state.sessionId);
+			if (i != _cursors.size() - 1) {
+				state = _cursors.back();
+				_cursorIndex[state.sessionId] = i;
+			}
+			_cursors.pop_back();
+		}
+		else {
+			state.added = false;
+			state.updated = false;
+			i++;
+		}
 	}
-	_tuioClient->unlockObjectList();
 }
 
 #endif //USE_TUIO
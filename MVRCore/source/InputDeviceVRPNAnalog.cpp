@@ -49,7 +49,7 @@ namespace MinVR {
 void VRPN_CALLBACK analogHandler(void *thisPtr, const vrpn_ANALOGCB info)
 {
 	int lastchannel = (int)glm::min(info.num_channel, (int)((InputDeviceVRPNAnalog*)thisPtr)->numChannels());
-	boost::posix_time::ptime msgTime = boost::posix_time::microsec_clock::local_time();
+	boost::posix_time::ptime msgTime = ((InputDeviceVRPNAnalog*)thisPtr)->stampReport(info.msg_time);
 	for (int i=0;i<lastchannel;i++) {
 		((InputDeviceVRPNAnalog*)thisPtr)->sendEventIfChanged(i, info.channel[i], msgTime);
 	}
@@ -62,7 +62,11 @@ InputDeviceVRPNAnalog::InputDeviceVRPNAnalog(const std::string &vrpnAnalogDevice
 		_channelValues.push_back(0.0);
 	}
 
-	_vrpnDevice = new vrpn_Analog_Remote(vrpnAnalogDeviceName.c_str());
+	setReportPolicy(InputReportPolicy());
+
+	_connection = VRPNConnectionRegistry::getConnection(vrpnAnalogDeviceName);
+	_connectionSlot = _connection->addDevice();
+	_vrpnDevice = new vrpn_Analog_Remote(vrpnAnalogDeviceName.c_str(), _connection->getConnection());
 	if (!_vrpnDevice) {
 		std::stringstream ss;
 		ss << "Can't create VRPN Remote Analog with name" + vrpnAnalogDeviceName;
@@ -77,16 +81,21 @@ InputDeviceVRPNAnalog::InputDeviceVRPNAnalog(const std::string name, const Confi
 	std::string  vrpnname = map->get( name + "_InputDeviceVRPNAnalogName", "" );
 	std::string  events   = map->get( name + "_EventsToGenerate", "" );
 
-	boost::log::sources::logger logger;
-	logger.add_attribute("Tag", boost::log::attributes::constant< std::string >("MinVR Core"));
-	BOOST_LOG(logger) << "Creating new InputDeviceVRPNAnalog (" + vrpnname + ")";
+	MINVR_LOG_INFO(Logger::core()) << "Creating new InputDeviceVRPNAnalog (" << vrpnname << ")";
 
 	_eventNames = splitStringIntoArray( events );
 	for (int i=0;i<_eventNames.size();i++) { 
 		_channelValues.push_back(0.0);
 	}
 
-	_vrpnDevice = new vrpn_Analog_Remote(vrpnname.c_str());
+	setReportPolicy(InputReportPolicy(name, map));
+
+	_connection = VRPNConnectionRegistry::getConnection(vrpnname);
+	_connectionSlot = _connection->addDevice();
+	if (map->containsKey(name + "_SyncDeviceClock") && map->get(name + "_SyncDeviceClock", false)) {
+		_connection->enableClockSync();
+	}
+	_vrpnDevice = new vrpn_Analog_Remote(vrpnname.c_str(), _connection->getConnection());
 	if (!_vrpnDevice) { 
 		std::stringstream ss;
 		ss << "Can't create VRPN Remote Analog with name" + vrpnname;
@@ -113,20 +122,82 @@ std::string	InputDeviceVRPNAnalog::getEventName(int channelNumber)
 void InputDeviceVRPNAnalog::sendEventIfChanged(int channelNumber, double data, const boost::posix_time::ptime &msg_time)
 {
 	if (_channelValues[channelNumber] != data) {
-		_pendingEvents.push_back(EventRef(new Event(_eventNames[channelNumber], data, nullptr, channelNumber, msg_time)));
 		_channelValues[channelNumber] = data;
+
+		if (_reportPolicy.keepsHistory()) {
+			if (_historyReadPending) {
+				markHistoryRead();
+			}
+			InputSample sample;
+			sample.timestamp = msg_time;
+			sample.value = data;
+			_history[channelNumber].push(sample);
+		}
+
+		int index = _reportPolicy.placeReport(channelNumber, msg_time, _pendingChannels.size());
+		if (index == (int)_pendingChannels.size()) {
+			_pendingChannels.push_back(channelNumber);
+			_pendingValues.push_back(data);
+			_pendingTimes.push_back(msg_time);
+		}
+		else if (index >= 0) {
+			_pendingValues[index] = data;
+			_pendingTimes[index] = msg_time;
+		}
 	}
 }
 
 void InputDeviceVRPNAnalog::pollForInput(std::vector<EventRef> &events)
 {
-	_vrpnDevice->mainloop();
-	if (_pendingEvents.size()) {
-		for(auto pending_it=_pendingEvents.begin(); pending_it != _pendingEvents.end(); ++ pending_it) {
-			events.push_back(*pending_it);
+	// Another device's pass over the shared connection may already have delivered samples after
+	// the last poll, which then marked the history read. Otherwise mark it read before polling.
+	if (_historyReadPending) {
+		markHistoryRead();
+	}
+	if (!_connection->poll(_connectionSlot)) {
+		_vrpnDevice->mainloop();
+	}
+
+	for (size_t i = 0; i < _pendingChannels.size(); i++) {
+		int channelNumber = _pendingChannels[i];
+		events.push_back(EventRef(new Event(_eventNames[channelNumber], _pendingValues[i], nullptr, channelNumber, _pendingTimes[i])));
+	}
+	_pendingChannels.clear();
+	_pendingValues.clear();
+	_pendingTimes.clear();
+	_reportPolicy.pendingReportsConsumed();
+
+	// The app reads the history after this poll, so the samples that arrive from now on are the next frame's
+	_historyReadPending = true;
+}
+
+void InputDeviceVRPNAnalog::markHistoryRead()
+{
+	for (size_t c = 0; c < _history.size(); c++) {
+		_history[c].markRead();
+	}
+	_historyReadPending = false;
+}
+
+void InputDeviceVRPNAnalog::setReportPolicy(const InputReportPolicy &policy)
+{
+	_reportPolicy = policy;
+	_reportPolicy.setNumSensors(_eventNames.size());
+	_history.clear();
+	_historyReadPending = false;
+	if (_reportPolicy.keepsHistory()) {
+		_history.resize(_eventNames.size(), SampleRing<InputSample>(_reportPolicy.getHistorySize()));
+	}
+}
+
+const SampleRing<InputSample>* InputDeviceVRPNAnalog::getSampleHistory(const std::string &eventName)
+{
+	for (size_t c = 0; c < _history.size(); c++) {
+		if (_eventNames[c] == eventName) {
+			return &_history[c];
 		}
-		_pendingEvents.clear();
 	}
+	return nullptr;
 }
 
 
@@ -49,7 +49,7 @@ namespace MinVR {
 
 void  VRPN_CALLBACK	buttonHandler(void *thisPtr, const vrpn_BUTTONCB info)
 {
-	boost::posix_time::ptime msgTime = boost::posix_time::microsec_clock::local_time();
+	boost::posix_time::ptime msgTime = ((InputDeviceVRPNButton*)thisPtr)->stampReport(info.msg_time);
 
 	((InputDeviceVRPNButton*)thisPtr)->sendEvent(info.button, info.state, msgTime);
 }
@@ -60,7 +60,9 @@ InputDeviceVRPNButton::InputDeviceVRPNButton(const std::string &vrpnButtonDevice
 {
 	_eventNames = eventsToGenerate;
 
-	_vrpnDevice = new vrpn_Button_Remote(vrpnButtonDeviceName.c_str());
+	_connection = VRPNConnectionRegistry::getConnection(vrpnButtonDeviceName);
+	_connectionSlot = _connection->addDevice();
+	_vrpnDevice = new vrpn_Button_Remote(vrpnButtonDeviceName.c_str(), _connection->getConnection());
 	if (!_vrpnDevice) {
 		std::stringstream ss;
 		ss << "Can't create VRPN Remote Button with name " + vrpnButtonDeviceName;
@@ -75,13 +77,16 @@ InputDeviceVRPNButton::InputDeviceVRPNButton(const std::string name, const Confi
 	std::string vrpnname = map->get( name + "_InputDeviceVRPNButtonName", "" );
 	std::string events   = map->get( name + "_EventsToGenerate","" );
 
-	boost::log::sources::logger logger;
-	logger.add_attribute("Tag", boost::log::attributes::constant< std::string >("MinVR Core"));
-	BOOST_LOG(logger) << "Creating new InputDeviceVRPNButton (" + vrpnname + ")";
+	MINVR_LOG_INFO(Logger::core()) << "Creating new InputDeviceVRPNButton (" << vrpnname << ")";
 
 	_eventNames = splitStringIntoArray( events );
 
-	_vrpnDevice = new vrpn_Button_Remote(vrpnname.c_str());
+	_connection = VRPNConnectionRegistry::getConnection(vrpnname);
+	_connectionSlot = _connection->addDevice();
+	if (map->containsKey(name + "_SyncDeviceClock") && map->get(name + "_SyncDeviceClock", false)) {
+		_connection->enableClockSync();
+	}
+	_vrpnDevice = new vrpn_Button_Remote(vrpnname.c_str(), _connection->getConnection());
 	if (!_vrpnDevice) {
 		std::stringstream ss;
 		ss << "Can't create VRPN Remote Button with name " + vrpnname;
@@ -118,7 +123,9 @@ void InputDeviceVRPNButton::sendEvent(int buttonNumber, bool down, const boost::
 
 void InputDeviceVRPNButton::pollForInput(std::vector<EventRef> &events)
 {
-	_vrpnDevice->mainloop();
+	if (!_connection->poll(_connectionSlot)) {
+		_vrpnDevice->mainloop();
+	}
 	if (_pendingEvents.size()) {
 		for(auto pending_it = _pendingEvents.begin(); pending_it != _pendingEvents.end(); ++ pending_it) {
 			events.push_back(*pending_it);
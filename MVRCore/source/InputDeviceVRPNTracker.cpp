@@ -41,6 +41,7 @@
 #include <vrpn_Tracker.h>
 
 #include <iostream>
+#include <boost/chrono.hpp>
 using namespace std;
 
 namespace MinVR {
@@ -54,13 +55,10 @@ namespace MinVR {
 // Callback function for VRPN, void* pointer points to a VRPNTrackerDevice
 void VRPN_CALLBACK trackerHandler(void *thisPtr, const vrpn_TRACKERCB info)
 {
-	glm::dmat4 vrpnEvent;
-	vrpnEvent = glm::mat4_cast(glm::quat(info.quat[3],info.quat[0], info.quat[1],info.quat[2]));
-	vrpnEvent = glm::column(vrpnEvent, 3, glm::dvec4(info.pos[0],info.pos[1],info.pos[2], 1.0));
-
 	InputDeviceVRPNTracker* device = ((InputDeviceVRPNTracker*)thisPtr);
-	boost::posix_time::ptime msgTime = boost::posix_time::microsec_clock::local_time();
-	device->processEvent(vrpnEvent, info.sensor, msgTime);
+	boost::posix_time::ptime msgTime = device->stampReport(info.msg_time);
+	device->bufferReport(info.sensor, glm::dquat(info.quat[3], info.quat[0], info.quat[1], info.quat[2]),
+		glm::dvec3(info.pos[0], info.pos[1], info.pos[2]), msgTime);
 }
 
 InputDeviceVRPNTracker::InputDeviceVRPNTracker(
@@ -80,11 +78,17 @@ InputDeviceVRPNTracker::InputDeviceVRPNTracker(
 	_propToTracker                = propToTracker;
 	_finalOffset                  = finalOffset;
 	_waitForNewReport             = waitForNewReportInPoll;
+	_waitForNewReportTimeout      = 2.0;
 	_convertLHtoRH                = convertLHtoRH;
 	_ignoreZeroes                 = ignoreZeroes;
+	_newReportFlag                = false;
 	_printSensor0                 = false;
+	precomposeTransforms();
+	setReportPolicy(InputReportPolicy());
 
-	_vrpnDevice = new vrpn_Tracker_Remote(vrpnTrackerDeviceName.c_str());
+	_connection = VRPNConnectionRegistry::getConnection(vrpnTrackerDeviceName);
+	_connectionSlot = _connection->addDevice();
+	_vrpnDevice = new vrpn_Tracker_Remote(vrpnTrackerDeviceName.c_str(), _connection->getConnection());
 	std::stringstream ss;
 	ss << "Can't create VRPN Remote Tracker with name " + vrpnTrackerDeviceName;
 	BOOST_ASSERT_MSG(_vrpnDevice, ss.str().c_str());
@@ -154,12 +158,11 @@ InputDeviceVRPNTracker::InputDeviceVRPNTracker( const std::string name, const Co
 	}
 
 	bool wait          = map->get( name + "_WaitForNewReportInPoll", false );
+	double waitTimeout = map->containsKey(name + "_WaitForNewReportTimeout") ? map->get( name + "_WaitForNewReportTimeout", 2.0 ) : 2.0;
 	bool convertLHtoRH = map->get( name + "_ConvertLHtoRH", false );
 	bool ignoreZeroes  = map->get( name + "_IgnoreZeroes", false );
 
-	boost::log::sources::logger logger;
-	logger.add_attribute("Tag", boost::log::attributes::constant< std::string >("MinVR Core"));
-	BOOST_LOG(logger) << "Creating new InputDeviceVRPNTracker ( " + vrpnname + ")";
+	MINVR_LOG_INFO(Logger::core()) << "Creating new InputDeviceVRPNTracker ( " << vrpnname << ")";
 
 	_eventNames                   = events;
 	_trackerUnitsToRoomUnitsScale = scale;
@@ -167,12 +170,20 @@ InputDeviceVRPNTracker::InputDeviceVRPNTracker( const std::string name, const Co
 	_propToTracker                = p2t;
 	_finalOffset                  = fo;
 	_waitForNewReport             = wait;
+	_waitForNewReportTimeout      = waitTimeout;
 	_convertLHtoRH                = convertLHtoRH;
 	_ignoreZeroes                 = ignoreZeroes;
+	_newReportFlag                = false;
 	_printSensor0                 = false;
+	precomposeTransforms();
+	setReportPolicy(InputReportPolicy(name, map));
 
-	_vrpnConnection = vrpn_get_connection_by_name(vrpnname.c_str());
-	_vrpnDevice = new vrpn_Tracker_Remote(vrpnname.c_str(), _vrpnConnection);
+	_connection = VRPNConnectionRegistry::getConnection(vrpnname);
+	_connectionSlot = _connection->addDevice();
+	if (map->containsKey(name + "_SyncDeviceClock") && map->get(name + "_SyncDeviceClock", false)) {
+		_connection->enableClockSync();
+	}
+	_vrpnDevice = new vrpn_Tracker_Remote(vrpnname.c_str(), _connection->getConnection());
 	std::stringstream ss;
 	ss <<  "Can't create VRPN Remote Tracker with name " + vrpnname;
 	BOOST_ASSERT_MSG(_vrpnDevice, ss.str().c_str());
@@ -195,52 +206,162 @@ by a transformation that transforms stuff in device space to IS3D
 room space.  You can think of this as what rotation, then
 translation would move the origin of RoomSpace to the origin of
 tracking device.  This is the deviceToRoom coordinate frame.
+
+Everything except the report itself is constant, so
+_finalOffset[s] * _deviceToRoom and _propToTracker[s] are combined
+once here and each report only needs two compositions.
 */
-void InputDeviceVRPNTracker::processEvent(const glm::dmat4 &vrpnEvent, int sensorNum, const boost::posix_time::ptime &msg_time)
+void InputDeviceVRPNTracker::precomposeTransforms()
 {
+	size_t numSensors = _eventNames.size();
+	_preMatrices.resize(numSensors + 1);
+	_postMatrices.resize(numSensors + 1);
+	for (size_t s = 0; s < numSensors; s++) {
+		glm::dmat4 finalOffset = s < _finalOffset.size() ? _finalOffset[s] : glm::dmat4(1.0);
+		_preMatrices[s] = finalOffset * _deviceToRoom;
+		_postMatrices[s] = s < _propToTracker.size() ? _propToTracker[s] : glm::dmat4(1.0);
+	}
+	// Reports from sensors that have no event name
+	_preMatrices[numSensors] = _deviceToRoom;
+	_postMatrices[numSensors] = glm::dmat4(1.0);
+
+	// Quaternions cannot represent reflections, so fall back to matrices if any of the
+	// calibration frames contains one.
+	_useRigidTransforms = true;
+	_preTransforms.resize(numSensors + 1);
+	_postTransforms.resize(numSensors + 1);
+	for (size_t s = 0; s <= numSensors; s++) {
+		if (!RigidTransform::fromMatrix(_preMatrices[s], _preTransforms[s]) ||
+			!RigidTransform::fromMatrix(_postMatrices[s], _postTransforms[s])) {
+			_useRigidTransforms = false;
+		}
+	}
+}
 
-	if(_ignoreZeroes && glm::column(vrpnEvent, 3) == glm::dvec4(0.0, 0.0, 0.0, 1.0)){
+void InputDeviceVRPNTracker::bufferReport(int sensorNum, const glm::dquat &rotation, const glm::dvec3 &translation, const boost::posix_time::ptime &msg_time)
+{
+	if (_ignoreZeroes && translation == glm::dvec3(0.0, 0.0, 0.0)) {
 		return;
 	}
 	_newReportFlag = true;
 
-	// first, adjust units of trackerToDevice.  after this, everything
-	// is in RoomSpace units (typically feet for VRG3D).
-	glm::dmat4 trackerToDevice = vrpnEvent;
+	glm::dquat rot = rotation;
+	glm::dvec3 trans = translation;
 
 	// convert a left handed coordinate system to a right handed one
-	// not sure if this actually works..
 	if (_convertLHtoRH) {
-		/*** This is code from syzygy..
-		CoordinateFrame switchMat(Matrix3(1,0,0, 0,0,1, 0,-1,0), Vector3::zero());
-		CoordinateFrame transMat(switchMat.inverse() * vrpnEvent.translation);
-		CoordinateFrame rotMat(vrpnEvent.rotation, Vector3::zero());
-		trackerToDevice = transMat * switchMat.inverse() * rotMat * switchMat;
-		***/
-
 		// This code is based on the article "Conversion of Left-Handed
 		// Coordinates to Right-Handed Coordinates" by David Eberly,
 		// available online:
 		// http://www.geometrictools.com/Documentation/LeftHandedToRightHanded.pdf
-		trackerToDevice[3][2] = -trackerToDevice[3][2];
+		// Reflecting z on both sides of the rotation negates the x and y parts of the quaternion.
+		rot = glm::dquat(rot.w, -rot.x, -rot.y, rot.z);
+		trans.z = -trans.z;
+	}
 
-		trackerToDevice[2][0] = -trackerToDevice[2][0];
-		trackerToDevice[2][1] = -trackerToDevice[2][1];
-		trackerToDevice[0][2] = -trackerToDevice[0][2];
-		trackerToDevice[1][2] = -trackerToDevice[1][2];
+	int sensor = sensorNum;
+	if (sensor < 0 || sensor >= (int)_eventNames.size()) {
+		sensor = (int)_eventNames.size();
 	}
 
-	trackerToDevice[3][0] *= _trackerUnitsToRoomUnitsScale;
-	trackerToDevice[3][1] *= _trackerUnitsToRoomUnitsScale;
-	trackerToDevice[3][2] *= _trackerUnitsToRoomUnitsScale;
+	if (_reportPolicy.keepsHistory()) {
+		if (_historyReadPending) {
+			markHistoryRead();
+		}
+		InputSample sample;
+		sample.timestamp = msg_time;
+		transform(&sensor, &rot, &trans, 1, &sample.frame);
+		_history[sensor].push(sample);
+	}
 
-	glm::dmat4 eventRoom = _finalOffset[sensorNum] * _deviceToRoom * trackerToDevice * _propToTracker[sensorNum];
+	int index = _reportPolicy.placeReport(sensor, msg_time, _reportSensors.size());
+	if (index == (int)_reportSensors.size()) {
+		_reportSensors.push_back(sensor);
+		_reportRotations.push_back(rot);
+		_reportTranslations.push_back(trans);
+		_reportTimes.push_back(msg_time);
+	}
+	else if (index >= 0) {
+		_reportRotations[index] = rot;
+		_reportTranslations[index] = trans;
+		_reportTimes[index] = msg_time;
+	}
+}
 
-	if ((_printSensor0) && (sensorNum == 0)) {
-		glm::dvec4 translation = glm::column(eventRoom, 3);
-		std::cout << translation << std::endl;
+void InputDeviceVRPNTracker::transform(const int* sensors, const glm::dquat* rotations, const glm::dvec3* translations, size_t count, glm::dmat4* results)
+{
+	if (_useRigidTransforms) {
+		RigidTransform::transformBatch(&_preTransforms[0], &_postTransforms[0], sensors,
+			rotations, translations, _trackerUnitsToRoomUnitsScale, count, results);
+	}
+	else {
+		for (size_t i = 0; i < count; i++) {
+			// first, adjust units of trackerToDevice.  after this, everything
+			// is in RoomSpace units (typically feet for VRG3D).
+			glm::dmat4 trackerToDevice = glm::mat4_cast(rotations[i]);
+			trackerToDevice[3] = glm::dvec4(translations[i] * _trackerUnitsToRoomUnitsScale, 1.0);
+			results[i] = _preMatrices[sensors[i]] * trackerToDevice * _postMatrices[sensors[i]];
+		}
 	}
-	_pendingEvents.push_back(EventRef(new Event(getEventName(sensorNum), eventRoom, nullptr, sensorNum, msg_time)));
+}
+
+void InputDeviceVRPNTracker::transformReports(std::vector<EventRef> &events)
+{
+	_newReportFlag = false;
+	// The app reads the history after this poll, so the samples that arrive from now on are the next frame's
+	_historyReadPending = true;
+
+	size_t count = _reportSensors.size();
+	if (count == 0) {
+		return;
+	}
+	_reportResults.resize(count);
+	transform(&_reportSensors[0], &_reportRotations[0], &_reportTranslations[0], count, &_reportResults[0]);
+
+	for (size_t i = 0; i < count; i++) {
+		int sensorNum = _reportSensors[i];
+		if ((_printSensor0) && (sensorNum == 0)) {
+			glm::dvec4 translation = glm::column(_reportResults[i], 3);
+			std::cout << translation << std::endl;
+		}
+		events.push_back(EventRef(new Event(getEventName(sensorNum), _reportResults[i], nullptr, sensorNum, _reportTimes[i])));
+	}
+
+	_reportSensors.clear();
+	_reportRotations.clear();
+	_reportTranslations.clear();
+	_reportTimes.clear();
+	_reportPolicy.pendingReportsConsumed();
+}
+
+void InputDeviceVRPNTracker::setReportPolicy(const InputReportPolicy &policy)
+{
+	_reportPolicy = policy;
+	// One extra slot for sensors that have no event name
+	_reportPolicy.setNumSensors(_eventNames.size() + 1);
+	_history.clear();
+	_historyReadPending = false;
+	if (_reportPolicy.keepsHistory()) {
+		_history.resize(_eventNames.size() + 1, SampleRing<InputSample>(_reportPolicy.getHistorySize()));
+	}
+}
+
+void InputDeviceVRPNTracker::markHistoryRead()
+{
+	for (size_t s = 0; s < _history.size(); s++) {
+		_history[s].markRead();
+	}
+	_historyReadPending = false;
+}
+
+const SampleRing<InputSample>* InputDeviceVRPNTracker::getSampleHistory(const std::string &eventName)
+{
+	for (size_t s = 0; s < _history.size() && s < _eventNames.size(); s++) {
+		if (_eventNames[s] == eventName) {
+			return &_history[s];
+		}
+	}
+	return nullptr;
 }
 
 std::string InputDeviceVRPNTracker::getEventName(int trackerNumber)
@@ -257,21 +378,37 @@ void InputDeviceVRPNTracker::pollForInput(std::vector<EventRef> &events)
 	// the most recent tracker records will be dropped, introducing lag in the system.
 	// A workaround suggested by the VRPN website is to keep calling mainloop() until you
 	// get a new tracker report.  This should only really be an issue if your framerate
-	// is low.
-	if (_waitForNewReport) {
-		_newReportFlag = false;
-		while (!_newReportFlag) {
-			_vrpnDevice->mainloop();
-		}
+	// is low.  Rather than spinning, the connection's mainloop blocks in select() on its
+	// sockets until data arrives, and we give up after _waitForNewReportTimeout ms.
+	// Devices on the same server share one pass over the connection per poll round, which
+	// may already have buffered this tracker's reports when another device started it, so
+	// the flag is only cleared once the reports are turned into events. For the same reason the
+	// history is marked read when the first sample after the last poll arrives, or here if none did.
+	if (_historyReadPending) {
+		markHistoryRead();
 	}
-	else {
+	if (!_connection->poll(_connectionSlot)) {
 		_vrpnDevice->mainloop();
 	}
 
-	for(auto pending_it=_pendingEvents.begin(); pending_it != _pendingEvents.end(); ++pending_it) {
-		events.push_back(*pending_it);
+	if (_waitForNewReport) {
+		boost::chrono::steady_clock::time_point deadline = boost::chrono::steady_clock::now() +
+			boost::chrono::microseconds((boost::int_least64_t)(_waitForNewReportTimeout*1000.0));
+		while (!_newReportFlag) {
+			boost::int_least64_t remaining = boost::chrono::duration_cast<boost::chrono::microseconds>(deadline - boost::chrono::steady_clock::now()).count();
+			if (remaining <= 0) {
+				break;
+			}
+			struct timeval timeout;
+			timeout.tv_sec = (long)(remaining / 1000000);
+			timeout.tv_usec = (long)(remaining % 1000000);
+			if (!_connection->wait(&timeout)) {
+				_vrpnDevice->mainloop();
+			}
+		}
 	}
-	_pendingEvents.clear();
+
+	transformReports(events);
 }
 
 } // end namespace
@@ -0,0 +1,230 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/InputReactor.H"
+#include "MVRCore/Logger.H"
+#include <boost/chrono.hpp>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#endif
+
+namespace MinVR {
+
+InputWakeSource::InputWakeSource(InputReactor* reactor, AbstractInputDevice* device) : _reactor(reactor), _device(device), _ready(true), _eventDriven(false)
+{
+}
+
+InputWakeSource::~InputWakeSource()
+{
+}
+
+bool InputWakeSource::watchFileDescriptor(int fd)
+{
+#ifdef __linux__
+	boost::mutex::scoped_lock lock(_reactorMutex);
+	if ((_reactor == nullptr) || (_reactor->_epollFd < 0) || (fd < 0)) {
+		return false;
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = this;
+	if (epoll_ctl(_reactor->_epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+		MINVR_LOG_WARNING(Logger::core()) << "InputReactor: Cannot watch file descriptor " << fd << " (errno " << errno << ").";
+		return false;
+	}
+	_fds.push_back(fd);
+	return true;
+#else
+	return false;
+#endif
+}
+
+void InputWakeSource::notify()
+{
+	// Only the first notify after a poll needs to wake the reactor
+	if (_ready.exchange(true)) {
+		return;
+	}
+
+	boost::mutex::scoped_lock lock(_reactorMutex);
+	if (_reactor != nullptr) {
+		_reactor->wake();
+	}
+}
+
+
+InputReactor::InputReactor() : _numSkippedPolls(0), _epollFd(-1), _wakeFd(-1)
+{
+#ifdef __linux__
+	_epollFd = epoll_create1(EPOLL_CLOEXEC);
+	_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if ((_epollFd >= 0) && (_wakeFd >= 0)) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = nullptr;
+		epoll_ctl(_epollFd, EPOLL_CTL_ADD, _wakeFd, &ev);
+	}
+	else {
+		MINVR_LOG_WARNING(Logger::core()) << "InputReactor: epoll is unavailable, waitForInput() will only see notify() calls.";
+	}
+#endif
+}
+
+InputReactor::~InputReactor()
+{
+	// Devices may outlive the reactor and keep calling notify() from their own threads
+	for (int i = 0; i < _sources.size(); i++) {
+		boost::mutex::scoped_lock lock(_sources[i]->_reactorMutex);
+		_sources[i]->_reactor = nullptr;
+	}
+
+#ifdef __linux__
+	if (_wakeFd >= 0) {
+		close(_wakeFd);
+	}
+	if (_epollFd >= 0) {
+		close(_epollFd);
+	}
+#endif
+}
+
+void InputReactor::addDevice(AbstractInputDeviceRef device)
+{
+	// The source only keeps a raw pointer so a device holding its source does not keep itself alive
+	InputWakeSourceRef source(new InputWakeSource(this, device.get()));
+	_devices.push_back(device);
+	_sources.push_back(source);
+	source->_eventDriven = device->attachWakeSource(source);
+}
+
+void InputReactor::pollForInput(std::vector<EventRef> &events)
+{
+	collectReadySources(0);
+
+	for (int i = 0; i < _sources.size(); i++) {
+		InputWakeSource* source = _sources[i].get();
+		if (!source->_eventDriven || source->_ready.exchange(false)) {
+			source->_device->pollForInput(events);
+		}
+		else {
+			_numSkippedPolls++;
+		}
+	}
+}
+
+bool InputReactor::waitForInput(int timeoutMs)
+{
+	if (anySourceReady()) {
+		return true;
+	}
+
+#ifdef __linux__
+	if (_epollFd >= 0) {
+		collectReadySources(timeoutMs);
+		return anySourceReady();
+	}
+#endif
+
+	boost::unique_lock<boost::mutex> lock(_wakeMutex);
+	boost::chrono::steady_clock::time_point deadline = boost::chrono::steady_clock::now() + boost::chrono::milliseconds(timeoutMs);
+	while (!anySourceReady()) {
+		if (_wakeCond.wait_until(lock, deadline) == boost::cv_status::timeout) {
+			break;
+		}
+	}
+	return anySourceReady();
+}
+
+unsigned long InputReactor::getNumSkippedPolls() const
+{
+	return _numSkippedPolls;
+}
+
+bool InputReactor::collectReadySources(int timeoutMs)
+{
+#ifdef __linux__
+	if (_epollFd < 0) {
+		return false;
+	}
+
+	struct epoll_event ready[16];
+	int n = epoll_wait(_epollFd, ready, 16, timeoutMs);
+	for (int i = 0; i < n; i++) {
+		if (ready[i].data.ptr == nullptr) {
+			// Reset the eventfd; the sources that called notify() already set their flags
+			uint64_t count;
+			while (read(_wakeFd, &count, sizeof(count)) > 0) {}
+		}
+		else {
+			static_cast<InputWakeSource*>(ready[i].data.ptr)->_ready = true;
+		}
+	}
+	return n > 0;
+#else
+	return false;
+#endif
+}
+
+bool InputReactor::anySourceReady() const
+{
+	for (int i = 0; i < _sources.size(); i++) {
+		if (_sources[i]->_eventDriven && _sources[i]->_ready) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void InputReactor::wake()
+{
+#ifdef __linux__
+	if (_wakeFd >= 0) {
+		uint64_t one = 1;
+		if (write(_wakeFd, &one, sizeof(one)) < 0) {
+			// The counter is already non-zero, so the reactor is awake anyway
+		}
+		return;
+	}
+#endif
+	boost::mutex::scoped_lock lock(_wakeMutex);
+	_wakeCond.notify_all();
+}
+
+} // end namespace
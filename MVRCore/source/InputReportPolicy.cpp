@@ -0,0 +1,138 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/InputReportPolicy.H"
+#include "MVRCore/Logger.H"
+#include <algorithm>
+
+namespace MinVR {
+
+static boost::posix_time::time_duration periodFromRate(double rate)
+{
+	if (rate <= 0.0) {
+		return boost::posix_time::time_duration(0, 0, 0, 0);
+	}
+	return boost::posix_time::microseconds((boost::int64_t)(1000000.0 / rate));
+}
+
+InputReportPolicy::InputReportPolicy() : _mode(REPORT_ALL), _historySize(128), _decimatePeriod(periodFromRate(60.0))
+{
+}
+
+InputReportPolicy::InputReportPolicy(Mode mode, size_t historySize, double decimateRate) : _mode(mode), _historySize(historySize), _decimatePeriod(periodFromRate(decimateRate))
+{
+}
+
+InputReportPolicy::InputReportPolicy(const std::string &name, const ConfigMapRef map)
+{
+	_mode = REPORT_ALL;
+	_historySize = 128;
+	_decimatePeriod = periodFromRate(60.0);
+
+	if (!map->containsKey(name + "_ReportPolicy")) {
+		return;
+	}
+
+	std::string modeStr = map->get(name + "_ReportPolicy", "All");
+	if (modeStr == "Latest") {
+		_mode = REPORT_LATEST;
+	}
+	else if (modeStr == "History") {
+		_mode = REPORT_HISTORY;
+		if (map->containsKey(name + "_HistorySize")) {
+			_historySize = map->get(name + "_HistorySize", 128);
+		}
+	}
+	else if (modeStr == "Decimate") {
+		_mode = REPORT_DECIMATE;
+		if (map->containsKey(name + "_DecimateRate")) {
+			_decimatePeriod = periodFromRate(map->get(name + "_DecimateRate", 60.0));
+		}
+	}
+	else if (modeStr != "All") {
+		MINVR_LOG_WARNING(Logger::core()) << "Unknown " << name << "_ReportPolicy '" << modeStr << "', using All";
+	}
+}
+
+void InputReportPolicy::setNumSensors(size_t numSensors)
+{
+	_pendingIndex.assign(numSensors, -1);
+	_lastAccepted.assign(numSensors, boost::posix_time::ptime(boost::posix_time::not_a_date_time));
+}
+
+int InputReportPolicy::placeReport(int sensor, const boost::posix_time::ptime &timestamp, size_t numPending)
+{
+	if (_mode == REPORT_ALL) {
+		return (int)numPending;
+	}
+
+	int &pending = _pendingIndex[sensor];
+	if (_mode == REPORT_DECIMATE) {
+		boost::posix_time::ptime &last = _lastAccepted[sensor];
+		if (!last.is_not_a_date_time() && timestamp - last < _decimatePeriod) {
+			// Still in the same period, keep the newest report if it has not been sent yet
+			return pending;
+		}
+		last = timestamp;
+		pending = (int)numPending;
+		return pending;
+	}
+
+	// Latest and History send one report per sensor per frame
+	if (pending < 0) {
+		pending = (int)numPending;
+	}
+	return pending;
+}
+
+void InputReportPolicy::pendingReportsConsumed()
+{
+	std::fill(_pendingIndex.begin(), _pendingIndex.end(), -1);
+}
+
+std::string InputReportPolicy::getModeName(Mode mode)
+{
+	switch (mode) {
+	case REPORT_LATEST:
+		return "Latest";
+	case REPORT_HISTORY:
+		return "History";
+	case REPORT_DECIMATE:
+		return "Decimate";
+	default:
+		return "All";
+	}
+}
+
+} // end namespace
@@ -0,0 +1,262 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/JobSystem.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/StringUtils.H"
+#include <boost/bind.hpp>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+// Failed attempts to find a job before a worker goes to sleep
+#define NUM_SPINS_BEFORE_SLEEP 64
+
+Job::Job() : _numBlockers(1), _finished(false), _submitted(false)
+{
+}
+
+void Job::addDependency(JobRef dependency)
+{
+	BOOST_ASSERT_MSG(!_submitted, "Job::addDependency: the job was already submitted");
+	boost::lock_guard<boost::mutex> lock(dependency->_successorsMutex);
+	if (dependency->_finished.load()) {
+		return;
+	}
+	_numBlockers.fetch_add(1);
+	// The dependency holds on to this job until it finishes
+	dependency->_successors.push_back(shared_from_this());
+}
+
+bool Job::isFinished()
+{
+	return _finished.load();
+}
+
+JobSystem::JobSystem(int numWorkers, const ThreadPlacement &placement) :
+	_placement(placement), _numWorkers(std::max(numWorkers, 0)), _numQueued(0), _numSleeping(0), _stopping(false), _numExecuted(0), _numStolen(0)
+{
+	for (int i = 0; i <= _numWorkers; i++) {
+		_queues.push_back(new JobQueue());
+	}
+	for (int i = 0; i < _numWorkers; i++) {
+		_threads.create_thread(boost::bind(&JobSystem::runWorker, this, i));
+	}
+	MINVR_LOG_INFO(Logger::core()) << "JobSystem: " << _numWorkers << " worker threads.";
+}
+
+JobSystem::~JobSystem()
+{
+	_stopping.store(true);
+	{
+		boost::lock_guard<boost::mutex> lock(_sleepMutex);
+		_workCond.notify_all();
+	}
+	_threads.join_all();
+	for (size_t i = 0; i < _queues.size(); i++) {
+		delete _queues[i];
+	}
+}
+
+int JobSystem::getDefaultNumWorkers(int numReservedThreads)
+{
+	int numCores = (int)boost::thread::hardware_concurrency();
+	return std::max(numCores - numReservedThreads, 1);
+}
+
+int JobSystem::getNumWorkers()
+{
+	return _numWorkers;
+}
+
+int JobSystem::getQueueIndex()
+{
+	int* index = _workerIndex.get();
+	return index != NULL ? *index : _numWorkers;
+}
+
+void JobSystem::submit(JobRef job)
+{
+	BOOST_ASSERT_MSG(!job->_submitted, "JobSystem::submit: the job was already submitted");
+	job->_submitted = true;
+	if (job->_numBlockers.fetch_sub(1) == 1) {
+		spawn(job);
+	}
+}
+
+JobRef JobSystem::then(JobRef first, JobRef next)
+{
+	next->addDependency(first);
+	submit(next);
+	return next;
+}
+
+void JobSystem::spawn(JobRef job)
+{
+	JobQueue* queue = _queues[getQueueIndex()];
+	{
+		boost::lock_guard<boost::mutex> lock(queue->mutex);
+		queue->jobs.push_back(job);
+	}
+
+	// A worker going to sleep counts itself before it checks _numQueued, so it cannot miss this
+	_numQueued.fetch_add(1);
+	if (_numSleeping.load() > 0) {
+		boost::lock_guard<boost::mutex> lock(_sleepMutex);
+		_workCond.notify_one();
+	}
+}
+
+JobRef JobSystem::findJob(int queueIndex)
+{
+	if (_numQueued.load() == 0) {
+		return JobRef();
+	}
+
+	// Newest job of our own deque first
+	JobQueue* own = _queues[queueIndex];
+	{
+		boost::lock_guard<boost::mutex> lock(own->mutex);
+		if (!own->jobs.empty()) {
+			JobRef job = own->jobs.back();
+			own->jobs.pop_back();
+			_numQueued.fetch_sub(1);
+			return job;
+		}
+	}
+
+	// Then the oldest job of someone else's, which is usually the largest piece of split work
+	int numQueues = (int)_queues.size();
+	for (int i = 1; i < numQueues; i++) {
+		JobQueue* victim = _queues[(queueIndex + i) % numQueues];
+		boost::lock_guard<boost::mutex> lock(victim->mutex);
+		if (!victim->jobs.empty()) {
+			JobRef job = victim->jobs.front();
+			victim->jobs.pop_front();
+			_numQueued.fetch_sub(1);
+			_numStolen.fetch_add(1);
+			return job;
+		}
+	}
+	return JobRef();
+}
+
+void JobSystem::execute(JobRef job)
+{
+	job->run();
+	_numExecuted.fetch_add(1);
+
+	std::vector<JobRef> successors;
+	{
+		boost::lock_guard<boost::mutex> lock(job->_successorsMutex);
+		job->_finished.store(true);
+		successors.swap(job->_successors);
+	}
+	for (size_t i = 0; i < successors.size(); i++) {
+		if (successors[i]->_numBlockers.fetch_sub(1) == 1) {
+			spawn(successors[i]);
+		}
+	}
+}
+
+void JobSystem::runWorker(int index)
+{
+	_placement.applyToCurrentThread("JobWorker" + intToString(index+1));
+	_workerIndex.reset(new int(index));
+
+	int numFailed = 0;
+	while (!_stopping.load()) {
+		JobRef job = findJob(index);
+		if (job) {
+			execute(job);
+			numFailed = 0;
+			continue;
+		}
+
+		if (++numFailed < NUM_SPINS_BEFORE_SLEEP) {
+			boost::this_thread::yield();
+			continue;
+		}
+
+		boost::unique_lock<boost::mutex> lock(_sleepMutex);
+		_numSleeping.fetch_add(1);
+		while (!_stopping.load() && _numQueued.load() == 0) {
+			_workCond.wait(lock);
+		}
+		_numSleeping.fetch_sub(1);
+		numFailed = 0;
+	}
+}
+
+void JobSystem::wait(JobRef job)
+{
+	int queueIndex = getQueueIndex();
+	while (!job->isFinished()) {
+		JobRef other = findJob(queueIndex);
+		if (other) {
+			execute(other);
+		}
+		else {
+			boost::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::helpUntilZero(boost::atomic<int> &counter)
+{
+	int queueIndex = getQueueIndex();
+	while (counter.load() > 0) {
+		JobRef job = findJob(queueIndex);
+		if (job) {
+			execute(job);
+		}
+		else {
+			boost::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::logStats()
+{
+	long numExecuted = _numExecuted.load();
+	if (numExecuted == 0) {
+		return;
+	}
+	MINVR_LOG_INFO(Logger::core()) << "JobSystem: " << numExecuted << " jobs run by " << _numWorkers << " workers and waiting threads, "
+		<< _numStolen.load() << " stolen (" << 100.0 * _numStolen.load() / numExecuted << "%).";
+}
+
+} // end namespace
@@ -0,0 +1,263 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/LatencyTracer.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/TimeService.H"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace MinVR {
+
+// Latencies beyond NUM_BUCKETS * BUCKET_WIDTH seconds land in one overflow bucket
+#define BUCKET_WIDTH 0.00025
+#define NUM_BUCKETS 800
+
+LatencyHistogram::LatencyHistogram() : _buckets(NUM_BUCKETS + 1, 0)
+{
+	_count = 0;
+	_sum = 0.0;
+	_min = 0.0;
+	_max = 0.0;
+}
+
+void LatencyHistogram::add(double seconds)
+{
+	// Clocks that step backwards should not produce negative bucket indices
+	seconds = std::max(seconds, 0.0);
+	size_t bucket = std::min((size_t)(seconds / BUCKET_WIDTH), (size_t)NUM_BUCKETS);
+	_buckets[bucket]++;
+
+	if (_count == 0 || seconds < _min) {
+		_min = seconds;
+	}
+	if (_count == 0 || seconds > _max) {
+		_max = seconds;
+	}
+	_count++;
+	_sum += seconds;
+}
+
+double LatencyHistogram::getPercentile(double fraction) const
+{
+	if (_count == 0) {
+		return 0.0;
+	}
+	unsigned long target = std::max((unsigned long)(fraction * _count + 0.5), 1UL);
+	unsigned long seen = 0;
+	for (size_t i = 0; i < NUM_BUCKETS; i++) {
+		seen += _buckets[i];
+		if (seen >= target) {
+			return std::min((i + 1) * BUCKET_WIDTH, _max);
+		}
+	}
+	return _max;
+}
+
+double LatencyHistogram::getBucketWidth()
+{
+	return BUCKET_WIDTH;
+}
+
+std::string LatencyTracer::getStageName(Stage stage)
+{
+	switch (stage) {
+	case STAGE_POLL:
+		return "poll";
+	case STAGE_CAMERA:
+		return "camera";
+	case STAGE_APP:
+		return "app";
+	case STAGE_DRAW:
+		return "draw";
+	case STAGE_SWAP:
+		return "swap";
+	default:
+		return "unknown";
+	}
+}
+
+bool LatencyTracer::HistogramKey::operator<(const HistogramKey &other) const
+{
+	if (source != other.source) {
+		return source < other.source;
+	}
+	if (stage != other.stage) {
+		return stage < other.stage;
+	}
+	return window < other.window;
+}
+
+LatencyTracer::LatencyTracer()
+{
+}
+
+std::string LatencyTracer::getSourceName(const std::string &eventName)
+{
+	const char* suffixes[] = {"_down", "_up"};
+	for (int i = 0; i < 2; i++) {
+		std::string suffix = suffixes[i];
+		if (eventName.size() > suffix.size() && eventName.compare(eventName.size() - suffix.size(), suffix.size(), suffix) == 0) {
+			return eventName.substr(0, eventName.size() - suffix.size());
+		}
+	}
+	return eventName;
+}
+
+LatencyTracer::FrameTraceRef LatencyTracer::beginFrame(const std::vector<EventRef> &events)
+{
+	FrameTraceRef trace(new FrameTrace());
+	boost::mutex::scoped_lock lock(_mutex);
+	for (size_t i = 0; i < events.size(); i++) {
+		boost::posix_time::ptime arrival = events[i]->getTimestamp();
+		if (arrival.is_not_a_date_time()) {
+			continue;
+		}
+
+		std::string source = getSourceName(events[i]->getName());
+		std::map<std::string, int>::iterator it = _sourceIndices.find(source);
+		int index;
+		if (it == _sourceIndices.end()) {
+			index = (int)_sources.size();
+			_sources.push_back(source);
+			_sourceIndices[source] = index;
+		}
+		else {
+			index = it->second;
+		}
+		trace->sources.push_back(index);
+		trace->arrivals.push_back(arrival);
+	}
+	return trace;
+}
+
+void LatencyTracer::record(FrameTraceRef trace, Stage stage, const std::string &windowName)
+{
+	if (!trace || trace->sources.empty()) {
+		return;
+	}
+	boost::posix_time::ptime now = TimeService::localTime();
+
+	boost::mutex::scoped_lock lock(_mutex);
+	for (size_t i = 0; i < trace->sources.size(); i++) {
+		double latency = (now - trace->arrivals[i]).total_microseconds() / 1000000.0;
+
+		HistogramKey key;
+		key.source = trace->sources[i];
+		key.stage = stage;
+		_histograms[key].add(latency);
+		if (!windowName.empty()) {
+			key.window = windowName;
+			_histograms[key].add(latency);
+		}
+	}
+}
+
+std::vector<std::string> LatencyTracer::getSources()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	return _sources;
+}
+
+LatencyHistogram LatencyTracer::getHistogram(const std::string &source, Stage stage, const std::string &windowName)
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	std::map<std::string, int>::iterator index = _sourceIndices.find(source);
+	if (index == _sourceIndices.end()) {
+		return LatencyHistogram();
+	}
+
+	HistogramKey key;
+	key.source = index->second;
+	key.stage = stage;
+	key.window = windowName;
+	std::map<HistogramKey, LatencyHistogram>::iterator it = _histograms.find(key);
+	if (it == _histograms.end()) {
+		return LatencyHistogram();
+	}
+	return it->second;
+}
+
+bool LatencyTracer::writeCSV(const std::string &filename)
+{
+	std::ofstream file(filename.c_str());
+	if (!file) {
+		MINVR_LOG_WARNING(Logger::core()) << "Could not write the latency histograms to " << filename << ".";
+		return false;
+	}
+
+	boost::mutex::scoped_lock lock(_mutex);
+	file << "source,stage,window,lower_ms,upper_ms,count" << std::endl;
+	for (std::map<HistogramKey, LatencyHistogram>::iterator it = _histograms.begin(); it != _histograms.end(); ++it) {
+		const LatencyHistogram &histogram = it->second;
+		for (size_t i = 0; i < histogram.getNumBuckets(); i++) {
+			if (histogram.getBucketCount(i) == 0) {
+				continue;
+			}
+			double lower = 1000.0 * i * LatencyHistogram::getBucketWidth();
+			// The overflow bucket ends at the largest latency it holds
+			double upper = (i + 1 < histogram.getNumBuckets()) ? lower + 1000.0 * LatencyHistogram::getBucketWidth() : 1000.0 * histogram.getMax();
+			file << _sources[it->first.source] << "," << getStageName((Stage)it->first.stage) << "," << it->first.window << ","
+				<< lower << "," << upper << "," << histogram.getBucketCount(i) << std::endl;
+		}
+	}
+	return true;
+}
+
+void LatencyTracer::logSummary()
+{
+	std::vector<std::string> sources = getSources();
+	for (size_t s = 0; s < sources.size(); s++) {
+		// The log payload is short, so the stages are split over two lines
+		for (int line = 0; line < 2; line++) {
+			std::stringstream summary;
+			int first = (line == 0) ? STAGE_POLL : STAGE_DRAW;
+			int last = (line == 0) ? STAGE_APP : STAGE_SWAP;
+			for (int stage = first; stage <= last; stage++) {
+				LatencyHistogram histogram = getHistogram(sources[s], (Stage)stage);
+				if (histogram.getCount() == 0) {
+					continue;
+				}
+				summary << " " << getStageName((Stage)stage) << " " << 1000.0 * histogram.getPercentile(0.5)
+					<< "/" << 1000.0 * histogram.getPercentile(0.99);
+			}
+			if (!summary.str().empty()) {
+				MINVR_LOG_INFO(Logger::core()) << "Latency of " << sources[s] << " in ms (median/99th):" << summary.str();
+			}
+		}
+	}
+}
+
+} // end namespace
@@ -0,0 +1,515 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/Logger.H"
+#include "MVRCore/StringUtils.H"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <boost/thread/once.hpp>
+
+namespace MinVR {
+
+static Logger* common = nullptr;
+static boost::once_flag commonInitialized = BOOST_ONCE_INIT;
+
+// How long the writer sleeps when nobody wakes it. Warnings, errors and rings that are
+// filling up wake it early.
+static const int writerIntervalMs = 20;
+
+static void closeThreadRing(boost::shared_ptr<LogRing>* ring)
+{
+	(*ring)->close();
+	delete ring;
+}
+
+static bool compareSequence(const LogSlot &a, const LogSlot &b)
+{
+	return a.sequence < b.sequence;
+}
+
+static void cleanupAtExit()
+{
+	Logger::cleanup();
+}
+
+// std::cout is not ours to delete
+struct NoDelete {
+	void operator()(std::ostream*) const {}
+};
+
+LogSlot* LogRing::reserve()
+{
+	boost::uint32_t head = _head.load(boost::memory_order_relaxed);
+	if (head - _tail.load(boost::memory_order_acquire) >= NUM_SLOTS) {
+		// Never block the caller, the writer reports how many messages were lost
+		_dropped.fetch_add(1, boost::memory_order_relaxed);
+		return nullptr;
+	}
+	return &_slots[head % NUM_SLOTS];
+}
+
+void LogRing::publish()
+{
+	_head.store(_head.load(boost::memory_order_relaxed) + 1, boost::memory_order_release);
+}
+
+void LogRing::drainInto(std::vector<LogSlot> &out)
+{
+	boost::uint32_t head = _head.load(boost::memory_order_acquire);
+	boost::uint32_t tail = _tail.load(boost::memory_order_relaxed);
+	while (tail != head) {
+		out.push_back(_slots[tail % NUM_SLOTS]);
+		tail++;
+	}
+	_tail.store(tail, boost::memory_order_release);
+}
+
+LogRecord::LogRecord(LogChannel &channel, LogLevel level)
+{
+	Logger &logger = Logger::instance();
+	_ring = logger.getThreadRing();
+	_slot = _ring->reserve();
+	if (_slot != nullptr) {
+		_slot->sequence = logger.nextSequence();
+		_slot->channel = &channel;
+		_slot->level = (boost::uint16_t)level;
+		_slot->size = 0;
+		_slot->spill = nullptr;
+	}
+}
+
+LogRecord::~LogRecord()
+{
+	if (_slot != nullptr) {
+		LogLevel level = (LogLevel)_slot->level;
+		_ring->publish();
+		Logger::instance().recordPublished(_ring, level);
+	}
+}
+
+char* LogRecord::grow(size_t bytes)
+{
+	size_t size = _slot->size;
+	_slot->size += (boost::uint32_t)bytes;
+	if (_slot->spill == nullptr) {
+		if (size + bytes <= LogSlot::PAYLOAD_SIZE) {
+			return &_slot->payload[size];
+		}
+		// Moved to the heap rather than cut off, the writer thread frees it
+		_slot->spill = new std::vector<char>(_slot->payload, _slot->payload + size);
+	}
+	_slot->spill->resize(size + bytes);
+	return &(*_slot->spill)[size];
+}
+
+void LogRecord::appendValue(ArgType type, const void* value, size_t size)
+{
+	if (_slot == nullptr) {
+		return;
+	}
+	char* dest = grow(1 + size);
+	dest[0] = (char)type;
+	memcpy(dest + 1, value, size);
+}
+
+LogRecord& LogRecord::appendString(const char* str, size_t len)
+{
+	if (_slot == nullptr) {
+		return *this;
+	}
+	// Tag, 16 bit length and characters, in pieces if the string is longer than the length can say
+	do {
+		boost::uint16_t len16 = (boost::uint16_t)std::min(len, (size_t)0xffff);
+		char* dest = grow(3 + len16);
+		dest[0] = (char)ARG_STRING;
+		memcpy(dest + 1, &len16, sizeof(len16));
+		memcpy(dest + 3, str, len16);
+		str += len16;
+		len -= len16;
+	} while (len > 0);
+	return *this;
+}
+
+LogRecord& LogRecord::operator<<(const char* str)
+{
+	if (str == nullptr) {
+		return appendString("(null)", 6);
+	}
+	return appendString(str, strlen(str));
+}
+
+LogRecord& LogRecord::operator<<(const std::string &str)
+{
+	return appendString(str.c_str(), str.size());
+}
+
+LogRecord& LogRecord::operator<<(char c)
+{
+	appendValue(ARG_CHAR, &c, sizeof(c));
+	return *this;
+}
+
+LogRecord& LogRecord::operator<<(bool b)
+{
+	char value = b ? 1 : 0;
+	appendValue(ARG_BOOL, &value, sizeof(value));
+	return *this;
+}
+
+LogRecord& LogRecord::operator<<(const void* p)
+{
+	appendValue(ARG_POINTER, &p, sizeof(p));
+	return *this;
+}
+
+// The glm stream operators live in StringUtils.H, which includes this header, so the
+// template version of operator<< cannot see them.
+template <class T>
+static std::string toString(const T &value)
+{
+	std::ostringstream stream;
+	stream << value;
+	return stream.str();
+}
+
+LogRecord& LogRecord::operator<<(const glm::dvec2 &v)
+{
+	return _slot != nullptr ? *this << toString(v) : *this;
+}
+
+LogRecord& LogRecord::operator<<(const glm::dvec3 &v)
+{
+	return _slot != nullptr ? *this << toString(v) : *this;
+}
+
+LogRecord& LogRecord::operator<<(const glm::dvec4 &v)
+{
+	return _slot != nullptr ? *this << toString(v) : *this;
+}
+
+LogRecord& LogRecord::operator<<(const glm::dmat3 &m)
+{
+	return _slot != nullptr ? *this << toString(m) : *this;
+}
+
+LogRecord& LogRecord::operator<<(const glm::dmat4 &m)
+{
+	return _slot != nullptr ? *this << toString(m) : *this;
+}
+
+LogRecord& LogRecord::appendSigned(long long i)
+{
+	appendValue(ARG_SIGNED, &i, sizeof(i));
+	return *this;
+}
+
+LogRecord& LogRecord::appendUnsigned(unsigned long long i)
+{
+	appendValue(ARG_UNSIGNED, &i, sizeof(i));
+	return *this;
+}
+
+LogRecord& LogRecord::appendDouble(double d)
+{
+	appendValue(ARG_DOUBLE, &d, sizeof(d));
+	return *this;
+}
+
+void LogRecord::format(const LogSlot &slot, std::ostream &out)
+{
+	const char* payload = (slot.spill != nullptr) ? &(*slot.spill)[0] : slot.payload;
+	size_t pos = 0;
+	size_t size = slot.size;
+	while (pos < size) {
+		ArgType type = (ArgType)payload[pos++];
+		switch (type) {
+		case ARG_STRING: {
+			boost::uint16_t len;
+			memcpy(&len, &payload[pos], sizeof(len));
+			out.write(&payload[pos + sizeof(len)], len);
+			pos += sizeof(len) + len;
+			break;
+		}
+		case ARG_CHAR:
+			out << payload[pos];
+			pos += 1;
+			break;
+		case ARG_BOOL:
+			out << (payload[pos] != 0);
+			pos += 1;
+			break;
+		case ARG_SIGNED: {
+			long long value;
+			memcpy(&value, &payload[pos], sizeof(value));
+			out << value;
+			pos += sizeof(value);
+			break;
+		}
+		case ARG_UNSIGNED: {
+			unsigned long long value;
+			memcpy(&value, &payload[pos], sizeof(value));
+			out << value;
+			pos += sizeof(value);
+			break;
+		}
+		case ARG_DOUBLE: {
+			double value;
+			memcpy(&value, &payload[pos], sizeof(value));
+			out << value;
+			pos += sizeof(value);
+			break;
+		}
+		case ARG_POINTER: {
+			const void* value;
+			memcpy(&value, &payload[pos], sizeof(value));
+			out << value;
+			pos += sizeof(value);
+			break;
+		}
+		default:
+			out << "...";
+			return;
+		}
+	}
+}
+
+Logger& Logger::instance()
+{
+	init();
+	return *common;
+}
+
+void Logger::init()
+{
+	// Checked on every message, so this avoids taking a lock once the logger exists
+	boost::call_once(&Logger::create, commonInitialized);
+}
+
+void Logger::create()
+{
+	common = new Logger();
+	std::atexit(cleanupAtExit);
+}
+
+bool Logger::isStopped()
+{
+	return common == nullptr || common->_stopped.load(boost::memory_order_acquire);
+}
+
+Logger::Logger() : _threadRing(closeThreadRing), _passCount(0), _running(true), _stopped(false), _sequence(0)
+{
+	_streams.push_back(boost::shared_ptr<std::ostream>(&std::cout, NoDelete()));
+	// Core records of every severity are written, as the Boost sink's filter on the "MinVR Core" tag did
+	_channels["MinVR Core"] = new LogChannel("MinVR Core", LOG_DEBUG);
+	_thread.reset(new boost::thread(&Logger::run, this));
+}
+
+LogChannel& Logger::getChannel(const std::string &name)
+{
+	Logger &logger = instance();
+	boost::mutex::scoped_lock lock(logger._channelsMutex);
+	std::map<std::string, LogChannel*>::iterator it = logger._channels.find(name);
+	if (it != logger._channels.end()) {
+		return *it->second;
+	}
+	// Channels are never deleted so references handed out stay valid
+	LogChannel* channel = new LogChannel(name);
+	logger._channels[name] = channel;
+	return *channel;
+}
+
+LogChannel& Logger::core()
+{
+	static LogChannel &channel = getChannel("MinVR Core");
+	return channel;
+}
+
+void Logger::addStream(boost::shared_ptr<std::ostream> stream)
+{
+	instance()._addStream(stream);
+}
+
+void Logger::removeAllStreams()
+{
+	instance()._removeAllStreams();
+}
+
+void Logger::flush()
+{
+	instance()._flush();
+}
+
+void Logger::cleanup()
+{
+	if (common != nullptr) {
+		common->_stop();
+	}
+}
+
+LogRing* Logger::getThreadRing()
+{
+	boost::shared_ptr<LogRing>* ring = _threadRing.get();
+	if (ring == nullptr) {
+		ring = new boost::shared_ptr<LogRing>(new LogRing());
+		_threadRing.reset(ring);
+		boost::mutex::scoped_lock lock(_ringsMutex);
+		_rings.push_back(*ring);
+	}
+	return ring->get();
+}
+
+void Logger::recordPublished(LogRing* ring, LogLevel level)
+{
+	if (_stopped.load(boost::memory_order_acquire)) {
+		// The writer is gone, so write the message from the calling thread
+		writePending();
+	}
+	else if (level >= LOG_WARNING || ring->getNumPending() >= LogRing::NUM_SLOTS / 2) {
+		_wakeCond.notify_one();
+	}
+}
+
+void Logger::_addStream(boost::shared_ptr<std::ostream> stream)
+{
+	boost::mutex::scoped_lock lock(_streamsMutex);
+	_streams.push_back(stream);
+}
+
+void Logger::_removeAllStreams()
+{
+	boost::mutex::scoped_lock lock(_streamsMutex);
+	_streams.clear();
+}
+
+void Logger::_flush()
+{
+	if (_stopped.load(boost::memory_order_acquire)) {
+		writePending();
+		return;
+	}
+	// Once the writer has started and finished a whole pass after this point, everything
+	// this thread published before the call has been written.
+	boost::unique_lock<boost::mutex> lock(_wakeMutex);
+	boost::uint64_t target = _passCount + 2;
+	_wakeCond.notify_one();
+	while (_passCount < target && _running) {
+		_passCond.wait(lock);
+	}
+}
+
+void Logger::_stop()
+{
+	{
+		boost::unique_lock<boost::mutex> lock(_wakeMutex);
+		if (!_running) {
+			return;
+		}
+		_running = false;
+		_wakeCond.notify_one();
+	}
+	_thread->join();
+	_stopped.store(true, boost::memory_order_release);
+	// Anything published while the writer was shutting down
+	writePending();
+}
+
+void Logger::run()
+{
+	boost::unique_lock<boost::mutex> lock(_wakeMutex);
+	while (true) {
+		bool running = _running;
+		lock.unlock();
+		writePending();
+		lock.lock();
+		_passCount++;
+		_passCond.notify_all();
+		if (!running) {
+			break;
+		}
+		if (_running) {
+			_wakeCond.timed_wait(lock, boost::posix_time::milliseconds(writerIntervalMs));
+		}
+	}
+	_passCond.notify_all();
+}
+
+void Logger::writePending()
+{
+	// Serializes output, _pending is reused between passes to avoid allocating
+	boost::mutex::scoped_lock streamsLock(_streamsMutex);
+
+	size_t dropped = 0;
+	{
+		boost::mutex::scoped_lock ringsLock(_ringsMutex);
+		std::vector<boost::shared_ptr<LogRing> >::iterator it = _rings.begin();
+		while (it != _rings.end()) {
+			(*it)->drainInto(_pending);
+			dropped += (*it)->takeDroppedCount();
+			if ((*it)->isClosed() && (*it)->isEmpty()) {
+				it = _rings.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	if (_pending.empty() && dropped == 0) {
+		return;
+	}
+
+	// Each ring is in order, merge them into the order the messages were logged
+	std::sort(_pending.begin(), _pending.end(), compareSequence);
+
+	std::ostringstream text;
+	for (size_t i = 0; i < _pending.size(); i++) {
+		LogRecord::format(_pending[i], text);
+		text << '\n';
+		delete _pending[i].spill;
+	}
+	if (dropped > 0) {
+		text << "Logger: " << dropped << " messages were dropped because the log buffer was full\n";
+	}
+	_pending.clear();
+
+	const std::string str = text.str();
+	for (size_t i = 0; i < _streams.size(); i++) {
+		_streams[i]->write(str.c_str(), str.size());
+		_streams[i]->flush();
+	}
+}
+
+} // end namespace
@@ -0,0 +1,195 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/PixelReadbackRing.H"
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+PixelReadbackRing::PixelReadbackRing(int numBuffers, GLenum format) : _format(format), _initialized(false), _oldest(0), _numInFlight(0),
+	_numIssued(0), _numDelivered(0), _numSkipped(0)
+{
+	BOOST_ASSERT_MSG(numBuffers > 0, "PixelReadbackRing needs at least one buffer");
+	BOOST_ASSERT_MSG(format == GL_RGBA || format == GL_BGRA, "PixelReadbackRing only reads back GL_RGBA or GL_BGRA");
+
+	Slot empty = {0, 0, 0, 0, 0, 0};
+	_slots.resize(numBuffers, empty);
+}
+
+PixelReadbackRing::~PixelReadbackRing()
+{
+}
+
+bool PixelReadbackRing::isSupported()
+{
+#ifdef _WIN32
+	return pglGenBuffers && pglDeleteBuffers && pglMapBufferRange && pglUnmapBuffer && pglFenceSync && pglClientWaitSync && pglDeleteSync;
+#else
+	return true;
+#endif
+}
+
+void PixelReadbackRing::setListener(ReadbackListenerRef listener)
+{
+	_listener = listener;
+}
+
+bool PixelReadbackRing::readPixels(int x, int y, int width, int height, long frameNumber)
+{
+	if (!_initialized) {
+		for (size_t i = 0; i < _slots.size(); i++) {
+			glGenBuffers(1, &_slots[i].pbo);
+		}
+		_initialized = true;
+	}
+
+	deliverCompleted();
+	if (_numInFlight == _slots.size()) {
+		_numSkipped++;
+		return false;
+	}
+
+	Slot &slot = _slots[(_oldest + _numInFlight) % _slots.size()];
+	size_t size = (size_t)width * height * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+	if (slot.size != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		slot.size = size;
+	}
+	glReadPixels(x, y, width, height, _format, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.width = width;
+	slot.height = height;
+	slot.frameNumber = frameNumber;
+	_numInFlight++;
+	_numIssued++;
+	return true;
+}
+
+int PixelReadbackRing::deliverCompleted()
+{
+	int delivered = 0;
+	while (_numInFlight > 0 && deliverOldest(false)) {
+		delivered++;
+	}
+	return delivered;
+}
+
+void PixelReadbackRing::finish()
+{
+	while (_numInFlight > 0) {
+		deliverOldest(true);
+	}
+}
+
+bool PixelReadbackRing::deliverOldest(bool wait)
+{
+	Slot &slot = _slots[_oldest];
+
+	// Waiting needs the fence flushed, otherwise it may never be signaled
+	GLenum status = wait ? glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED) : glClientWaitSync(slot.fence, 0, 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		return false;
+	}
+
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	if (status != GL_WAIT_FAILED && _listener) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.size, GL_MAP_READ_BIT);
+		if (pixels != NULL) {
+			ReadbackFrame frame = {slot.width, slot.height, _format, 4, slot.frameNumber, pixels};
+			_listener->frameReadBack(frame);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	_oldest = (_oldest + 1) % _slots.size();
+	_numInFlight--;
+	_numDelivered++;
+	return true;
+}
+
+void PixelReadbackRing::releaseGLObjects()
+{
+	if (!_initialized) {
+		return;
+	}
+	for (size_t i = 0; i < _slots.size(); i++) {
+		if (_slots[i].fence) {
+			glDeleteSync(_slots[i].fence);
+			_slots[i].fence = 0;
+		}
+		glDeleteBuffers(1, &_slots[i].pbo);
+		_slots[i].pbo = 0;
+		_slots[i].size = 0;
+	}
+	_oldest = 0;
+	_numInFlight = 0;
+	_initialized = false;
+}
+
+int PixelReadbackRing::getNumBuffers()
+{
+	return (int)_slots.size();
+}
+
+int PixelReadbackRing::getNumInFlight()
+{
+	return (int)_numInFlight;
+}
+
+long PixelReadbackRing::getNumIssued()
+{
+	return _numIssued;
+}
+
+long PixelReadbackRing::getNumDelivered()
+{
+	return _numDelivered;
+}
+
+long PixelReadbackRing::getNumSkipped()
+{
+	return _numSkipped;
+}
+
+} // end namespace
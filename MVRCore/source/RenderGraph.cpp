@@ -0,0 +1,359 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+/**
+ * \file  RenderGraph.cpp
+ * \brief The passes that draw a window's frames, and the render targets between them
+ *
+ */
+
+#include "MVRCore/RenderGraph.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/StringUtils.H"
+#include <boost/assert.hpp>
+#include <algorithm>
+
+namespace MinVR {
+
+static void beginSection(const RenderPassContext &context, const std::string &name)
+{
+	if (context.gpuTimer) {
+		context.gpuTimer->beginSection(name);
+	}
+}
+
+static void endSection(const RenderPassContext &context)
+{
+	if (context.gpuTimer) {
+		context.gpuTimer->endSection();
+	}
+}
+
+RenderTargetPool::RenderTargetPool()
+{
+}
+
+int RenderTargetPool::acquire(const RenderTargetDesc &desc)
+{
+	for (size_t i = 0; i < _targets.size(); i++) {
+		if (!_targets[i].inUse && _targets[i].desc == desc) {
+			_targets[i].inUse = true;
+			return (int)i;
+		}
+	}
+
+	Target target;
+	target.desc = desc;
+	target.depthStencilRBO = 0;
+	target.inUse = true;
+
+	glGenTextures(1, &target.colorTexture);
+	glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, desc.colorFormat, desc.width, desc.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &target.fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTexture, 0);
+
+	if (desc.depthStencil) {
+		glGenRenderbuffers(1, &target.depthStencilRBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, target.depthStencilRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, desc.width, desc.height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depthStencilRBO);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depthStencilRBO);
+	}
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	BOOST_ASSERT_MSG(status == GL_FRAMEBUFFER_COMPLETE, "RenderTargetPool: the render target's framebuffer is incomplete.");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	_targets.push_back(target);
+	return (int)_targets.size() - 1;
+}
+
+void RenderTargetPool::release(int index)
+{
+	_targets[index].inUse = false;
+}
+
+void RenderTargetPool::releaseGLObjects()
+{
+	for (size_t i = 0; i < _targets.size(); i++) {
+		glDeleteFramebuffers(1, &_targets[i].fbo);
+		glDeleteTextures(1, &_targets[i].colorTexture);
+		if (_targets[i].depthStencilRBO) {
+			glDeleteRenderbuffers(1, &_targets[i].depthStencilRBO);
+		}
+	}
+	_targets.clear();
+}
+
+RenderGraph::RenderGraph(int threadId, WindowRef window) : _threadId(threadId), _window(window), _compiled(false)
+{
+}
+
+int RenderGraph::createTarget(const std::string &name, const RenderTargetDesc &desc)
+{
+	BOOST_ASSERT_MSG(!_compiled, "RenderGraph: targets must be created before the graph is compiled.");
+	Target target;
+	target.name = name;
+	target.desc = desc;
+	target.desc.width = _window->getWidth();
+	target.desc.height = _window->getHeight();
+	target.pooled = -1;
+	_targets.push_back(target);
+	return (int)_targets.size() - 1;
+}
+
+void RenderGraph::addPass(RenderPassRef pass, const std::vector<int> &inputs, int output, bool redirectable)
+{
+	BOOST_ASSERT_MSG(!_compiled, "RenderGraph: passes must be added before the graph is compiled.");
+	Node node;
+	node.pass = pass;
+	node.inputs = inputs;
+	node.output = output;
+	node.redirectable = redirectable;
+	_nodes.push_back(node);
+}
+
+bool RenderGraph::addPostPass(RenderPassRef pass, const RenderTargetDesc &desc)
+{
+	std::vector<int> windowOutputs;
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		if (_nodes[i].output >= 0) {
+			continue;
+		}
+		if (!_nodes[i].redirectable) {
+			MINVR_LOG_WARNING(Logger::core()) << "RenderGraph: the post pass " << pass->getName() << " is not added, the window is drawn by " << _nodes[i].pass->getName() << ".";
+			return false;
+		}
+		if (std::find(windowOutputs.begin(), windowOutputs.end(), _nodes[i].output) == windowOutputs.end()) {
+			windowOutputs.push_back(_nodes[i].output);
+		}
+	}
+	if (windowOutputs.empty()) {
+		return false;
+	}
+
+	for (size_t w = 0; w < windowOutputs.size(); w++) {
+		std::string name = pass->getName() + " input";
+		if (windowOutputs[w] == OUTPUT_BACK_LEFT) {
+			name += " (left)";
+		}
+		else if (windowOutputs[w] == OUTPUT_BACK_RIGHT) {
+			name += " (right)";
+		}
+		int target = createTarget(name, desc);
+		for (size_t i = 0; i < _nodes.size(); i++) {
+			if (_nodes[i].output == windowOutputs[w]) {
+				_nodes[i].output = target;
+			}
+		}
+		addPass(pass, std::vector<int>(1, target), windowOutputs[w]);
+	}
+	return true;
+}
+
+void RenderGraph::compile()
+{
+	BOOST_ASSERT_MSG(!_compiled, "RenderGraph: the graph is already compiled.");
+
+	// A target is live from the pass that first writes it to the last pass that reads it
+	std::vector<int> firstUse(_targets.size(), -1);
+	std::vector<int> lastUse(_targets.size(), -1);
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		for (size_t j = 0; j < _nodes[i].inputs.size(); j++) {
+			int input = _nodes[i].inputs[j];
+			BOOST_ASSERT_MSG(input >= 0 && input < (int)_targets.size() && firstUse[input] >= 0, "RenderGraph: a pass reads a target that no earlier pass writes.");
+			lastUse[input] = (int)i;
+		}
+		int output = _nodes[i].output;
+		if (output >= 0) {
+			BOOST_ASSERT_MSG(output < (int)_targets.size(), "RenderGraph: a pass writes a target of another graph.");
+			if (firstUse[output] < 0) {
+				firstUse[output] = (int)i;
+			}
+			lastUse[output] = std::max(lastUse[output], (int)i);
+		}
+	}
+
+	// Framebuffers are taken before the pass that first writes a target and given back after the pass
+	// that last reads it, so a pass never reads and writes the same framebuffer
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		for (size_t t = 0; t < _targets.size(); t++) {
+			if (firstUse[t] == (int)i) {
+				_targets[t].pooled = _pool.acquire(_targets[t].desc);
+			}
+		}
+		for (size_t t = 0; t < _targets.size(); t++) {
+			if (lastUse[t] == (int)i) {
+				_pool.release(_targets[t].pooled);
+			}
+		}
+	}
+	_compiled = true;
+}
+
+void RenderGraph::bindOutput(int output, RenderPassContext &context)
+{
+	if (output >= 0) {
+		context.framebuffer = _pool.getFramebuffer(_targets[output].pooled);
+		context.drawBuffer = GL_COLOR_ATTACHMENT0;
+	}
+	else {
+		context.framebuffer = 0;
+		context.drawBuffer = (output == OUTPUT_BACK_LEFT) ? GL_BACK_LEFT : (output == OUTPUT_BACK_RIGHT) ? GL_BACK_RIGHT : GL_BACK;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, context.framebuffer);
+	glDrawBuffer(context.drawBuffer);
+}
+
+void RenderGraph::execute(AbstractMVRAppRef app, GPUTimerRef gpuTimer)
+{
+	BOOST_ASSERT_MSG(_compiled, "RenderGraph: the graph must be compiled before it is executed.");
+
+	RenderPassContext context;
+	context.threadId = _threadId;
+	context.window = _window;
+	context.app = app;
+	context.gpuTimer = gpuTimer;
+	context.framebuffer = 0;
+	context.drawBuffer = GL_BACK;
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		bindOutput(_nodes[i].output, context);
+		context.inputs.clear();
+		for (size_t j = 0; j < _nodes[i].inputs.size(); j++) {
+			context.inputs.push_back(_pool.getColorTexture(_targets[_nodes[i].inputs[j]].pooled));
+		}
+		beginSection(context, _nodes[i].pass->getName());
+		_nodes[i].pass->execute(context);
+		endSection(context);
+	}
+	if (context.framebuffer != 0) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDrawBuffer(GL_BACK);
+	}
+}
+
+void RenderGraph::logGraph(const std::string &name)
+{
+	std::string passes = "";
+	for (size_t i = 0; i < _nodes.size(); i++) {
+		int output = _nodes[i].output;
+		passes += (i > 0 ? ", " : "") + _nodes[i].pass->getName() + " -> " + (output >= 0 ? _targets[output].name : std::string("window"));
+	}
+	MINVR_LOG_INFO(Logger::core()) << name << " render graph: " << passes << "; " << _targets.size() << " targets in " << _pool.getNumTargets() << " framebuffers.";
+}
+
+void RenderGraph::releaseGLObjects()
+{
+	_pool.releaseGLObjects();
+}
+
+ScenePass::ScenePass(const std::string &name, Eye eye, Layout layout, bool clear) : RenderPass(name), _eye(eye), _layout(layout), _clear(clear)
+{
+}
+
+void ScenePass::execute(const RenderPassContext &context)
+{
+	if (_clear) {
+		beginSection(context, "Clear");
+		glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		endSection(context);
+	}
+	for (int v=0; v < context.window->getNumViewports(); v++) {
+		beginSection(context, "Viewport" + intToString(v + 1));
+		MinVR::Rect2D viewport = context.window->getViewport(v);
+		if (_layout == LAYOUT_FULL) {
+			glViewport(viewport.x0(), viewport.y0(), viewport.width(), viewport.height());
+		}
+		else {
+			glViewport(viewport.x0() + (_layout == LAYOUT_RIGHT_HALF ? viewport.width()/2 : 0), viewport.y0(), viewport.width()/2, viewport.height());
+		}
+		AbstractCameraRef camera = context.window->getCamera(v);
+		if (_eye == EYE_LEFT) {
+			camera->applyProjectionAndCameraMatricesForLeftEye();
+		}
+		else if (_eye == EYE_RIGHT) {
+			camera->applyProjectionAndCameraMatricesForRightEye();
+		}
+		else {
+			camera->applyProjectionAndCameraMatrices();
+		}
+		context.app->drawGraphics(context.threadId, camera, context.window);
+		endSection(context);
+	}
+}
+
+StereoCompositePass::StereoCompositePass(GLuint program, GLuint vertexBuffer, GLuint indexBuffer) :
+	RenderPass("Stereo composite"), _program(program), _vertexBuffer(vertexBuffer), _indexBuffer(indexBuffer)
+{
+}
+
+void StereoCompositePass::execute(const RenderPassContext &context)
+{
+	BOOST_ASSERT_MSG(context.inputs.size() == 2, "StereoCompositePass: needs the left and the right eye as inputs.");
+	glViewport(0, 0, context.window->getWidth(), context.window->getHeight());
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glUseProgram(_program);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, context.inputs[0]);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, context.inputs[1]);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, 0);
+	glDrawElements(GL_QUADS, 4, GL_UNSIGNED_INT, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+
+	glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glUseProgram(0);
+}
+
+} // end namespace
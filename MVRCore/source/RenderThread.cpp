@@ -36,451 +36,287 @@
  * \author Bret Jackson
  *
  * \file  RenderThread.cpp
- * \brief Individual thread tied to a window and context for rendering
+ * \brief Thread that renders one or more windows, each with its own context
  *
  */
 
 #include "MVRCore/RenderThread.H"
 #include "MVRCore/AbstractMVREngine.H"
+#include <algorithm>
 
 using namespace std;
 
 namespace MinVR {
 
 RenderThread::RenderingState RenderThread::renderingState = RenderThread::RENDERING_WAIT;
-int RenderThread::numThreadsReceivedStartRendering = 0;
 int RenderThread::numThreadsReceivedRenderingComplete = 0;
 size_t RenderThread::numRenderingThreads = 0;
 int RenderThread::nextThreadId = 0;
 int RenderThread::numThreadsInitComplete = 0;
 
-RenderThread::RenderThread(WindowRef window, AbstractMVREngine* engine, AbstractMVRAppRef app, boost::barrier* swapBarrier,  boost::mutex* initializedMutex, boost::condition_variable* initializedCondition,
+// Swap groups in the order every thread waits at their barriers, so threads with windows in several groups cannot deadlock
+static bool swapGroupIdLess(const SwapGroupRef &a, const SwapGroupRef &b)
+{
+	return a->getId() < b->getId();
+}
+
+RenderThread::RenderThread(int index, const std::string &name, bool runInline, AbstractMVREngine* engine, boost::mutex* initializedMutex, boost::condition_variable* initializedCondition,
 	boost::mutex* startRenderingMutex, boost::mutex* renderingCompleteMutex, boost::condition_variable* startRenderingCond, boost::condition_variable* renderingCompleteCond)
 {
-	_window = window;
+	_index = index;
+	_name = name;
+	_inline = runInline;
 	_engine = engine;
-	_app = app;
-	_swapBarrier = swapBarrier;
+	_currentRenderer = NULL;
+	_abortStartup = false;
+	_finished = false;
 	_initMutex = initializedMutex;
 	_initCond = initializedCondition;
 	_startRenderingMutex = startRenderingMutex;
 	_renderingCompleteMutex = renderingCompleteMutex;
 	_startRenderingCond = startRenderingCond;
 	_renderingCompleteCond = renderingCompleteCond;
-	_threadId = RenderThread::nextThreadId;
-	RenderThread::nextThreadId++;
 
-	_thread = boost::shared_ptr<boost::thread>(new boost::thread(&RenderThread::render, this));
+	if (!_inline) {
+		_thread = boost::shared_ptr<boost::thread>(new boost::thread(&RenderThread::render, this));
+	}
 }
 
 RenderThread::~RenderThread()
 {
+	// If the app was never started the thread is still waiting for it
+	_startMutex.lock();
+	if (!_app) {
+		_abortStartup = true;
+		_startCond.notify_all();
+	}
+	_startMutex.unlock();
+
 	if (_thread) {
 		_thread->join();
 	}
+	else if (_app) {
+		finish();
+	}
 }
 
-void RenderThread::render()
+WindowRendererRef RenderThread::addWindow(WindowRef window, const std::vector<WindowRef> &workerWindows)
 {
-	_window->makeContextCurrent();
-	
-	initExtensions();
-	initStereoFramebufferAndTextures();
-	initStereoCompositeShader();
-	setShaderVariables();
-
-	GLenum err;
-	if((err = glGetError()) != GL_NO_ERROR) {
-		std::cout << "openGL ERROR before init context specific: "<<err<<std::endl;
-	}
+	WindowRendererRef renderer(new WindowRenderer(window, RenderThread::nextThreadId, _engine, workerWindows));
+	RenderThread::nextThreadId++;
 
-	_engine->initializeContextSpecificVars(_threadId, _window);
-	_app->initializeContextSpecificVars(_threadId, _window);
+	boost::mutex::scoped_lock lock(_startMutex);
+	_renderers.push_back(renderer);
+	if (_inline) {
+		makeCurrent(renderer);
+		renderer->initializeContext();
+	}
+	else {
+		_pendingRenderers.push_back(renderer);
+		_startCond.notify_all();
+	}
+	return renderer;
+}
 
-	if((err = glGetError()) != GL_NO_ERROR) {
-		std::cout << "openGL ERROR in start of render(): "<<err<<std::endl;
+void RenderThread::start(AbstractMVRAppRef app)
+{
+	boost::mutex::scoped_lock lock(_startMutex);
+	for (size_t i = 0; i < _renderers.size(); i++) {
+		SplitRendererRef splitter = _renderers[i]->getSplitRenderer();
+		if (splitter) {
+			RenderThread::nextThreadId += splitter->assignThreadIds(RenderThread::nextThreadId);
+		}
+		ReprojectionRendererRef reprojector = _renderers[i]->getReprojectionRenderer();
+		if (reprojector) {
+			RenderThread::nextThreadId += reprojector->assignThreadIds(RenderThread::nextThreadId);
+		}
+	}
+	_app = app;
+	if (_inline) {
+		// Creating the other windows may have changed the current context
+		_currentRenderer = NULL;
+		initializeApp();
 	}
+	else {
+		_startCond.notify_all();
+	}
+}
 
-	// Signal that the thread is initialized
-	_initMutex->lock();
-	numThreadsInitComplete++;
-	_initCond->notify_all();
-	_initMutex->unlock();
+void RenderThread::makeCurrent(WindowRendererRef renderer)
+{
+	if (_currentRenderer != renderer.get()) {
+		renderer->getWindow()->makeContextCurrent();
+		_currentRenderer = renderer.get();
+	}
+}
 
-	bool running = true;
-	while (running) {
+void RenderThread::initializeApp()
+{
+	for (size_t i = 0; i < _renderers.size(); i++) {
+		makeCurrent(_renderers[i]);
+		_renderers[i]->initializeApp(_app);
+
+		// Signal that the window is initialized
+		_initMutex->lock();
+		numThreadsInitComplete++;
+		_initCond->notify_all();
+		_initMutex->unlock();
+	}
+}
 
-		// Wait for the main thread to signal that it's ok to start rendering
-		boost::unique_lock<boost::mutex> startRenderingLock(*_startRenderingMutex);
-		while (renderingState == RENDERING_WAIT) {
-			_startRenderingCond->wait(startRenderingLock);
+void RenderThread::render()
+{
+	// Initialize the contexts of the windows as they are added, until the app arrives
+	boost::unique_lock<boost::mutex> startLock(_startMutex);
+	while (true) {
+		while (_pendingRenderers.empty() && !_app && !_abortStartup) {
+			_startCond.wait(startLock);
 		}
-		if (renderingState == RENDERING_TERMINATE) {
-			// RENDERING_TERMINATE is a special flag used to quit the application and cleanup all the threads nicely
-			startRenderingLock.unlock();
+		if (_abortStartup) {
 			return;
 		}
-		numThreadsReceivedStartRendering++;
-		// if this is the last thread to receive the StartRendering signal, then reset the flags for use in the next frame
-		if (numThreadsReceivedStartRendering >= numRenderingThreads) {
-			renderingState = RENDERING_WAIT;
-			numThreadsReceivedStartRendering = 0;
+		if (_pendingRenderers.empty()) {
+			break;
 		}
-		startRenderingLock.unlock();
 
-		//cout <<"\t Thread "<<_threadId<<" received start rendering"<<endl;
-
-		// Draw the scene
-		// Monoscopic
-		if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_MONO || _window->getSettings()->stereo == false) {
-			glDrawBuffer(GL_BACK);
-			glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0(), viewport.y0(), viewport.width(), viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatrices();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			}  
-		}
-		
-		// Quad Buffered Stereo
-		else if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_QUADBUFFERED) {
-			// Left Eye
-			glDrawBuffer(GL_BACK_LEFT);
-			glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0(), viewport.y0(), viewport.width(), viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatricesForLeftEye();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			}
-			// Right Eye
-			glDrawBuffer(GL_BACK_RIGHT);
-			glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0(), viewport.y0(), viewport.width(), viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatricesForRightEye();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			} 
+		WindowRendererRef renderer = _pendingRenderers.front();
+		_pendingRenderers.pop_front();
+		// addWindow may grow _renderers once the lock is released
+		bool firstRenderer = (renderer == _renderers.front());
+		startLock.unlock();
+
+		if (firstRenderer) {
+			// Placed before the first context exists so everything this thread allocates lands on its NUMA node
+			WindowSettingsRef settings = renderer->getWindow()->getSettings();
+			ThreadPlacement(settings->cpuAffinity, settings->numaNode, settings->threadPriority).applyToCurrentThread(_name);
+			_threadStats.begin();
 		}
+		// The main thread created the cameras, copy them to this thread's node. The main thread
+		// does not touch them again until waitForRenderThreadsInitialized returns.
+		renderer->getWindow()->cloneCamerasForCurrentThread();
+		makeCurrent(renderer);
+		renderer->initializeContext();
 
-		// Side by Side Stereo Images, Left Eye on the left half of the screen and Right Eye on the right
-		else if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_SIDEBYSIDE) {
-			glDrawBuffer(GL_BACK);
-			glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			// Left Eye
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0(), viewport.y0(), viewport.width()/2, viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatricesForLeftEye();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			}
-			// Right Eye
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0()+viewport.width()/2, viewport.y0(), viewport.width()/2, viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatricesForRightEye();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			} 
-		}
+		startLock.lock();
+	}
+	startLock.unlock();
 
-		// Draw using either checkerboard or interlaced stereo
-		else {
-			// bind a framebuffer object
-			glBindFramebuffer(GL_FRAMEBUFFER, _stereoFBO);
-		
-			//Set lefteye texture
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _leftEyeTexture, 0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0(), viewport.y0(), viewport.width(), viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatricesForLeftEye();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			}
+	// The rest of the initialization needs the app
+	initializeApp();
 
-			//Set righteye texture
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _rightEyeTexture, 0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			for (int v=0; v < _window->getNumViewports(); v++) {
-				MinVR::Rect2D viewport = _window->getViewport(v);
-				glViewport(viewport.x0(), viewport.y0(), viewport.width(), viewport.height());
-				_window->getCamera(v)->applyProjectionAndCameraMatricesForRightEye();
-				_app->drawGraphics(_threadId, _window->getCamera(v), _window);
-			}
+	std::vector<WindowRendererRef> requested;
+	while (true) {
 
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			glUseProgram(_stereoProgram);
-			glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
-
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, _leftEyeTexture);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, _rightEyeTexture);
-
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glVertexPointer(2, GL_FLOAT, 0, 0);
-			glDrawElements(GL_QUADS, 4, GL_UNSIGNED_INT, 0);
-			glDisableClientState(GL_VERTEX_ARRAY);
-
-			glBindBuffer(GL_ARRAY_BUFFER_ARB, 0);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glActiveTexture(GL_TEXTURE1);
-			glBindTexture(GL_TEXTURE_2D, 0);
-			glUseProgram(0);
+		// Wait for the main thread to ask for a frame. Windows of a secondary swap group are not asked every frame.
+		boost::unique_lock<boost::mutex> startRenderingLock(*_startRenderingMutex);
+		requested.clear();
+		while (renderingState != RENDERING_TERMINATE) {
+			for (size_t i = 0; i < _renderers.size(); i++) {
+				if (_renderers[i]->takeFrameRequest()) {
+					requested.push_back(_renderers[i]);
+				}
+			}
+			if (!requested.empty()) {
+				break;
+			}
+			_startRenderingCond->wait(startRenderingLock);
 		}
+		if (renderingState == RENDERING_TERMINATE) {
+			// RENDERING_TERMINATE is a special flag used to quit the application and cleanup all the threads nicely
+			startRenderingLock.unlock();
+			finish();
+			return;
+		}
+		startRenderingLock.unlock();
 
-		//cout << "\tThread "<<_threadId<<" finished rendering"<<endl;
-
-		// Wait for the other threads to get here before swapping buffers
-		_swapBarrier->wait();
-
-		//cout << "\tThread "<<_threadId<<" swapping buffers"<<endl;
-		_window->swapBuffers();
-
-		// Signal that this rendering thread has completed drawing
-		_renderingCompleteMutex->lock();
-		numThreadsReceivedRenderingComplete++;
-		_renderingCompleteCond->notify_all();
-		_renderingCompleteMutex->unlock();
+		renderFrame(requested);
 	}
 }
 
-void RenderThread::initExtensions()
+void RenderThread::renderInline()
 {
-#ifdef _WIN32
-	// get pointers to GL functions
-	pglGenFramebuffers                     = (PFNGLGENFRAMEBUFFERSPROC)wglGetProcAddress("glGenFramebuffers");
-	pglDeleteFramebuffers                  = (PFNGLDELETEFRAMEBUFFERSPROC)wglGetProcAddress("glDeleteFramebuffers");
-	pglBindFramebuffer                     = (PFNGLBINDFRAMEBUFFERPROC)wglGetProcAddress("glBindFramebuffer");
-	pglCheckFramebufferStatus              = (PFNGLCHECKFRAMEBUFFERSTATUSPROC)wglGetProcAddress("glCheckFramebufferStatus");
-	pglGetFramebufferAttachmentParameteriv = (PFNGLGETFRAMEBUFFERATTACHMENTPARAMETERIVPROC)wglGetProcAddress("glGetFramebufferAttachmentParameteriv");
-	pglGenerateMipmap                      = (PFNGLGENERATEMIPMAPPROC)wglGetProcAddress("glGenerateMipmap");
-	pglFramebufferTexture2D                = (PFNGLFRAMEBUFFERTEXTURE2DPROC)wglGetProcAddress("glFramebufferTexture2D");
-	pglFramebufferRenderbuffer             = (PFNGLFRAMEBUFFERRENDERBUFFERPROC)wglGetProcAddress("glFramebufferRenderbuffer");
-	pglGenRenderbuffers                    = (PFNGLGENRENDERBUFFERSPROC)wglGetProcAddress("glGenRenderbuffers");
-	pglDeleteRenderbuffers                 = (PFNGLDELETERENDERBUFFERSPROC)wglGetProcAddress("glDeleteRenderbuffers");
-	pglBindRenderbuffer                    = (PFNGLBINDRENDERBUFFERPROC)wglGetProcAddress("glBindRenderbuffer");
-	pglRenderbufferStorage                 = (PFNGLRENDERBUFFERSTORAGEPROC)wglGetProcAddress("glRenderbufferStorage");
-	pglGetRenderbufferParameteriv          = (PFNGLGETRENDERBUFFERPARAMETERIVPROC)wglGetProcAddress("glGetRenderbufferParameteriv");
-	pglIsRenderbuffer                      = (PFNGLISRENDERBUFFERPROC)wglGetProcAddress("glIsRenderbuffer");
-
-	// check once again FBO extension
-	if(!pglGenFramebuffers || !pglDeleteFramebuffers || !pglBindFramebuffer || !pglCheckFramebufferStatus ||
-		!pglGetFramebufferAttachmentParameteriv || !pglGenerateMipmap || !pglFramebufferTexture2D || !pglFramebufferRenderbuffer ||
-		!pglGenRenderbuffers || !pglDeleteRenderbuffers || !pglBindRenderbuffer || !pglRenderbufferStorage ||
-		!pglGetRenderbufferParameteriv || !pglIsRenderbuffer)
-	{
-		BOOST_ASSERT_MSG(false, "Video card does NOT support GL_ARB_framebuffer_object.");
-	}
-	
-	pglCreateProgram = (PFNGLCREATEPROGRAMPROC)wglGetProcAddress("glCreateProgram");
-	pglCreateShader = (PFNGLCREATESHADERPROC)wglGetProcAddress("glCreateShader");
-	pglShaderSource = (PFNGLSHADERSOURCEPROC)wglGetProcAddress("glShaderSource");
-	pglCompileShader = (PFNGLCOMPILESHADERPROC)wglGetProcAddress("glCompileShader");
-	pglGetObjectParameterivARB = (PFNGLGETOBJECTPARAMETERIVARBPROC)wglGetProcAddress("glGetObjectParameterivARB");
-	pglAttachShader = (PFNGLATTACHSHADERPROC)wglGetProcAddress("glAttachShader");
-	pglLinkProgram = (PFNGLLINKPROGRAMPROC)wglGetProcAddress("glLinkProgram");
-	pglGetShaderiv = (PFNGLGETSHADERIVPROC)wglGetProcAddress("glGetShaderiv");
-	pglGetProgramivARB = (PFNGLGETPROGRAMIVARBPROC)wglGetProcAddress("glGetProgramivARB");
-	pglUseProgram = (PFNGLUSEPROGRAMPROC)wglGetProcAddress("glUseProgram");
-	pglGetUniformLocation = (PFNGLGETUNIFORMLOCATIONPROC)wglGetProcAddress("glGetUniformLocation");
-	pglUniform2f = (PFNGLUNIFORM2FPROC)wglGetProcAddress("glUniform2f");
-	pglUniform1i = (PFNGLUNIFORM1IPROC)wglGetProcAddress("glUniform1i");
-
-	if (!pglCreateProgram || !pglCreateShader || !pglShaderSource || !pglCompileShader || !pglGetObjectParameterivARB ||
-		!pglAttachShader || !pglLinkProgram || !pglGetShaderiv || !pglGetProgramivARB || !pglUseProgram ||
-		!pglGetUniformLocation || !pglUniform2f || !pglUniform1i )
-	{
-		BOOST_ASSERT_MSG(false, "Video card does NOT support loading shader extensions.");
-	}
-
-	pglBindBuffer = (PFNGLBINDBUFFERPROC)wglGetProcAddress("glBindBuffer");
-	pglGenBuffers = (PFNGLGENBUFFERSPROC)wglGetProcAddress("glGenBuffers");
-	pglBufferData = (PFNGLBUFFERDATAPROC)wglGetProcAddress("glBufferData");
-
-	if (!pglBindBuffer || !pglGenBuffers || !pglBufferData) {
-		BOOST_ASSERT_MSG(false, "Video card does NOT support vertex buffer objects.");
-	}
-
-	pglActiveTexture = (PFNGLACTIVETEXTUREPROC)wglGetProcAddress("glActiveTexture");
-
-	if (!pglActiveTexture) {
-		BOOST_ASSERT_MSG(false, "Video card does NOT support glActiveTexture");
+	std::vector<WindowRendererRef> requested;
+	for (size_t i = 0; i < _renderers.size(); i++) {
+		if (_renderers[i]->takeFrameRequest()) {
+			requested.push_back(_renderers[i]);
+		}
 	}
-
-#endif
+	renderFrame(requested);
 }
 
-void RenderThread::initStereoCompositeShader()
+void RenderThread::renderFrame(const std::vector<WindowRendererRef> &requested)
 {
-	// Only bother if we actually need the shader
-	if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
-		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
-		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS) {
-
-		
-		GLuint vertexShader, fragmentShader;
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);	
-	
-		std::string vertexShaderName = DataFileUtils::findDataFile("shaders/stereo.vert");
-		BOOST_ASSERT_MSG(boost::filesystem::exists(vertexShaderName), "Unable to load vertex shader for stereo in RenderThread.cpp. File not found");
-		const char* vs = readWholeFile(vertexShaderName).c_str();
-
-		std::string fragShaderName = "";
-		if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD) {
-			fragShaderName = DataFileUtils::findDataFile("shaders/stereo-checkerboard.frag");
+	std::vector<SwapGroupRef> groups;
+	for (size_t i = 0; i < requested.size(); i++) {
+		makeCurrent(requested[i]);
+		requested[i]->draw(_app);
+
+		SwapGroupRef group = requested[i]->getSwapGroup();
+		if (std::find(groups.begin(), groups.end(), group) == groups.end()) {
+			groups.push_back(group);
 		}
-		else if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS) {
-			fragShaderName = DataFileUtils::findDataFile("shaders/stereo-interlacedcolumns.frag");
-		}
-		else if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS) {
-			fragShaderName = DataFileUtils::findDataFile("shaders/stereo-interlacedrows.frag");
+	}
+	std::sort(groups.begin(), groups.end(), swapGroupIdLess);
+
+	// The main loop does not wait for secondary groups to swap, only for the app's drawing to finish
+	int numSecondary = 0;
+	for (size_t i = 0; i < requested.size(); i++) {
+		if (!requested[i]->getSwapGroup()->isPrimary()) {
+			requested[i]->setSwapping(true);
+			numSecondary++;
 		}
-
-		BOOST_ASSERT_MSG(boost::filesystem::exists(fragShaderName), "Unable to load fragment shader for stereo in RenderThread.cpp. File not found");
-		const char* fs = readWholeFile(fragShaderName).c_str();
-	
-		glShaderSource(vertexShader, 1, &vs,NULL);
-		glShaderSource(fragmentShader, 1, &fs,NULL);
-	
-		glCompileShader(vertexShader);
-		glCompileShader(fragmentShader);
-	
-		_stereoProgram = glCreateProgram();
-		
-		glAttachShader(_stereoProgram,vertexShader);
-		glAttachShader(_stereoProgram,fragmentShader);
-	
-		glLinkProgram(_stereoProgram);
 	}
-}
+	if (numSecondary > 0 && !_inline) {
+		signalRenderingComplete(numSecondary);
+	}
 
-void RenderThread::initStereoFramebufferAndTextures() {
-	// Only bother if we actually need the textures and fbo for stereo
-	if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
-		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
-		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS) {
-
-		// Create eye textures
-		glGenTextures(1, &_leftEyeTexture);
-		glGenTextures(1, &_rightEyeTexture);
-
-		glBindTexture(GL_TEXTURE_2D, _leftEyeTexture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _window->getWidth(), _window->getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL); 
-
-		glBindTexture(GL_TEXTURE_2D, _rightEyeTexture);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, _window->getWidth(), _window->getHeight(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL); 
-
-		glBindTexture(GL_TEXTURE_2D, 0);
-	
-		// Setup framebuffer object
-		glGenFramebuffers(1, &_stereoFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, _stereoFBO);
-
-		// create a renderbuffer object to store depth info
-		glGenRenderbuffers(1, &_depthRBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, _depthRBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, _window->getWidth(), _window->getHeight());
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-		// attach a texture to FBO color attachement point
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _leftEyeTexture, 0);
-
-		// attach a renderbuffer to depth attachment point
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthRBO);
-
-		// check FBO status
-		GLenum e = glCheckFramebufferStatus(GL_FRAMEBUFFER);
-		std::string message = "";
-		switch (e) {
-			case GL_FRAMEBUFFER_UNDEFINED:
-				message = "FBO Undefined";
-				break;
-			case GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT :
-				message = "FBO Incomplete Attachment";
-				break;
-			case GL_FRAMEBUFFER_INCOMPLETE_MISSING_ATTACHMENT :
-				message = "FBO Missing Attachment";
-				break;
-			case GL_FRAMEBUFFER_INCOMPLETE_DRAW_BUFFER :
-				message = "FBO Incomplete Draw Buffer";
-				break;
-			case GL_FRAMEBUFFER_UNSUPPORTED :
-				message = "FBO Unsupported";
-				break;
-			case GL_FRAMEBUFFER_COMPLETE:
-				message = "FBO OK";
-				break;
-			default:
-				message = "FBO Problem?";
+	for (size_t g = 0; g < groups.size(); g++) {
+		// Wait for the other threads with windows in the swap group to get here before swapping buffers
+		if (!_inline) {
+			groups[g]->getBarrier()->wait();
 		}
 
-		if (e != GL_FRAMEBUFFER_COMPLETE) {
-			BOOST_ASSERT_MSG(false, message.c_str());
+		int numSwapped = 0;
+		for (size_t i = 0; i < requested.size(); i++) {
+			if (requested[i]->getSwapGroup() == groups[g]) {
+				makeCurrent(requested[i]);
+				requested[i]->swap();
+				requested[i]->setSwapping(false);
+				numSwapped++;
+			}
+		}
+		if (groups[g]->isPrimary() && !_inline) {
+			signalRenderingComplete(numSwapped);
 		}
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		//Setup fullscreen quad vbo
-		_fullscreenVertices[0] = -1.0;
-		_fullscreenVertices[1] = -1.0;
-		_fullscreenVertices[2] = 1.0;
-		_fullscreenVertices[3] = -1.0;
-		_fullscreenVertices[4] = 1.0;
-		_fullscreenVertices[5] = 1.0;
-		_fullscreenVertices[6] = -1.0;
-		_fullscreenVertices[7] =  1.0;
-		_fullscreenIndices[0] = 0;
-		_fullscreenIndices[1] = 1;
-		_fullscreenIndices[2] = 2;
-		_fullscreenIndices[3] = 3;
-
-		//Create VBO
-		glGenBuffers( 1, &_vertexBuffer );
-		glBindBuffer( GL_ARRAY_BUFFER, _vertexBuffer );
-		glBufferData( GL_ARRAY_BUFFER, 8 * sizeof(GLfloat), _fullscreenVertices, GL_STATIC_DRAW );
-
-		//Create IBO
-		glGenBuffers( 1, &_indexBuffer );
-		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, _indexBuffer );
-		glBufferData( GL_ELEMENT_ARRAY_BUFFER, 4 * sizeof(GLuint), _fullscreenIndices, GL_STATIC_DRAW );
+	}
+	// The main thread keeps its own statistics
+	if (!_inline) {
+		_threadStats.sample();
 	}
 }
 
-void RenderThread::setShaderVariables()
+void RenderThread::finish()
 {
-	// Only bother if we actually need the textures and fbo for stereo
-	if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
-		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
-		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS)
-	{
-		glUseProgram(_stereoProgram);
-
-		GLint screenSizeLoc = glGetUniformLocation(_stereoProgram, "screenSize");
-		glUniform2f(screenSizeLoc, (GLfloat)_window->getWidth(), (GLfloat)_window->getHeight());
-
-		GLuint leftEyeTexLoc  = glGetUniformLocation(_stereoProgram, "leftEyeTexture");
-		GLuint rightEyeTexLoc = glGetUniformLocation(_stereoProgram, "rightEyeTexture");
-		glUniform1i(leftEyeTexLoc, 0);
-		glUniform1i(rightEyeTexLoc, 1);
-
-		glUseProgram(0);
+	if (_finished) {
+		return;
+	}
+	_finished = true;
+
+	if (!_inline) {
+		_threadStats.log(_name);
+	}
+	for (size_t i = 0; i < _renderers.size(); i++) {
+		makeCurrent(_renderers[i]);
+		_renderers[i]->finish();
 	}
 }
 
-} // end namespace
\ No newline at end of file
+void RenderThread::signalRenderingComplete(int numWindows)
+{
+	_renderingCompleteMutex->lock();
+	numThreadsReceivedRenderingComplete += numWindows;
+	_renderingCompleteCond->notify_all();
+	_renderingCompleteMutex->unlock();
+}
+
+}// End namespace
@@ -0,0 +1,518 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/ReprojectionRenderer.H"
+#include "MVRCore/CameraOffAxis.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/TimeService.H"
+#include <boost/chrono.hpp>
+#include <algorithm>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+// Pixels between the vertices of the warp grid
+#define GRID_CELL_SIZE 8
+
+// The grid covers a viewport from 0 to 1. Each vertex takes the depth under it and is moved
+// from the old eye's clip space to the new one's.
+static const char* reprojectionVertexShader =
+	"#version 120\n"
+	"uniform sampler2D depthTexture;\n"
+	"uniform vec4 textureRect;\n"
+	"uniform mat4 reprojection;\n"
+	"varying vec2 texCoord;\n"
+	"void main(void)\n"
+	"{\n"
+	"  texCoord = textureRect.xy + gl_Vertex.xy * textureRect.zw;\n"
+	"  float depth = texture2DLod(depthTexture, texCoord, 0.0).r;\n"
+	"  gl_Position = reprojection * vec4(gl_Vertex.xy * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);\n"
+	"}\n";
+
+static const char* reprojectionFragmentShader =
+	"#version 120\n"
+	"uniform sampler2D colorTexture;\n"
+	"varying vec2 texCoord;\n"
+	"void main(void)\n"
+	"{\n"
+	"  gl_FragColor = texture2D(colorTexture, texCoord);\n"
+	"}\n";
+
+static GLuint compileShader(GLenum type, const char* source, const std::string &name)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLint logLength = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength > 1 ? logLength : 1, '\0');
+		glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+		std::cout << "Error compiling shader " << name << ":" << std::endl << &log[0] << std::endl;
+		BOOST_ASSERT_MSG(false, "Unable to compile the reprojection shader in ReprojectionRenderer.cpp.");
+	}
+	return shader;
+}
+
+static int getAttachmentIndex(GLenum drawBuffer)
+{
+	return drawBuffer == GL_BACK_RIGHT ? 1 : 0;
+}
+
+static void applyEye(AbstractCameraRef camera, int eye)
+{
+	if (eye == 1) {
+		camera->applyProjectionAndCameraMatricesForLeftEye();
+	}
+	else if (eye == 2) {
+		camera->applyProjectionAndCameraMatricesForRightEye();
+	}
+	else {
+		camera->applyProjectionAndCameraMatrices();
+	}
+}
+
+static double secondsSince(const boost::posix_time::ptime &start)
+{
+	return (TimeService::localTime() - start).total_microseconds() / 1000000.0;
+}
+
+bool ReprojectionRenderer::isSupported(WindowRef window)
+{
+	WindowSettingsRef settings = window->getSettings();
+	if (settings->stereo && (settings->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
+		settings->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
+		settings->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS)) {
+		return false;
+	}
+	for (int v = 0; v < (int)window->getNumViewports(); v++) {
+		if (!std::dynamic_pointer_cast<CameraOffAxis>(window->getCamera(v))) {
+			return false;
+		}
+	}
+	return window->getNumViewports() > 0;
+}
+
+ReprojectionRenderer::ReprojectionRenderer(WindowRef window, WindowRef workerWindow, double deadline) :
+	_window(window), _workerWindow(workerWindow), _workerThreadId(-1), _deadline(deadline), _width(window->getWidth()), _height(window->getHeight()),
+	_drawIndex(0), _completedIndex(-1), _presentIndex(-1), _initialized(false), _frameRequested(false), _busy(false), _stopping(false), _finished(false),
+	_readFBO(0), _program(0), _vertexBuffer(0), _indexBuffer(0), _numIndices(0), _textureRectLocation(-1), _reprojectionLocation(-1),
+	_numPresented(0), _numReprojected(0), _numAppFrames(0), _appSeconds(0.0), _maxAppSeconds(0.0)
+{
+	_passes = SplitRenderer::getPasses(window);
+	for (size_t i = 0; i < _passes.size(); i++) {
+		if (std::find(_drawBuffers.begin(), _drawBuffers.end(), _passes[i].drawBuffer) == _drawBuffers.end()) {
+			_drawBuffers.push_back(_passes[i].drawBuffer);
+		}
+	}
+	for (int f = 0; f < 2; f++) {
+		for (int a = 0; a < 2; a++) {
+			_frames[f].fbos[a] = 0;
+			_frames[f].colorTextures[a] = 0;
+			_frames[f].depthTextures[a] = 0;
+		}
+	}
+}
+
+ReprojectionRenderer::~ReprojectionRenderer()
+{
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_stopping = true;
+		_workerCond.notify_all();
+	}
+	if (_thread) {
+		_thread->join();
+	}
+}
+
+int ReprojectionRenderer::assignThreadIds(int firstThreadId)
+{
+	_workerThreadId = firstThreadId;
+	return 1;
+}
+
+void ReprojectionRenderer::initialize(AbstractMVRAppRef app)
+{
+	_app = app;
+	_thread.reset(new boost::thread(&ReprojectionRenderer::runWorker, this));
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	while (!_initialized) {
+		_doneCond.wait(lock);
+	}
+	lock.unlock();
+
+	initReprojection();
+}
+
+void ReprojectionRenderer::initReprojection()
+{
+	GLuint vertexShader = compileShader(GL_VERTEX_SHADER, reprojectionVertexShader, "reprojection.vert");
+	GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, reprojectionFragmentShader, "reprojection.frag");
+	_program = glCreateProgram();
+	glAttachShader(_program, vertexShader);
+	glAttachShader(_program, fragmentShader);
+	glLinkProgram(_program);
+	glDetachShader(_program, vertexShader);
+	glDetachShader(_program, fragmentShader);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(_program, GL_LINK_STATUS, &linked);
+	BOOST_ASSERT_MSG(linked == GL_TRUE, "Unable to link the reprojection shader in ReprojectionRenderer.cpp.");
+
+	glUseProgram(_program);
+	glUniform1i(glGetUniformLocation(_program, "colorTexture"), 0);
+	glUniform1i(glGetUniformLocation(_program, "depthTexture"), 1);
+	_textureRectLocation = glGetUniformLocation(_program, "textureRect");
+	_reprojectionLocation = glGetUniformLocation(_program, "reprojection");
+	glUseProgram(0);
+
+	int columns = std::max(_width / GRID_CELL_SIZE, 1);
+	int rows = std::max(_height / GRID_CELL_SIZE, 1);
+	std::vector<GLfloat> vertices;
+	for (int y = 0; y <= rows; y++) {
+		for (int x = 0; x <= columns; x++) {
+			vertices.push_back((GLfloat)x / columns);
+			vertices.push_back((GLfloat)y / rows);
+		}
+	}
+	std::vector<GLuint> indices;
+	for (int y = 0; y < rows; y++) {
+		for (int x = 0; x < columns; x++) {
+			GLuint corner = y * (columns+1) + x;
+			GLuint above = corner + columns + 1;
+			indices.push_back(corner);
+			indices.push_back(corner + 1);
+			indices.push_back(above + 1);
+			indices.push_back(corner);
+			indices.push_back(above + 1);
+			indices.push_back(above);
+		}
+	}
+	_numIndices = (GLsizei)indices.size();
+
+	glGenBuffers(1, &_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glGenBuffers(1, &_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// Framebuffer objects are not shared, so the window reads the worker's textures through its own
+	glGenFramebuffers(1, &_readFBO);
+}
+
+void ReprojectionRenderer::createFrame(Frame &frame)
+{
+	int numAttachments = 1;
+	for (size_t i = 0; i < _drawBuffers.size(); i++) {
+		numAttachments = std::max(numAttachments, getAttachmentIndex(_drawBuffers[i]) + 1);
+	}
+
+	for (int a = 0; a < numAttachments; a++) {
+		glGenTextures(1, &frame.colorTextures[a]);
+		glBindTexture(GL_TEXTURE_2D, frame.colorTextures[a]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+		// Depth is a texture rather than a renderbuffer so the warp can read it
+		glGenTextures(1, &frame.depthTextures[a]);
+		glBindTexture(GL_TEXTURE_2D, frame.depthTextures[a]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, _width, _height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &frame.fbos[a]);
+		glBindFramebuffer(GL_FRAMEBUFFER, frame.fbos[a]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.colorTextures[a], 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, frame.depthTextures[a], 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_TEXTURE_2D, frame.depthTextures[a], 0);
+		GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+		BOOST_ASSERT_MSG(status == GL_FRAMEBUFFER_COMPLETE, "ReprojectionRenderer: the worker's framebuffer is incomplete.");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ReprojectionRenderer::deleteFrame(Frame &frame)
+{
+	glDeleteFramebuffers(2, frame.fbos);
+	glDeleteTextures(2, frame.colorTextures);
+	glDeleteTextures(2, frame.depthTextures);
+}
+
+void ReprojectionRenderer::runWorker()
+{
+	_workerWindow->makeContextCurrent();
+	GLExtensions::init();
+	createFrame(_frames[0]);
+	createFrame(_frames[1]);
+	_app->initializeContextSpecificVars(_workerThreadId, _window);
+	// The window's context uses the textures as soon as initialize returns
+	glFinish();
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	_initialized = true;
+	_doneCond.notify_all();
+
+	while (true) {
+		while (!_frameRequested && !_stopping) {
+			_workerCond.wait(lock);
+		}
+		if (_stopping) {
+			break;
+		}
+		_frameRequested = false;
+		lock.unlock();
+
+		drawFrame(_frames[_drawIndex]);
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+		}
+		glDeleteSync(fence);
+
+		lock.lock();
+		double seconds = secondsSince(_frameStart);
+		_numAppFrames++;
+		_appSeconds += seconds;
+		_maxAppSeconds = std::max(_maxAppSeconds, seconds);
+		_completedIndex = _drawIndex;
+		_busy = false;
+		_doneCond.notify_all();
+	}
+	lock.unlock();
+
+	deleteFrame(_frames[0]);
+	deleteFrame(_frames[1]);
+	_workerWindow->releaseContext();
+}
+
+void ReprojectionRenderer::drawFrame(Frame &frame)
+{
+	frame.viewProjections.resize(_passes.size());
+	for (size_t i = 0; i < _passes.size(); i++) {
+		SplitRenderer::Pass &pass = _passes[i];
+		if (i == 0 || pass.drawBuffer != _passes[i-1].drawBuffer) {
+			glBindFramebuffer(GL_FRAMEBUFFER, frame.fbos[getAttachmentIndex(pass.drawBuffer)]);
+			glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		glViewport(pass.rect.x0(), pass.rect.y0(), pass.rect.width(), pass.rect.height());
+		AbstractCameraRef camera = _cameras[pass.viewport];
+		applyEye(camera, pass.eye);
+		CameraOffAxis* offAxis = (CameraOffAxis*)camera.get();
+		frame.viewProjections[i] = offAxis->getLastAppliedProjectionMatrix() * offAxis->getLastAppliedViewMatrix();
+		_app->drawGraphics(_workerThreadId, camera, _window);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ReprojectionRenderer::requestFrame()
+{
+	// The worker draws into the frame the window does not present
+	_drawIndex = (_presentIndex == 0) ? 1 : 0;
+	_cameras.clear();
+	for (int v = 0; v < (int)_window->getNumViewports(); v++) {
+		_cameras.push_back(_window->getCamera(v)->clone());
+	}
+	_frameStart = TimeService::localTime();
+	_busy = true;
+	_frameRequested = true;
+	_workerCond.notify_all();
+}
+
+void ReprojectionRenderer::takeCompletedFrame()
+{
+	if (_completedIndex >= 0) {
+		_presentIndex = _completedIndex;
+		_completedIndex = -1;
+	}
+}
+
+void ReprojectionRenderer::renderFrame()
+{
+	// Absolute ptimes are waited for on the wall clock, which the engine's timeline does not follow
+	boost::chrono::steady_clock::time_point deadline = boost::chrono::steady_clock::now() + boost::chrono::microseconds((boost::int64_t)(_deadline * 1000000.0));
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	// A frame that missed the last deadline is still newer than the one presented
+	takeCompletedFrame();
+	if (!_busy) {
+		requestFrame();
+	}
+	while (_busy) {
+		// There is nothing to re-project before the first frame
+		if (_presentIndex < 0) {
+			_doneCond.wait(lock);
+		}
+		else if (_doneCond.wait_until(lock, deadline) == boost::cv_status::timeout) {
+			break;
+		}
+	}
+	bool newFrame = (_completedIndex >= 0);
+	takeCompletedFrame();
+	lock.unlock();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	for (size_t i = 0; i < _drawBuffers.size(); i++) {
+		glDrawBuffer(_drawBuffers[i]);
+		glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+	if (newFrame) {
+		presentFrame(_frames[_presentIndex]);
+	}
+	else {
+		reprojectFrame(_frames[_presentIndex]);
+		_numReprojected++;
+	}
+	_numPresented++;
+	glDrawBuffer(_drawBuffers[0]);
+}
+
+void ReprojectionRenderer::presentFrame(Frame &frame)
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, _readFBO);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	for (size_t i = 0; i < _passes.size(); i++) {
+		SplitRenderer::Pass &pass = _passes[i];
+		// Attaching the texture again makes the worker's changes visible in this context
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frame.colorTextures[getAttachmentIndex(pass.drawBuffer)], 0);
+		glDrawBuffer(pass.drawBuffer);
+		int x0 = pass.rect.x0();
+		int y0 = pass.rect.y0();
+		int x1 = x0 + pass.rect.width();
+		int y1 = y0 + pass.rect.height();
+		glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(_drawBuffers[0]);
+}
+
+void ReprojectionRenderer::reprojectFrame(Frame &frame)
+{
+	// Where the warped grid folds over itself, the nearer surface wins
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LESS);
+
+	glUseProgram(_program);
+	glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(2, GL_FLOAT, 0, 0);
+
+	for (size_t i = 0; i < _passes.size(); i++) {
+		SplitRenderer::Pass &pass = _passes[i];
+		int attachment = getAttachmentIndex(pass.drawBuffer);
+		glDrawBuffer(pass.drawBuffer);
+		glViewport(pass.rect.x0(), pass.rect.y0(), pass.rect.width(), pass.rect.height());
+
+		// The current head pose, from a copy so the window's camera keeps its matrices
+		AbstractCameraRef camera = _window->getCamera(pass.viewport)->clone();
+		applyEye(camera, pass.eye);
+		CameraOffAxis* offAxis = (CameraOffAxis*)camera.get();
+		glm::dmat4 reprojection = offAxis->getLastAppliedProjectionMatrix() * offAxis->getLastAppliedViewMatrix() * glm::inverse(frame.viewProjections[i]);
+		GLfloat matrix[16];
+		for (int c = 0; c < 4; ++c) {
+			for (int r = 0; r < 4; ++r) {
+				matrix[c*4+r] = (GLfloat)reprojection[c][r];
+			}
+		}
+		glUniformMatrix4fv(_reprojectionLocation, 1, GL_FALSE, matrix);
+		glUniform4f(_textureRectLocation, (GLfloat)pass.rect.x0() / _width, (GLfloat)pass.rect.y0() / _height,
+			(GLfloat)pass.rect.width() / _width, (GLfloat)pass.rect.height() / _height);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, frame.colorTextures[attachment]);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, frame.depthTextures[attachment]);
+		glDrawElements(GL_TRIANGLES, _numIndices, GL_UNSIGNED_INT, 0);
+	}
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+	if (!depthTest) {
+		glDisable(GL_DEPTH_TEST);
+	}
+}
+
+void ReprojectionRenderer::finish(const std::string &windowName)
+{
+	if (_finished) {
+		return;
+	}
+	_finished = true;
+
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_stopping = true;
+		_workerCond.notify_all();
+	}
+	if (_thread) {
+		_thread->join();
+		_thread.reset();
+	}
+	glDeleteFramebuffers(1, &_readFBO);
+	glDeleteBuffers(1, &_vertexBuffer);
+	glDeleteBuffers(1, &_indexBuffer);
+	glDeleteProgram(_program);
+
+	double percent = _numPresented > 0 ? 100.0 * _numReprojected / _numPresented : 0.0;
+	double average = _numAppFrames > 0 ? 1000.0 * _appSeconds / _numAppFrames : 0.0;
+	MINVR_LOG_INFO(Logger::core()) << windowName << ": presented " << _numPresented << " frames, " << _numReprojected << " re-projected (" << percent << "%).";
+	MINVR_LOG_INFO(Logger::core()) << windowName << ": the app's frames took " << average << " ms on average and " << 1000.0 * _maxAppSeconds << " ms at most, the deadline is " << 1000.0 * _deadline << " ms.";
+}
+
+} // end namespace
@@ -0,0 +1,285 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/RigidTransform.H"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MINVR_USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+namespace MinVR {
+
+// The batch math is written once against a lane type. double processes one report at a time,
+// Double2 processes two reports at a time in an SSE2 register.
+template <class T>
+struct LaneQuat {
+	T x, y, z, w;
+};
+
+template <class T>
+struct LaneVec3 {
+	T x, y, z;
+};
+
+template <class T>
+static inline LaneQuat<T> multiply(const LaneQuat<T> &a, const LaneQuat<T> &b)
+{
+	LaneQuat<T> r;
+	r.w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
+	r.x = a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y;
+	r.y = a.w*b.y - a.x*b.z + a.y*b.w + a.z*b.x;
+	r.z = a.w*b.z + a.x*b.y - a.y*b.x + a.z*b.w;
+	return r;
+}
+
+template <class T>
+static inline LaneVec3<T> cross(const T &ax, const T &ay, const T &az, const LaneVec3<T> &b)
+{
+	LaneVec3<T> r;
+	r.x = ay*b.z - az*b.y;
+	r.y = az*b.x - ax*b.z;
+	r.z = ax*b.y - ay*b.x;
+	return r;
+}
+
+// v + 2w(u x v) + 2u x (u x v) for a unit quaternion (u, w)
+template <class T>
+static inline LaneVec3<T> rotate(const LaneQuat<T> &q, const LaneVec3<T> &v)
+{
+	LaneVec3<T> t = cross(q.x, q.y, q.z, v);
+	t.x = t.x + t.x;
+	t.y = t.y + t.y;
+	t.z = t.z + t.z;
+	LaneVec3<T> u = cross(q.x, q.y, q.z, t);
+	LaneVec3<T> r;
+	r.x = v.x + q.w*t.x + u.x;
+	r.y = v.y + q.w*t.y + u.y;
+	r.z = v.z + q.w*t.z + u.z;
+	return r;
+}
+
+// pre * (rotation, scale * translation) * post, returned as the rotation matrix columns and the translation
+template <class T>
+static inline void composeLanes(const LaneQuat<T> &preRot, const LaneVec3<T> &preTrans,
+	const LaneQuat<T> &postRot, const LaneVec3<T> &postTrans,
+	const LaneQuat<T> &rot, const LaneVec3<T> &trans, const T &scale,
+	T m[3][3], LaneVec3<T> &translation)
+{
+	LaneQuat<T> q = multiply(multiply(preRot, rot), postRot);
+
+	LaneVec3<T> inner = rotate(rot, postTrans);
+	inner.x = inner.x + scale*trans.x;
+	inner.y = inner.y + scale*trans.y;
+	inner.z = inner.z + scale*trans.z;
+	translation = rotate(preRot, inner);
+	translation.x = translation.x + preTrans.x;
+	translation.y = translation.y + preTrans.y;
+	translation.z = translation.z + preTrans.z;
+
+	T x2 = q.x + q.x;
+	T y2 = q.y + q.y;
+	T z2 = q.z + q.z;
+	T xx = q.x*x2;
+	T yy = q.y*y2;
+	T zz = q.z*z2;
+	T xy = q.x*y2;
+	T xz = q.x*z2;
+	T yz = q.y*z2;
+	T wx = q.w*x2;
+	T wy = q.w*y2;
+	T wz = q.w*z2;
+	T one = T(1.0);
+	m[0][0] = one - (yy + zz);
+	m[0][1] = xy + wz;
+	m[0][2] = xz - wy;
+	m[1][0] = xy - wz;
+	m[1][1] = one - (xx + zz);
+	m[1][2] = yz + wx;
+	m[2][0] = xz + wy;
+	m[2][1] = yz - wx;
+	m[2][2] = one - (xx + yy);
+}
+
+static inline void transformOne(const RigidTransform &pre, const RigidTransform &post,
+	const glm::dquat &rotation, const glm::dvec3 &translation, double scale, glm::dmat4 &result)
+{
+	LaneQuat<double> preRot = { pre.rotation.x, pre.rotation.y, pre.rotation.z, pre.rotation.w };
+	LaneVec3<double> preTrans = { pre.translation.x, pre.translation.y, pre.translation.z };
+	LaneQuat<double> postRot = { post.rotation.x, post.rotation.y, post.rotation.z, post.rotation.w };
+	LaneVec3<double> postTrans = { post.translation.x, post.translation.y, post.translation.z };
+	LaneQuat<double> rot = { rotation.x, rotation.y, rotation.z, rotation.w };
+	LaneVec3<double> trans = { translation.x, translation.y, translation.z };
+
+	double m[3][3];
+	LaneVec3<double> t;
+	composeLanes(preRot, preTrans, postRot, postTrans, rot, trans, scale, m, t);
+
+	for (int c = 0; c < 3; c++) {
+		result[c] = glm::dvec4(m[c][0], m[c][1], m[c][2], 0.0);
+	}
+	result[3] = glm::dvec4(t.x, t.y, t.z, 1.0);
+}
+
+#ifdef MINVR_USE_SSE2
+
+struct Double2 {
+	__m128d v;
+	Double2() {}
+	Double2(__m128d value) : v(value) {}
+	explicit Double2(double value) : v(_mm_set1_pd(value)) {}
+	Double2(double lane0, double lane1) : v(_mm_set_pd(lane1, lane0)) {}
+};
+
+static inline Double2 operator+(const Double2 &a, const Double2 &b) { return Double2(_mm_add_pd(a.v, b.v)); }
+static inline Double2 operator-(const Double2 &a, const Double2 &b) { return Double2(_mm_sub_pd(a.v, b.v)); }
+static inline Double2 operator*(const Double2 &a, const Double2 &b) { return Double2(_mm_mul_pd(a.v, b.v)); }
+
+static inline LaneQuat<Double2> loadQuat(const glm::dquat &a, const glm::dquat &b)
+{
+	LaneQuat<Double2> q = { Double2(a.x, b.x), Double2(a.y, b.y), Double2(a.z, b.z), Double2(a.w, b.w) };
+	return q;
+}
+
+static inline LaneVec3<Double2> loadVec3(const glm::dvec3 &a, const glm::dvec3 &b)
+{
+	LaneVec3<Double2> v = { Double2(a.x, b.x), Double2(a.y, b.y), Double2(a.z, b.z) };
+	return v;
+}
+
+static inline void storeColumn(glm::dmat4 &a, glm::dmat4 &b, int column, const Double2 &x, const Double2 &y, const Double2 &z, double w)
+{
+	double* colA = &a[column][0];
+	double* colB = &b[column][0];
+	_mm_storel_pd(colA, x.v);
+	_mm_storeh_pd(colB, x.v);
+	_mm_storel_pd(colA + 1, y.v);
+	_mm_storeh_pd(colB + 1, y.v);
+	_mm_storel_pd(colA + 2, z.v);
+	_mm_storeh_pd(colB + 2, z.v);
+	colA[3] = w;
+	colB[3] = w;
+}
+
+#endif // MINVR_USE_SSE2
+
+RigidTransform::RigidTransform() : rotation(1.0, 0.0, 0.0, 0.0), translation(0.0)
+{
+}
+
+RigidTransform::RigidTransform(const glm::dquat &rotation, const glm::dvec3 &translation) : rotation(rotation), translation(translation)
+{
+}
+
+bool RigidTransform::fromMatrix(const glm::dmat4 &matrix, RigidTransform &result)
+{
+	const double tolerance = 1e-6;
+	if (std::abs(matrix[0][3]) > tolerance || std::abs(matrix[1][3]) > tolerance ||
+		std::abs(matrix[2][3]) > tolerance || std::abs(matrix[3][3] - 1.0) > tolerance) {
+		return false;
+	}
+
+	glm::dmat3 rot(matrix[0][0], matrix[0][1], matrix[0][2],
+				   matrix[1][0], matrix[1][1], matrix[1][2],
+				   matrix[2][0], matrix[2][1], matrix[2][2]);
+	glm::dmat3 shouldBeIdentity = glm::transpose(rot) * rot;
+	for (int c = 0; c < 3; c++) {
+		for (int r = 0; r < 3; r++) {
+			if (std::abs(shouldBeIdentity[c][r] - (c == r ? 1.0 : 0.0)) > tolerance) {
+				return false;
+			}
+		}
+	}
+	// A quaternion cannot represent a reflection
+	if (glm::determinant(rot) < 0.0) {
+		return false;
+	}
+
+	result.rotation = glm::normalize(glm::quat_cast(rot));
+	result.translation = glm::dvec3(matrix[3]);
+	return true;
+}
+
+glm::dmat4 RigidTransform::toMatrix() const
+{
+	glm::dmat4 m = glm::mat4_cast(rotation);
+	m[3] = glm::dvec4(translation, 1.0);
+	return m;
+}
+
+RigidTransform RigidTransform::operator*(const RigidTransform &other) const
+{
+	return RigidTransform(rotation * other.rotation, transformPoint(other.translation));
+}
+
+glm::dvec3 RigidTransform::transformPoint(const glm::dvec3 &point) const
+{
+	return rotation * point + translation;
+}
+
+void RigidTransform::transformBatch(const RigidTransform* pre, const RigidTransform* post, const int* sensors,
+		const glm::dquat* rotations, const glm::dvec3* translations, double translationScale,
+		size_t count, glm::dmat4* results)
+{
+	size_t i = 0;
+
+#ifdef MINVR_USE_SSE2
+	Double2 scale(translationScale);
+	for (; i + 1 < count; i += 2) {
+		const RigidTransform &preA = pre[sensors[i]];
+		const RigidTransform &preB = pre[sensors[i+1]];
+		const RigidTransform &postA = post[sensors[i]];
+		const RigidTransform &postB = post[sensors[i+1]];
+
+		Double2 m[3][3];
+		LaneVec3<Double2> t;
+		composeLanes(loadQuat(preA.rotation, preB.rotation), loadVec3(preA.translation, preB.translation),
+			loadQuat(postA.rotation, postB.rotation), loadVec3(postA.translation, postB.translation),
+			loadQuat(rotations[i], rotations[i+1]), loadVec3(translations[i], translations[i+1]),
+			scale, m, t);
+
+		for (int c = 0; c < 3; c++) {
+			storeColumn(results[i], results[i+1], c, m[c][0], m[c][1], m[c][2], 0.0);
+		}
+		storeColumn(results[i], results[i+1], 3, t.x, t.y, t.z, 1.0);
+	}
+#endif
+
+	for (; i < count; i++) {
+		transformOne(pre[sensors[i]], post[sensors[i]], rotations[i], translations[i], translationScale, results[i]);
+	}
+}
+
+} // end namespace
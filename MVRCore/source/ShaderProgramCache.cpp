@@ -0,0 +1,272 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/ShaderProgramCache.H"
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace MinVR {
+
+static ShaderProgramCache* common = nullptr;
+static boost::mutex commonMutex;
+
+// Identifies the cache file layout. Bump the last character if it changes.
+static const char cacheFileMagic[8] = { 'M', 'V', 'R', 'P', 'B', 'I', 'N', '1' };
+
+// 64 bit FNV-1a, good enough to tell shader sources apart and stable across platforms
+static boost::uint64_t hashString(const std::string &str, boost::uint64_t hash = 14695981039346656037ULL)
+{
+	for (size_t i = 0; i < str.size(); i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static std::string hashToString(boost::uint64_t hash)
+{
+	char buf[17];
+	sprintf(buf, "%08x%08x", (unsigned int)(hash >> 32), (unsigned int)(hash & 0xffffffff));
+	return std::string(buf);
+}
+
+ShaderProgramCache& ShaderProgramCache::instance()
+{
+	init();
+	return *common;
+}
+
+void ShaderProgramCache::init()
+{
+	// Render threads hit this concurrently during startup
+	boost::mutex::scoped_lock lock(commonMutex);
+	if (common == nullptr)
+	{
+		common = new ShaderProgramCache();
+	}
+}
+
+void ShaderProgramCache::cleanup()
+{
+	boost::mutex::scoped_lock lock(commonMutex);
+	if (common != nullptr) {
+		delete common;
+		common = nullptr;
+	}
+}
+
+ShaderProgramCache::ShaderProgramCache()
+{
+	boost::system::error_code ec;
+	boost::filesystem::path tempDir = boost::filesystem::temp_directory_path(ec);
+	if (!ec) {
+		_cacheDirectory = (tempDir / boost::filesystem::path("MinVR-ShaderCache")).string();
+	}
+}
+
+std::string ShaderProgramCache::makeKey(const std::string &driver, const std::string &programName, const std::string &vertexSource, const std::string &fragmentSource)
+{
+	boost::uint64_t sourceHash = hashString(vertexSource);
+	sourceHash = hashString(std::string(1, '\0'), sourceHash);
+	sourceHash = hashString(fragmentSource, sourceHash);
+	return driver + "|" + programName + "|" + hashToString(sourceHash);
+}
+
+bool ShaderProgramCache::findBinary(const std::string &key, unsigned int &binaryFormat, std::vector<char> &binary)
+{
+	return instance()._findBinary(key, binaryFormat, binary);
+}
+
+void ShaderProgramCache::storeBinary(const std::string &key, unsigned int binaryFormat, const std::vector<char> &binary)
+{
+	instance()._storeBinary(key, binaryFormat, binary);
+}
+
+void ShaderProgramCache::abandonBinary(const std::string &key)
+{
+	instance()._abandonBinary(key);
+}
+
+void ShaderProgramCache::invalidateBinary(const std::string &key)
+{
+	instance()._invalidateBinary(key);
+}
+
+void ShaderProgramCache::setCacheDirectory(const std::string &directory)
+{
+	ShaderProgramCache& cache = instance();
+	boost::mutex::scoped_lock lock(cache._mutex);
+	cache._cacheDirectory = directory;
+}
+
+bool ShaderProgramCache::_findBinary(const std::string &key, unsigned int &binaryFormat, std::vector<char> &binary)
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+
+	// Wait for another context that is already compiling this program
+	while (_building.find(key) != _building.end()) {
+		_builtCond.wait(lock);
+	}
+
+	std::map<std::string, ProgramBinary>::iterator it = _binaries.find(key);
+	if (it == _binaries.end()) {
+		ProgramBinary program;
+		if (!readCacheFile(key, program)) {
+			_building.insert(key);
+			return false;
+		}
+		it = _binaries.insert(std::make_pair(key, program)).first;
+	}
+
+	binaryFormat = it->second.format;
+	binary = it->second.data;
+	return true;
+}
+
+void ShaderProgramCache::_storeBinary(const std::string &key, unsigned int binaryFormat, const std::vector<char> &binary)
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	ProgramBinary& program = _binaries[key];
+	program.format = binaryFormat;
+	program.data = binary;
+	writeCacheFile(key, program);
+	_building.erase(key);
+	_builtCond.notify_all();
+}
+
+void ShaderProgramCache::_abandonBinary(const std::string &key)
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	_building.erase(key);
+	_builtCond.notify_all();
+}
+
+void ShaderProgramCache::_invalidateBinary(const std::string &key)
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	_binaries.erase(key);
+	if (_cacheDirectory != "") {
+		boost::system::error_code ec;
+		boost::filesystem::remove(getCacheFileName(key), ec);
+	}
+}
+
+std::string ShaderProgramCache::getCacheFileName(const std::string &key)
+{
+	return (boost::filesystem::path(_cacheDirectory) / boost::filesystem::path(hashToString(hashString(key)) + ".bin")).string();
+}
+
+bool ShaderProgramCache::readCacheFile(const std::string &key, ProgramBinary &program)
+{
+	if (_cacheDirectory == "") {
+		return false;
+	}
+
+	std::string fileName = getCacheFileName(key);
+	if (!boost::filesystem::exists(fileName)) {
+		return false;
+	}
+
+	boost::filesystem::ifstream fIn(fileName, std::ios::in | std::ios::binary);
+	char magic[8];
+	boost::uint32_t format = 0;
+	boost::uint32_t keySize = 0;
+	boost::uint32_t dataSize = 0;
+	fIn.read(magic, sizeof(magic));
+	fIn.read((char*)&format, sizeof(format));
+	fIn.read((char*)&keySize, sizeof(keySize));
+	fIn.read((char*)&dataSize, sizeof(dataSize));
+	if (!fIn || memcmp(magic, cacheFileMagic, sizeof(magic)) != 0 || keySize != key.size() || dataSize == 0) {
+		return false;
+	}
+
+	// The full key is stored to guard against collisions of the file name hash
+	std::string storedKey(keySize, '\0');
+	fIn.read(&storedKey[0], keySize);
+	if (!fIn || storedKey != key) {
+		return false;
+	}
+
+	program.format = format;
+	program.data.resize(dataSize);
+	fIn.read(&program.data[0], dataSize);
+	return (bool)fIn;
+}
+
+void ShaderProgramCache::writeCacheFile(const std::string &key, const ProgramBinary &program)
+{
+	if (_cacheDirectory == "" || program.data.empty()) {
+		return;
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(_cacheDirectory, ec);
+	if (ec) {
+		std::cout << "Unable to create shader cache directory " << _cacheDirectory << ": " << ec.message() << std::endl;
+		return;
+	}
+
+	// Write to a temporary file and rename it so that other processes sharing the
+	// cache directory, e.g. cluster nodes, never see a partially written binary.
+	std::string fileName = getCacheFileName(key);
+	std::string tempName = fileName + "." + boost::filesystem::unique_path().string();
+	{
+		boost::filesystem::ofstream fOut(tempName, std::ios::out | std::ios::binary | std::ios::trunc);
+		boost::uint32_t format = program.format;
+		boost::uint32_t keySize = (boost::uint32_t)key.size();
+		boost::uint32_t dataSize = (boost::uint32_t)program.data.size();
+		fOut.write(cacheFileMagic, sizeof(cacheFileMagic));
+		fOut.write((const char*)&format, sizeof(format));
+		fOut.write((const char*)&keySize, sizeof(keySize));
+		fOut.write((const char*)&dataSize, sizeof(dataSize));
+		fOut.write(key.c_str(), keySize);
+		fOut.write(&program.data[0], dataSize);
+		if (!fOut) {
+			std::cout << "Unable to write shader cache file " << tempName << std::endl;
+			fOut.close();
+			boost::filesystem::remove(tempName, ec);
+			return;
+		}
+	}
+
+	boost::filesystem::rename(tempName, fileName, ec);
+	if (ec) {
+		boost::filesystem::remove(tempName, ec);
+	}
+}
+
+} // end namespace
@@ -0,0 +1,232 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/SharedResourceCache.H"
+#include "MVRCore/Logger.H"
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+SharedResourceCache::SharedResourceCache(int shareGroup) : _shareGroup(shareGroup), _numContexts(0), _numSharedHits(0)
+{
+}
+
+SharedResourceCache::~SharedResourceCache()
+{
+	// Objects still in the cache went away with their contexts
+}
+
+bool SharedResourceCache::syncSupported()
+{
+#ifdef _WIN32
+	return pglFenceSync && pglWaitSync && pglDeleteSync;
+#else
+	return true;
+#endif
+}
+
+GLuint SharedResourceCache::acquire(const std::string &id)
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	while (true) {
+		std::map<std::string, Entry>::iterator it = _entries.find(id);
+		if (it == _entries.end()) {
+			Entry entry;
+			entry.state = ENTRY_CREATING;
+			entry.type = RESOURCE_TEXTURE;
+			entry.name = 0;
+			entry.fence = 0;
+			entry.creator = boost::this_thread::get_id();
+			_entries[id] = entry;
+			return 0;
+		}
+
+		if (it->second.state == ENTRY_READY) {
+			GLuint name = it->second.name;
+			GLsync fence = it->second.fence;
+			if (it->second.creator != boost::this_thread::get_id()) {
+				_numSharedHits++;
+			}
+			lock.unlock();
+
+			// Make this context's commands wait for the upload, without blocking the thread
+			if (fence != 0) {
+				glWaitSync(fence, 0, GL_TIMEOUT_IGNORED);
+			}
+			return name;
+		}
+
+		BOOST_ASSERT_MSG(it->second.creator != boost::this_thread::get_id(), "SharedResourceCache: acquire() called again before publishing the object");
+		_published.wait(lock);
+	}
+}
+
+GLuint SharedResourceCache::find(const std::string &id)
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	std::map<std::string, Entry>::iterator it = _entries.find(id);
+	if (it == _entries.end() || it->second.state != ENTRY_READY) {
+		return 0;
+	}
+	if (it->second.fence != 0) {
+		glWaitSync(it->second.fence, 0, GL_TIMEOUT_IGNORED);
+	}
+	return it->second.name;
+}
+
+void SharedResourceCache::publish(const std::string &id, ResourceType type, GLuint name)
+{
+	// Other contexts only see the upload once it reaches the GPU, so flush after the fence
+	GLsync fence = 0;
+	if (_shareGroup >= 0) {
+		if (syncSupported()) {
+			fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			glFlush();
+		}
+		else {
+			glFinish();
+		}
+	}
+
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	std::map<std::string, Entry>::iterator it = _entries.find(id);
+	BOOST_ASSERT_MSG(it == _entries.end() || it->second.state == ENTRY_CREATING, "SharedResourceCache: an object was already published under this id");
+	Entry &entry = _entries[id];
+	entry.state = ENTRY_READY;
+	entry.type = type;
+	entry.name = name;
+	entry.fence = fence;
+	entry.creator = boost::this_thread::get_id();
+	_published.notify_all();
+}
+
+void SharedResourceCache::abandon(const std::string &id)
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	std::map<std::string, Entry>::iterator it = _entries.find(id);
+	if (it != _entries.end() && it->second.state == ENTRY_CREATING && it->second.creator == boost::this_thread::get_id()) {
+		_entries.erase(it);
+		_published.notify_all();
+	}
+}
+
+void SharedResourceCache::addContext()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	_numContexts++;
+}
+
+void SharedResourceCache::removeContext()
+{
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	BOOST_ASSERT_MSG(_numContexts > 0, "SharedResourceCache: removeContext() called more often than addContext()");
+	if (--_numContexts > 0) {
+		return;
+	}
+	lock.unlock();
+
+	if (_shareGroup >= 0) {
+		logStats();
+	}
+
+	lock.lock();
+	for (std::map<std::string, Entry>::iterator it = _entries.begin(); it != _entries.end(); ++it) {
+		if (it->second.state == ENTRY_READY) {
+			deleteObject(it->second);
+		}
+	}
+	_entries.clear();
+}
+
+void SharedResourceCache::deleteObject(const Entry &entry)
+{
+	if (entry.fence != 0) {
+		glDeleteSync(entry.fence);
+	}
+	if (entry.name == 0) {
+		return;
+	}
+
+	switch (entry.type) {
+	case RESOURCE_TEXTURE:
+		glDeleteTextures(1, &entry.name);
+		break;
+	case RESOURCE_BUFFER:
+		glDeleteBuffers(1, &entry.name);
+		break;
+	case RESOURCE_RENDERBUFFER:
+		glDeleteRenderbuffers(1, &entry.name);
+		break;
+	case RESOURCE_SHADER:
+		glDeleteShader(entry.name);
+		break;
+	case RESOURCE_PROGRAM:
+		glDeleteProgram(entry.name);
+		break;
+	}
+}
+
+int SharedResourceCache::getShareGroup()
+{
+	return _shareGroup;
+}
+
+int SharedResourceCache::getNumContexts()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _numContexts;
+}
+
+int SharedResourceCache::getNumObjects()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _entries.size();
+}
+
+int SharedResourceCache::getNumSharedHits()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	return _numSharedHits;
+}
+
+void SharedResourceCache::logStats()
+{
+	boost::lock_guard<boost::mutex> lock(_mutex);
+	MINVR_LOG_INFO(Logger::core()) << "ShareGroup " << _shareGroup << ": " << _entries.size() << " objects shared, "
+		<< _numSharedHits << " uploads saved.";
+}
+
+} // end namespace
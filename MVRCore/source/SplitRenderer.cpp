@@ -0,0 +1,513 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/SplitRenderer.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/StringUtils.H"
+#include "MVRCore/TimeService.H"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+#define BOOST_ASSERT_MSG_OSTREAM std::cout
+#include <boost/assert.hpp>
+
+namespace MinVR {
+
+// Smallest tile height in rows, so a cheap tile never vanishes. Boundaries also move only by at least this much, so timing noise does not shift them every frame.
+#define MIN_TILE_ROWS 8
+
+static double secondsSince(const boost::posix_time::ptime &start)
+{
+	return (TimeService::localTime() - start).total_microseconds() / 1000000.0;
+}
+
+std::vector<SplitRenderer::Pass> SplitRenderer::getPasses(WindowRef window)
+{
+	std::vector<Pass> passes;
+	WindowSettingsRef settings = window->getSettings();
+	bool stereo = settings->stereo && settings->stereoType != WindowSettings::STEREOTYPE_MONO;
+	for (int eye = (stereo ? 1 : 0); eye <= (stereo ? 2 : 0); eye++) {
+		for (int v = 0; v < (int)window->getNumViewports(); v++) {
+			Rect2D rect = window->getViewport(v);
+			if (!stereo) {
+				Pass pass = {0, v, GL_BACK, rect};
+				passes.push_back(pass);
+			}
+			else if (settings->stereoType == WindowSettings::STEREOTYPE_QUADBUFFERED) {
+				Pass pass = {eye, v, (GLenum)(eye == 1 ? GL_BACK_LEFT : GL_BACK_RIGHT), rect};
+				passes.push_back(pass);
+			}
+			else {
+				int width = rect.width()/2;
+				Pass pass = {eye, v, GL_BACK, Rect2D(width, rect.height(), rect.x0() + (eye == 1 ? 0 : width), rect.y0())};
+				passes.push_back(pass);
+			}
+		}
+	}
+	return passes;
+}
+
+SplitRenderer::SplitMode SplitRenderer::parseMode(const std::string &name)
+{
+	if (name == "Viewports") {
+		return SPLIT_VIEWPORTS;
+	}
+	else if (name == "Eyes") {
+		return SPLIT_EYES;
+	}
+	else if (name != "Tiles") {
+		MINVR_LOG_WARNING(Logger::core()) << "Unknown SplitMode " << name << ", splitting into tiles.";
+	}
+	return SPLIT_TILES;
+}
+
+bool SplitRenderer::isSupported(WindowRef window)
+{
+	WindowSettingsRef settings = window->getSettings();
+	if (settings->stereo && (settings->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
+		settings->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
+		settings->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS)) {
+		return false;
+	}
+	for (int v = 0; v < (int)window->getNumViewports(); v++) {
+		if (!window->getCamera(v)->clone()) {
+			return false;
+		}
+	}
+	return window->getNumViewports() > 0;
+}
+
+SplitRenderer::SplitRenderer(WindowRef window, const std::vector<WindowRef> &workerWindows, SplitMode mode) :
+	_window(window), _mode(mode), _width(window->getWidth()), _height(window->getHeight()), _numInitialized(0), _stopping(false), _finished(false), _numRebalances(0)
+{
+	_passes = getPasses(window);
+	WindowSettingsRef settings = window->getSettings();
+	bool stereo = settings->stereo && settings->stereoType != WindowSettings::STEREOTYPE_MONO;
+	for (size_t i = 0; i < _passes.size(); i++) {
+		if (std::find(_drawBuffers.begin(), _drawBuffers.end(), _passes[i].drawBuffer) == _drawBuffers.end()) {
+			_drawBuffers.push_back(_passes[i].drawBuffer);
+		}
+	}
+
+	if (_mode == SPLIT_EYES && !stereo) {
+		MINVR_LOG_WARNING(Logger::core()) << settings->windowTitle << " is not stereo, splitting it into tiles instead of eyes.";
+		_mode = SPLIT_TILES;
+	}
+
+	for (size_t i = 0; i < workerWindows.size(); i++) {
+		Worker* worker = new Worker();
+		worker->window = workerWindows[i];
+		worker->threadId = -1;
+		worker->tileY0 = 0;
+		worker->tileY1 = 0;
+		worker->fbo = 0;
+		worker->colorTextures[0] = 0;
+		worker->colorTextures[1] = 0;
+		worker->depthStencil = 0;
+		worker->readFBO = 0;
+		worker->frameRequested = false;
+		worker->frameDone = false;
+		worker->lastSeconds = 0.0;
+		worker->totalSeconds = 0.0;
+		worker->numFrames = 0;
+		_workers.push_back(worker);
+	}
+	assignPasses();
+}
+
+SplitRenderer::~SplitRenderer()
+{
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_stopping = true;
+		_workerCond.notify_all();
+	}
+	for (size_t i = 0; i < _workers.size(); i++) {
+		if (_workers[i]->thread) {
+			_workers[i]->thread->join();
+		}
+		delete _workers[i];
+	}
+}
+
+void SplitRenderer::assignPasses()
+{
+	int numWorkers = (int)_workers.size();
+	int numUsed = numWorkers;
+	for (int w = 0; w < numWorkers; w++) {
+		_workers[w]->passes.clear();
+	}
+
+	if (_mode == SPLIT_VIEWPORTS) {
+		for (size_t i = 0; i < _passes.size(); i++) {
+			_workers[_passes[i].viewport % numWorkers]->passes.push_back(_passes[i]);
+		}
+		numUsed = std::min(numWorkers, (int)_window->getNumViewports());
+	}
+	else if (_mode == SPLIT_EYES) {
+		for (size_t i = 0; i < _passes.size(); i++) {
+			_workers[(_passes[i].eye - 1) % numWorkers]->passes.push_back(_passes[i]);
+		}
+		numUsed = std::min(numWorkers, 2);
+	}
+	else {
+		// Every worker draws everything, clipped to an equal share of the rows to start with
+		for (int w = 0; w < numWorkers; w++) {
+			_workers[w]->passes = _passes;
+			_workers[w]->tileY0 = _height * w / numWorkers;
+			_workers[w]->tileY1 = _height * (w+1) / numWorkers;
+		}
+	}
+
+	if (numUsed < numWorkers) {
+		MINVR_LOG_WARNING(Logger::core()) << _window->getSettings()->windowTitle << ": only " << numUsed << " of " << numWorkers << " split workers have a part of the frame to draw.";
+	}
+}
+
+int SplitRenderer::assignThreadIds(int firstThreadId)
+{
+	for (size_t i = 0; i < _workers.size(); i++) {
+		_workers[i]->threadId = firstThreadId + (int)i;
+	}
+	return (int)_workers.size();
+}
+
+int SplitRenderer::getAttachmentIndex(GLenum drawBuffer)
+{
+	return drawBuffer == GL_BACK_RIGHT ? 1 : 0;
+}
+
+void SplitRenderer::initialize(AbstractMVRAppRef app)
+{
+	_app = app;
+	for (size_t i = 0; i < _workers.size(); i++) {
+		_workers[i]->thread.reset(new boost::thread(&SplitRenderer::runWorker, this, _workers[i]));
+	}
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	while (_numInitialized < (int)_workers.size()) {
+		_doneCond.wait(lock);
+	}
+	lock.unlock();
+
+	// Framebuffer objects are not shared, so the window reads the workers' textures through its own
+	for (size_t i = 0; i < _workers.size(); i++) {
+		glGenFramebuffers(1, &_workers[i]->readFBO);
+	}
+}
+
+void SplitRenderer::createFramebuffer(Worker* worker)
+{
+	int numAttachments = 1;
+	for (size_t i = 0; i < _drawBuffers.size(); i++) {
+		numAttachments = std::max(numAttachments, getAttachmentIndex(_drawBuffers[i]) + 1);
+	}
+
+	glGenFramebuffers(1, &worker->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, worker->fbo);
+	for (int a = 0; a < numAttachments; a++) {
+		glGenTextures(1, &worker->colorTextures[a]);
+		glBindTexture(GL_TEXTURE_2D, worker->colorTextures[a]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, _width, _height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + a, GL_TEXTURE_2D, worker->colorTextures[a], 0);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &worker->depthStencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, worker->depthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, _width, _height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, worker->depthStencil);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, worker->depthStencil);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	BOOST_ASSERT_MSG(status == GL_FRAMEBUFFER_COMPLETE, "SplitRenderer: the worker's framebuffer is incomplete.");
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void SplitRenderer::runWorker(Worker* worker)
+{
+	worker->window->makeContextCurrent();
+	GLExtensions::init();
+	createFramebuffer(worker);
+	_app->initializeContextSpecificVars(worker->threadId, _window);
+	// The window's context uses the textures as soon as initialize returns
+	glFinish();
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	_numInitialized++;
+	_doneCond.notify_all();
+
+	while (true) {
+		while (!worker->frameRequested && !_stopping) {
+			_workerCond.wait(lock);
+		}
+		if (_stopping) {
+			break;
+		}
+		worker->frameRequested = false;
+		lock.unlock();
+
+		boost::posix_time::ptime start = TimeService::localTime();
+		drawPasses(worker);
+
+		// Wait for the GPU here rather than in the window's thread, which also measures the worker's load
+		GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+		}
+		glDeleteSync(fence);
+		worker->lastSeconds = secondsSince(start);
+
+		lock.lock();
+		worker->frameDone = true;
+		_doneCond.notify_all();
+	}
+	lock.unlock();
+
+	glDeleteFramebuffers(1, &worker->fbo);
+	glDeleteTextures(2, worker->colorTextures);
+	glDeleteRenderbuffers(1, &worker->depthStencil);
+	worker->window->releaseContext();
+}
+
+void SplitRenderer::drawPasses(Worker* worker)
+{
+	bool tiles = (_mode == SPLIT_TILES);
+	int tileHeight = worker->tileY1 - worker->tileY0;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, worker->fbo);
+	if (tiles) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+
+	for (size_t i = 0; i < worker->passes.size(); i++) {
+		Pass &pass = worker->passes[i];
+
+		// The eyes of quad-buffered stereo share the depth buffer, so clear before the first pass of each
+		if (i == 0 || pass.drawBuffer != worker->passes[i-1].drawBuffer) {
+			if (tiles) {
+				glScissor(0, worker->tileY0, _width, tileHeight);
+			}
+			glDrawBuffer(GL_COLOR_ATTACHMENT0 + getAttachmentIndex(pass.drawBuffer));
+			glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		if (tiles) {
+			int y0 = std::max(pass.rect.y0(), worker->tileY0);
+			int y1 = std::min(pass.rect.y0() + pass.rect.height(), worker->tileY1);
+			if (y1 <= y0) {
+				continue;
+			}
+			glScissor(pass.rect.x0(), y0, pass.rect.width(), y1 - y0);
+		}
+
+		glDrawBuffer(GL_COLOR_ATTACHMENT0 + getAttachmentIndex(pass.drawBuffer));
+		glViewport(pass.rect.x0(), pass.rect.y0(), pass.rect.width(), pass.rect.height());
+		AbstractCameraRef camera = worker->cameras[pass.viewport];
+		if (pass.eye == 1) {
+			camera->applyProjectionAndCameraMatricesForLeftEye();
+		}
+		else if (pass.eye == 2) {
+			camera->applyProjectionAndCameraMatricesForRightEye();
+		}
+		else {
+			camera->applyProjectionAndCameraMatrices();
+		}
+		_app->drawGraphics(worker->threadId, camera, _window);
+	}
+
+	if (tiles) {
+		glDisable(GL_SCISSOR_TEST);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void SplitRenderer::renderFrame()
+{
+	// Head tracking updated the window's cameras since the last frame
+	for (size_t w = 0; w < _workers.size(); w++) {
+		_workers[w]->cameras.clear();
+		for (int v = 0; v < (int)_window->getNumViewports(); v++) {
+			_workers[w]->cameras.push_back(_window->getCamera(v)->clone());
+		}
+	}
+
+	boost::unique_lock<boost::mutex> lock(_mutex);
+	for (size_t w = 0; w < _workers.size(); w++) {
+		_workers[w]->frameDone = _workers[w]->passes.empty();
+		_workers[w]->frameRequested = !_workers[w]->passes.empty();
+	}
+	_workerCond.notify_all();
+
+	// Clear what no worker covers, e.g. outside the viewports
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	for (size_t i = 0; i < _drawBuffers.size(); i++) {
+		glDrawBuffer(_drawBuffers[i]);
+		glClear(GL_STENCIL_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	for (size_t w = 0; w < _workers.size(); w++) {
+		while (!_workers[w]->frameDone) {
+			_doneCond.wait(lock);
+		}
+	}
+	lock.unlock();
+
+	for (size_t w = 0; w < _workers.size(); w++) {
+		Worker* worker = _workers[w];
+		if (worker->passes.empty()) {
+			continue;
+		}
+		worker->totalSeconds += worker->lastSeconds;
+		worker->numFrames++;
+
+		// Attaching the textures again makes the worker's changes visible in this context
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, worker->readFBO);
+		for (int a = 0; a < 2; a++) {
+			if (worker->colorTextures[a] != 0) {
+				glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + a, GL_TEXTURE_2D, worker->colorTextures[a], 0);
+			}
+		}
+
+		for (size_t i = 0; i < worker->passes.size(); i++) {
+			Pass &pass = worker->passes[i];
+			int y0 = pass.rect.y0();
+			int y1 = pass.rect.y0() + pass.rect.height();
+			if (_mode == SPLIT_TILES) {
+				y0 = std::max(y0, worker->tileY0);
+				y1 = std::min(y1, worker->tileY1);
+				if (y1 <= y0) {
+					continue;
+				}
+			}
+			int x0 = pass.rect.x0();
+			int x1 = pass.rect.x0() + pass.rect.width();
+			glReadBuffer(GL_COLOR_ATTACHMENT0 + getAttachmentIndex(pass.drawBuffer));
+			glDrawBuffer(pass.drawBuffer);
+			glBlitFramebuffer(x0, y0, x1, y1, x0, y0, x1, y1, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(_drawBuffers[0]);
+	glDrawBuffer(_drawBuffers[0]);
+
+	if (_mode == SPLIT_TILES) {
+		balanceTiles();
+	}
+}
+
+void SplitRenderer::balanceTiles()
+{
+	int numWorkers = (int)_workers.size();
+	double totalSeconds = 0.0;
+	for (int w = 0; w < numWorkers; w++) {
+		totalSeconds += _workers[w]->lastSeconds;
+	}
+	if (numWorkers < 2 || totalSeconds <= 0.0) {
+		return;
+	}
+
+	// Treat each tile's time as spread evenly over its rows, and place the boundaries so every tile gets the same time
+	std::vector<int> boundaries(numWorkers + 1, 0);
+	boundaries[numWorkers] = _height;
+	int tile = 0;
+	double timeBefore = 0.0;
+	for (int b = 1; b < numWorkers; b++) {
+		double goal = totalSeconds * b / numWorkers;
+		while (tile < numWorkers - 1 && timeBefore + _workers[tile]->lastSeconds < goal) {
+			timeBefore += _workers[tile]->lastSeconds;
+			tile++;
+		}
+		Worker* worker = _workers[tile];
+		double fraction = worker->lastSeconds > 0.0 ? (goal - timeBefore) / worker->lastSeconds : 0.5;
+		double target = worker->tileY0 + std::min(std::max(fraction, 0.0), 1.0) * (worker->tileY1 - worker->tileY0);
+
+		// Move half way, since the times are from a single frame
+		int current = _workers[b]->tileY0;
+		boundaries[b] = current + (int)((target - current) / 2.0);
+	}
+
+	bool moved = false;
+	for (int b = 1; b < numWorkers; b++) {
+		boundaries[b] = std::max(boundaries[b], boundaries[b-1] + MIN_TILE_ROWS);
+		boundaries[b] = std::min(boundaries[b], _height - (numWorkers - b) * MIN_TILE_ROWS);
+		moved = moved || (std::abs(boundaries[b] - _workers[b]->tileY0) >= MIN_TILE_ROWS);
+	}
+	if (!moved) {
+		return;
+	}
+	for (int w = 0; w < numWorkers; w++) {
+		_workers[w]->tileY0 = boundaries[w];
+		_workers[w]->tileY1 = boundaries[w+1];
+	}
+	_numRebalances++;
+}
+
+void SplitRenderer::finish(const std::string &windowName)
+{
+	if (_finished) {
+		return;
+	}
+	_finished = true;
+
+	{
+		boost::mutex::scoped_lock lock(_mutex);
+		_stopping = true;
+		_workerCond.notify_all();
+	}
+	for (size_t w = 0; w < _workers.size(); w++) {
+		if (_workers[w]->thread) {
+			_workers[w]->thread->join();
+			_workers[w]->thread.reset();
+		}
+		if (_workers[w]->readFBO != 0) {
+			glDeleteFramebuffers(1, &_workers[w]->readFBO);
+		}
+	}
+
+	static const char* modeNames[] = {"viewports", "eyes", "tiles"};
+	MINVR_LOG_INFO(Logger::core()) << windowName << ": split into " << modeNames[_mode] << " over " << _workers.size() << " workers"
+		<< (_mode == SPLIT_TILES ? ", tiles moved " + intToString((int)_numRebalances) + " times" : std::string("")) << ".";
+	for (size_t w = 0; w < _workers.size(); w++) {
+		Worker* worker = _workers[w];
+		double average = worker->numFrames > 0 ? 1000.0 * worker->totalSeconds / worker->numFrames : 0.0;
+		MINVR_LOG_INFO(Logger::core()) << windowName << ": split worker " << w+1 << " averaged " << average << " ms per frame"
+			<< (_mode == SPLIT_TILES ? ", last tile rows " + intToString(worker->tileY0) + "-" + intToString(worker->tileY1) : std::string("")) << ".";
+	}
+}
+
+} // end namespace
@@ -0,0 +1,116 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/StartupProfiler.H"
+#include "MVRCore/Logger.H"
+#include "MVRCore/TimeService.H"
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+namespace MinVR {
+
+StartupProfiler::StartupProfiler()
+{
+	_origin = TimeService::localTime();
+}
+
+void StartupProfiler::beginPhase(const std::string &name)
+{
+	Phase phase;
+	phase.name = name;
+	phase.start = TimeService::localTime();
+	phase.finished = false;
+
+	boost::mutex::scoped_lock lock(_mutex);
+	_phases.push_back(phase);
+}
+
+void StartupProfiler::endPhase(const std::string &name)
+{
+	boost::posix_time::ptime now = TimeService::localTime();
+
+	boost::mutex::scoped_lock lock(_mutex);
+	for (int i = (int)_phases.size()-1; i >= 0; i--) {
+		if (_phases[i].name == name && !_phases[i].finished) {
+			_phases[i].end = now;
+			_phases[i].finished = true;
+			return;
+		}
+	}
+}
+
+static bool phaseStartsBefore(const std::pair<boost::posix_time::ptime, std::string> &a, const std::pair<boost::posix_time::ptime, std::string> &b)
+{
+	return a.first < b.first;
+}
+
+void StartupProfiler::logReport()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+
+	std::vector<std::pair<boost::posix_time::ptime, std::string> > rows;
+	boost::posix_time::ptime last = _origin;
+	for (size_t i = 0; i < _phases.size(); i++) {
+		std::stringstream row;
+		row << std::fixed << std::setprecision(1);
+		row << std::setw(10) << (_phases[i].start - _origin).total_microseconds() / 1000.0;
+		if (_phases[i].finished) {
+			row << std::setw(12) << (_phases[i].end - _phases[i].start).total_microseconds() / 1000.0;
+			if (_phases[i].end > last) {
+				last = _phases[i].end;
+			}
+		}
+		else {
+			row << std::setw(12) << "-";
+		}
+		row << "  " << _phases[i].name;
+		rows.push_back(std::make_pair(_phases[i].start, row.str()));
+	}
+	std::stable_sort(rows.begin(), rows.end(), phaseStartsBefore);
+
+	// One record per row, so each line of the table gets the log's prefix
+	std::stringstream header;
+	header << std::setw(10) << "start" << std::setw(12) << "duration" << "  phase";
+	MINVR_LOG_INFO(Logger::core()) << "Startup report (ms)";
+	MINVR_LOG_INFO(Logger::core()) << header.str();
+	for (size_t i = 0; i < rows.size(); i++) {
+		MINVR_LOG_INFO(Logger::core()) << rows[i].second;
+	}
+	std::stringstream total;
+	total << std::fixed << std::setprecision(1) << (last - _origin).total_microseconds() / 1000.0;
+	MINVR_LOG_INFO(Logger::core()) << "Startup total: " << total.str() << " ms";
+}
+
+} // end namespace
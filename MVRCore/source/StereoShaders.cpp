@@ -0,0 +1,117 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/StereoShaders.H"
+
+namespace MinVR {
+
+// The texture coordinates are derived from the quad's clip space position
+// since the composite quad only supplies a vertex array.
+static const char* stereoVertexShader =
+	"void main(void)\n"
+	"{\n"
+	"  gl_Position = vec4(gl_Vertex.xy,0.5,1.0);\n"
+	"  gl_TexCoord[0] = vec4(gl_Vertex.xy*0.5+0.5,0.0,1.0);\n"
+	"}\n";
+
+// Version 130 is needed for the xor operation
+static const char* stereoCheckerboardFragmentShader =
+	"#version 130\n"
+	"#extension GL_EXT_gpu_shader4 : enable\n"
+	"uniform sampler2D rightEyeTexture;\n"
+	"uniform sampler2D leftEyeTexture;\n"
+	"uniform vec2 screenSize;\n"
+	"void main(void){\n"
+	"	ivec2 test = ivec2(step(0.5 , floor(mod(gl_TexCoord[0].xy * screenSize.xy, 2.0))));\n"
+	"	gl_FragColor = mix(texture2D(leftEyeTexture,  gl_TexCoord[0].xy), texture2D(rightEyeTexture, gl_TexCoord[0].xy), float(test.x^test.y));\n"
+	"}\n";
+
+static const char* stereoInterlacedColumnsFragmentShader =
+	"uniform sampler2D rightEyeTexture;\n"
+	"uniform sampler2D leftEyeTexture;\n"
+	"uniform vec2 screenSize;\n"
+	"void main(void){\n"
+	"	float test = step(0.5 , floor(mod(gl_TexCoord[0].x * screenSize.x, 2.0)));\n"
+	"	gl_FragColor = mix(texture2D(leftEyeTexture,  gl_TexCoord[0].xy), texture2D(rightEyeTexture, gl_TexCoord[0].xy), test);\n"
+	"}\n";
+
+static const char* stereoInterlacedRowsFragmentShader =
+	"uniform sampler2D rightEyeTexture;\n"
+	"uniform sampler2D leftEyeTexture;\n"
+	"uniform vec2 screenSize;\n"
+	"void main(void){\n"
+	"	float test = step(0.5 , floor(mod(gl_TexCoord[0].y * screenSize.y, 2.0)));\n"
+	"	gl_FragColor = mix(texture2D(leftEyeTexture,  gl_TexCoord[0].xy), texture2D(rightEyeTexture, gl_TexCoord[0].xy), test);\n"
+	"}\n";
+
+const char* StereoShaders::getVertexShader()
+{
+	return stereoVertexShader;
+}
+
+const char* StereoShaders::getFragmentShader(WindowSettings::StereoType stereoType)
+{
+	switch (stereoType) {
+		case WindowSettings::STEREOTYPE_CHECKERBOARD:
+			return stereoCheckerboardFragmentShader;
+		case WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS:
+			return stereoInterlacedColumnsFragmentShader;
+		case WindowSettings::STEREOTYPE_INTERLACEDROWS:
+			return stereoInterlacedRowsFragmentShader;
+		default:
+			return NULL;
+	}
+}
+
+std::string StereoShaders::getModeName(WindowSettings::StereoType stereoType)
+{
+	switch (stereoType) {
+		case WindowSettings::STEREOTYPE_MONO:
+			return "Mono";
+		case WindowSettings::STEREOTYPE_QUADBUFFERED:
+			return "QuadBuffered";
+		case WindowSettings::STEREOTYPE_SIDEBYSIDE:
+			return "SideBySide";
+		case WindowSettings::STEREOTYPE_CHECKERBOARD:
+			return "Checkerboard";
+		case WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS:
+			return "InterlacedColumns";
+		case WindowSettings::STEREOTYPE_INTERLACEDROWS:
+			return "InterlacedRows";
+		default:
+			return "Unknown";
+	}
+}
+
+} // end namespace
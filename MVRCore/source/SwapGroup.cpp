@@ -0,0 +1,90 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/SwapGroup.H"
+#include "MVRCore/Logger.H"
+
+namespace MinVR {
+
+SwapGroup::SwapGroup(int id, int numWindows, int numThreads, double targetRate, bool primary) :
+	_id(id), _numWindows(numWindows), _targetRate(targetRate), _primary(primary), _barrier(numThreads > 0 ? numThreads : 1),
+	_nextDue(-1.0), _firstRendered(0.0), _lastRendered(0.0), _numRendered(0), _numSkippedOverBudget(0), _numSkippedBusy(0)
+{
+}
+
+bool SwapGroup::isDue(double now, double framePeriod)
+{
+	if (_primary || _targetRate <= 0.0 || _nextDue < 0.0) {
+		return true;
+	}
+	// Render on the frame closest to the scheduled time rather than the first one after it
+	return now >= _nextDue - 0.5 * framePeriod;
+}
+
+bool SwapGroup::isOverBudget(double framePeriod)
+{
+	return _targetRate > 0.0 && framePeriod > 1.0 / _targetRate;
+}
+
+void SwapGroup::rendered(double now)
+{
+	if (_numRendered == 0) {
+		_firstRendered = now;
+	}
+	_lastRendered = now;
+	_numRendered++;
+
+	if (_targetRate > 0.0) {
+		double period = 1.0 / _targetRate;
+		_nextDue = (_nextDue < 0.0) ? now + period : _nextDue + period;
+		// Don't try to catch up on frames that were skipped
+		if (_nextDue < now) {
+			_nextDue = now + period;
+		}
+	}
+}
+
+void SwapGroup::logStats()
+{
+	double seconds = _lastRendered - _firstRendered;
+	double rate = (_numRendered > 1 && seconds > 0.0) ? (_numRendered - 1) / seconds : 0.0;
+	MINVR_LOG_INFO(Logger::core()) << "SwapGroup" << _id << (_primary ? " (primary)" : "") << ": " << _numWindows << " windows, "
+		<< _numRendered << " frames at " << rate << " frames/s, target " << _targetRate << ".";
+	if (!_primary) {
+		MINVR_LOG_INFO(Logger::core()) << "SwapGroup" << _id << ": skipped " << _numSkippedOverBudget << " frames over budget and "
+			<< _numSkippedBusy << " while still swapping.";
+	}
+}
+
+} // end namespace
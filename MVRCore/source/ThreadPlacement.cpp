@@ -0,0 +1,275 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/ThreadPlacement.H"
+#include "MVRCore/StringUtils.H"
+#include "MVRCore/Logger.H"
+#include <boost/algorithm/string/replace.hpp>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+// From numaif.h, so we don't need libnuma
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#endif
+
+namespace MinVR {
+
+ThreadPlacement::ThreadPlacement() : _numaNode(-1), _threadPriority(0)
+{
+}
+
+ThreadPlacement::ThreadPlacement(ConfigMapRef map, const std::string &prefix) : _numaNode(-1), _threadPriority(0)
+{
+	if (map->containsKey(prefix + "CPUAffinity")) {
+		_cpus = parseCPUList(map->get(prefix + "CPUAffinity", ""));
+	}
+	if (map->containsKey(prefix + "NUMANode")) {
+		_numaNode = map->get(prefix + "NUMANode", -1);
+	}
+	if (map->containsKey(prefix + "ThreadPriority")) {
+		_threadPriority = map->get(prefix + "ThreadPriority", 0);
+	}
+}
+
+ThreadPlacement::ThreadPlacement(const std::string &cpuAffinity, int numaNode, int threadPriority)
+{
+	_cpus = parseCPUList(cpuAffinity);
+	_numaNode = numaNode;
+	_threadPriority = threadPriority;
+}
+
+bool ThreadPlacement::isDefault() const
+{
+	return _cpus.empty() && (_numaNode < 0) && (_threadPriority <= 0);
+}
+
+std::vector<int> ThreadPlacement::parseCPUList(const std::string &list)
+{
+	std::vector<int> cpus;
+	std::vector<std::string> ranges = splitStringIntoArray(boost::replace_all_copy(list, ",", " "));
+	for (int i = 0; i < ranges.size(); i++) {
+		int first, last;
+		std::string::size_type dash = ranges[i].find('-');
+		if (dash == std::string::npos) {
+			first = last = stringToInt(ranges[i]);
+		}
+		else {
+			first = stringToInt(ranges[i].substr(0, dash));
+			last = stringToInt(ranges[i].substr(dash + 1));
+		}
+		for (int cpu = first; cpu <= last; cpu++) {
+			if (cpu >= 0) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+	std::sort(cpus.begin(), cpus.end());
+	cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+	return cpus;
+}
+
+std::vector<int> ThreadPlacement::getNUMANodeCPUs(int node)
+{
+	std::vector<int> cpus;
+	if (node < 0) {
+		return cpus;
+	}
+#ifdef _WIN32
+	ULONGLONG mask = 0;
+	if (GetNumaNodeProcessorMask((UCHAR)node, &mask)) {
+		for (int cpu = 0; cpu < 64; cpu++) {
+			if (mask & (1ULL << cpu)) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+#else
+	std::ifstream cpulist(("/sys/devices/system/node/node" + intToString(node) + "/cpulist").c_str());
+	std::string list;
+	if (std::getline(cpulist, list)) {
+		cpus = parseCPUList(list);
+	}
+#endif
+	return cpus;
+}
+
+bool ThreadPlacement::applyToCurrentThread(const std::string &threadName) const
+{
+	if (isDefault()) {
+		return true;
+	}
+
+	bool ok = true;
+	std::vector<int> cpus = _cpus;
+	if (cpus.empty() && (_numaNode >= 0)) {
+		cpus = getNUMANodeCPUs(_numaNode);
+		if (cpus.empty()) {
+			MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: NUMA node " << _numaNode << " not found, not pinning the thread.";
+			ok = false;
+		}
+	}
+
+#ifdef _WIN32
+	if (!cpus.empty()) {
+		DWORD_PTR mask = 0;
+		for (int i = 0; i < cpus.size(); i++) {
+			if (cpus[i] < sizeof(DWORD_PTR)*8) {
+				mask |= ((DWORD_PTR)1) << cpus[i];
+			}
+		}
+		if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+			MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: SetThreadAffinityMask failed (" << GetLastError() << ").";
+			ok = false;
+		}
+	}
+	// Windows has no per thread memory policy, so node local memory relies on first touch from the pinned thread
+	if (_threadPriority > 0) {
+		if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+			MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: SetThreadPriority failed (" << GetLastError() << ").";
+			ok = false;
+		}
+	}
+#elif defined(__linux__)
+	if (!cpus.empty()) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int i = 0; i < cpus.size(); i++) {
+			if (cpus[i] < CPU_SETSIZE) {
+				CPU_SET(cpus[i], &set);
+			}
+		}
+		int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (err != 0) {
+			MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: pthread_setaffinity_np failed (errno " << err << ").";
+			ok = false;
+		}
+	}
+	if ((_numaNode >= 0) && (_numaNode < sizeof(unsigned long)*8)) {
+		unsigned long nodeMask = 1UL << _numaNode;
+		if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodeMask, (unsigned long)(sizeof(nodeMask)*8)) != 0) {
+			MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: set_mempolicy failed (errno " << errno << ").";
+			ok = false;
+		}
+	}
+	if (_threadPriority > 0) {
+		struct sched_param param;
+		param.sched_priority = std::min(_threadPriority, sched_get_priority_max(SCHED_FIFO));
+		int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (err != 0) {
+			MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: Cannot use SCHED_FIFO priority " << param.sched_priority
+				<< " (errno " << err << "). Real-time priority needs CAP_SYS_NICE or an rtprio limit.";
+			ok = false;
+		}
+	}
+#else
+	MINVR_LOG_WARNING(Logger::core()) << threadName << " thread: Thread placement is not supported on this platform.";
+	ok = false;
+#endif
+
+	std::stringstream cpuStr;
+	for (int i = 0; i < cpus.size(); i++) {
+		cpuStr << (i ? "," : "") << cpus[i];
+	}
+	MINVR_LOG_INFO(Logger::core()) << threadName << " thread placement: CPUs " << (cpus.empty() ? std::string("any") : cpuStr.str())
+		<< ", NUMA node " << _numaNode << ", priority " << _threadPriority;
+	return ok;
+}
+
+
+ThreadStats::ThreadStats() : _lastCPU(-1), _numSamples(0), _numMigrations(0), _startInvoluntarySwitches(0), _lastInvoluntarySwitches(0)
+{
+}
+
+void ThreadStats::begin()
+{
+	_lastCPU = getCurrentCPU();
+	_numSamples = 0;
+	_numMigrations = 0;
+	_startInvoluntarySwitches = getInvoluntarySwitches();
+	_lastInvoluntarySwitches = _startInvoluntarySwitches;
+}
+
+void ThreadStats::sample()
+{
+	int cpu = getCurrentCPU();
+	if ((cpu != _lastCPU) && (_lastCPU >= 0)) {
+		_numMigrations++;
+	}
+	_lastCPU = cpu;
+	_lastInvoluntarySwitches = getInvoluntarySwitches();
+	_numSamples++;
+}
+
+void ThreadStats::log(const std::string &threadName) const
+{
+	MINVR_LOG_INFO(Logger::core()) << threadName << " thread: " << _numMigrations << " CPU migrations and "
+		<< getNumInvoluntarySwitches() << " involuntary context switches over " << _numSamples << " frames";
+}
+
+int ThreadStats::getCurrentCPU()
+{
+#ifdef _WIN32
+	return (int)GetCurrentProcessorNumber();
+#elif defined(__linux__)
+	return sched_getcpu();
+#else
+	return -1;
+#endif
+}
+
+long ThreadStats::getInvoluntarySwitches()
+{
+#ifdef __linux__
+	struct rusage usage;
+	if (getrusage(RUSAGE_THREAD, &usage) == 0) {
+		return usage.ru_nivcsw;
+	}
+#endif
+	return 0;
+}
+
+} // end namespace
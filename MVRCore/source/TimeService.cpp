@@ -0,0 +1,245 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+#include "MVRCore/TimeService.H"
+#include <boost/chrono.hpp>
+#include <boost/thread/once.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace MinVR {
+
+// Differences that move further than this from the estimate mean the remote clock was set
+#define STEP_THRESHOLD 0.5
+
+// Short windows can suggest any slope, real clocks drift by far less than this
+#define MAX_DRIFT 0.001
+
+// Swap intervals the refresh period is estimated from
+#define MAX_INTERVALS 32
+
+// Weight of the newest frame in the average time from a frame's start to its swap
+#define LATENCY_SMOOTHING 0.1
+
+static boost::once_flag originFlag = BOOST_ONCE_INIT;
+static boost::chrono::steady_clock::time_point steadyOrigin;
+static boost::posix_time::ptime wallOrigin;
+
+static void initOrigin()
+{
+	wallOrigin = boost::posix_time::microsec_clock::local_time();
+	steadyOrigin = boost::chrono::steady_clock::now();
+}
+
+boost::int64_t TimeService::nanoseconds()
+{
+	boost::call_once(originFlag, initOrigin);
+	return boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::steady_clock::now() - steadyOrigin).count();
+}
+
+double TimeService::seconds()
+{
+	return nanoseconds() / 1000000000.0;
+}
+
+boost::posix_time::ptime TimeService::localTime()
+{
+	boost::int64_t elapsed = nanoseconds();
+	return wallOrigin + boost::posix_time::microseconds(elapsed / 1000);
+}
+
+double TimeService::toSeconds(const boost::posix_time::ptime &time)
+{
+	boost::call_once(originFlag, initOrigin);
+	return (time - wallOrigin).total_microseconds() / 1000000.0;
+}
+
+boost::posix_time::ptime TimeService::fromSeconds(double seconds)
+{
+	boost::call_once(originFlag, initOrigin);
+	return wallOrigin + boost::posix_time::microseconds((boost::int64_t)(seconds * 1000000.0));
+}
+
+
+ClockSync::ClockSync(double intervalSeconds, int numIntervals) : _intervalSeconds(intervalSeconds), _numIntervals(std::max(numIntervals, 2)), _numResets(0)
+{
+	reset();
+}
+
+void ClockSync::reset()
+{
+	_intervals.clear();
+	_referenceRemote = 0.0;
+	_offset = 0.0;
+	_drift = 0.0;
+}
+
+void ClockSync::addSample(double remoteSeconds, double localSeconds)
+{
+	double difference = localSeconds - remoteSeconds;
+
+	if (!_intervals.empty()) {
+		double expected = _offset + _drift * (remoteSeconds - _referenceRemote);
+		if (remoteSeconds < _intervals.back().start || std::fabs(difference - expected) > STEP_THRESHOLD) {
+			reset();
+			_numResets++;
+		}
+	}
+
+	if (_intervals.empty() || remoteSeconds >= _intervals.back().start + _intervalSeconds) {
+		Interval interval;
+		interval.start = remoteSeconds;
+		interval.remote = remoteSeconds;
+		interval.difference = difference;
+		_intervals.push_back(interval);
+		while ((int)_intervals.size() > _numIntervals) {
+			_intervals.pop_front();
+		}
+	}
+	else if (difference < _intervals.back().difference) {
+		_intervals.back().remote = remoteSeconds;
+		_intervals.back().difference = difference;
+	}
+	else {
+		return;
+	}
+	fit();
+}
+
+void ClockSync::fit()
+{
+	// The newest interval has seen few samples yet, so its smallest difference is still mostly
+	// delay. It is left out once there are enough complete ones.
+	size_t n = (_intervals.size() > 2) ? _intervals.size() - 1 : _intervals.size();
+
+	// Fit relative to the newest interval used so the offset is the one that applies now
+	_referenceRemote = _intervals[n - 1].remote;
+
+	double meanX = 0.0;
+	double meanY = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		meanX += _intervals[i].remote - _referenceRemote;
+		meanY += _intervals[i].difference;
+	}
+	meanX /= n;
+	meanY /= n;
+
+	double covariance = 0.0;
+	double variance = 0.0;
+	for (size_t i = 0; i < n; i++) {
+		double x = _intervals[i].remote - _referenceRemote - meanX;
+		covariance += x * (_intervals[i].difference - meanY);
+		variance += x * x;
+	}
+
+	if (variance > 0.0) {
+		_drift = std::max(-MAX_DRIFT, std::min(MAX_DRIFT, covariance / variance));
+		_offset = meanY - _drift * meanX;
+	}
+	else {
+		_drift = 0.0;
+		_offset = meanY;
+	}
+}
+
+double ClockSync::toLocal(double remoteSeconds) const
+{
+	if (_intervals.empty()) {
+		return remoteSeconds;
+	}
+	return remoteSeconds + _offset + _drift * (remoteSeconds - _referenceRemote);
+}
+
+double ClockSync::getOffset() const
+{
+	return _offset;
+}
+
+
+DisplayTimePredictor::DisplayTimePredictor(double refreshRate)
+{
+	_configuredPeriod = (refreshRate > 0.0) ? 1.0 / refreshRate : 0.0;
+	_swapInterval = 1;
+	_estimatedPeriod = 0.0;
+	_lastPresent = -1.0;
+	_frameLatency = 0.0;
+}
+
+void DisplayTimePredictor::framePresented(double frameStart, double presentTime)
+{
+	if (_lastPresent >= 0.0) {
+		_intervals.push_back(presentTime - _lastPresent);
+		if (_intervals.size() > MAX_INTERVALS) {
+			_intervals.pop_front();
+		}
+		// The median ignores the occasional missed refresh
+		std::vector<double> sorted(_intervals.begin(), _intervals.end());
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+		_estimatedPeriod = sorted[sorted.size() / 2];
+	}
+
+	double latency = presentTime - frameStart;
+	_frameLatency = (_lastPresent < 0.0) ? latency : _frameLatency + LATENCY_SMOOTHING * (latency - _frameLatency);
+	_lastPresent = presentTime;
+}
+
+double DisplayTimePredictor::getRefreshPeriod() const
+{
+	return (_configuredPeriod > 0.0) ? _configuredPeriod * _swapInterval : _estimatedPeriod;
+}
+
+FrameTiming DisplayTimePredictor::predict(unsigned long frameNumber, double frameStart) const
+{
+	FrameTiming timing;
+	timing.frameNumber = frameNumber;
+	timing.frameStart = frameStart;
+	timing.refreshPeriod = getRefreshPeriod();
+
+	if (_lastPresent < 0.0) {
+		timing.predictedDisplayTime = frameStart;
+		return timing;
+	}
+
+	double expected = frameStart + _frameLatency;
+	if (timing.refreshPeriod > 0.0) {
+		// The average latency already ends on a refresh, so round to the nearest one
+		double refreshes = std::floor((expected - _lastPresent) / timing.refreshPeriod + 0.5);
+		expected = _lastPresent + std::max(refreshes, 1.0) * timing.refreshPeriod;
+	}
+	timing.predictedDisplayTime = std::max(expected, frameStart);
+	return timing;
+}
+
+} // end namespace
@@ -0,0 +1,219 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+// only compile if USE_VRPN is defined!
+#ifdef USE_VRPN
+
+#include "MVRCore/VRPNConnectionRegistry.H"
+#include "MVRCore/Logger.H"
+#include <vrpn_Connection.h>
+#include <boost/chrono.hpp>
+#include <algorithm>
+
+namespace MinVR {
+
+static VRPNConnectionRegistry* common = nullptr;
+static boost::mutex commonMutex;
+
+VRPNSharedConnection::VRPNSharedConnection(const std::string &address, vrpn_Connection *connection) :
+	_address(address), _connection(connection), _pollRound(0), _numMainloops(0), _numSkippedPolls(0), _mainloopSeconds(0.0), _clockSynced(false)
+{
+}
+
+VRPNSharedConnection::~VRPNSharedConnection()
+{
+	if (_connection) {
+		_connection->removeReference();
+	}
+}
+
+vrpn_Connection* VRPNSharedConnection::getConnection()
+{
+	return _connection;
+}
+
+int VRPNSharedConnection::addDevice()
+{
+	// A device that has not polled yet counts as having polled in the current round, so the
+	// first device to poll starts a new round
+	_devicePollRounds.push_back(_pollRound);
+	return (int)_devicePollRounds.size() - 1;
+}
+
+bool VRPNSharedConnection::poll(int deviceSlot)
+{
+	if (_connection == nullptr) {
+		return false;
+	}
+
+	if (_devicePollRounds[deviceSlot] == _pollRound) {
+		_pollRound++;
+		runMainloop(nullptr);
+	}
+	else {
+		_numSkippedPolls++;
+	}
+	_devicePollRounds[deviceSlot] = _pollRound;
+	return true;
+}
+
+bool VRPNSharedConnection::wait(const struct timeval *timeout)
+{
+	if (_connection == nullptr) {
+		return false;
+	}
+	runMainloop(timeout);
+	return true;
+}
+
+void VRPNSharedConnection::runMainloop(const struct timeval *timeout)
+{
+	boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+	_connection->mainloop(timeout);
+	_mainloopSeconds += boost::chrono::duration<double>(boost::chrono::steady_clock::now() - start).count();
+	_numMainloops++;
+}
+
+boost::posix_time::ptime VRPNSharedConnection::stampReport(const struct timeval &msgTime)
+{
+	boost::posix_time::ptime arrival = TimeService::localTime();
+	if (!_clockSynced) {
+		return arrival;
+	}
+
+	double remote = msgTime.tv_sec + msgTime.tv_usec / 1000000.0;
+	double local = TimeService::toSeconds(arrival);
+	_clockSync.addSample(remote, local);
+	return TimeService::fromSeconds(std::min(_clockSync.toLocal(remote), local));
+}
+
+VRPNConnectionStats VRPNSharedConnection::getStats()
+{
+	VRPNConnectionStats stats;
+	stats.address = _address;
+	stats.numDevices = (int)_devicePollRounds.size();
+	stats.connected = (_connection != nullptr) && _connection->connected();
+	stats.numMainloops = _numMainloops;
+	stats.numSkippedPolls = _numSkippedPolls;
+	stats.mainloopSeconds = _mainloopSeconds;
+	stats.clockSynced = _clockSynced;
+	stats.clockOffset = _clockSync.getOffset();
+	stats.clockDrift = _clockSync.getDrift();
+	stats.numClockResets = _clockSync.getNumResets();
+	return stats;
+}
+
+
+VRPNConnectionRegistry& VRPNConnectionRegistry::instance()
+{
+	init();
+	return *common;
+}
+
+void VRPNConnectionRegistry::init()
+{
+	boost::mutex::scoped_lock lock(commonMutex);
+	if (common == nullptr)
+	{
+		common = new VRPNConnectionRegistry();
+	}
+}
+
+void VRPNConnectionRegistry::cleanup()
+{
+	boost::mutex::scoped_lock lock(commonMutex);
+	if (common != nullptr) {
+		delete common;
+		common = nullptr;
+	}
+}
+
+VRPNSharedConnectionRef VRPNConnectionRegistry::getConnection(const std::string &deviceName)
+{
+	return instance()._getConnection(deviceName);
+}
+
+std::vector<VRPNConnectionStats> VRPNConnectionRegistry::getStats()
+{
+	return instance()._getStats();
+}
+
+void VRPNConnectionRegistry::logStats()
+{
+	std::vector<VRPNConnectionStats> stats = getStats();
+	for (int i = 0; i < stats.size(); i++) {
+		MINVR_LOG_INFO(Logger::core()) << "VRPN connection " << stats[i].address << ": " << stats[i].numDevices << " devices, "
+			<< (stats[i].connected ? "connected" : "not connected") << ", " << stats[i].numMainloops << " mainloops ("
+			<< stats[i].mainloopSeconds*1000.0 << " ms), " << stats[i].numSkippedPolls << " device polls shared";
+		if (stats[i].clockSynced) {
+			MINVR_LOG_INFO(Logger::core()) << "VRPN connection " << stats[i].address << ": server clock offset " << stats[i].clockOffset*1000.0 << " ms, drift "
+				<< stats[i].clockDrift*1000000.0 << " ppm, set " << stats[i].numClockResets << " times while running";
+		}
+	}
+}
+
+VRPNSharedConnectionRef VRPNConnectionRegistry::_getConnection(const std::string &deviceName)
+{
+	// VRPN names a device as Device@server, and the server part identifies the connection
+	std::string::size_type at = deviceName.find('@');
+	std::string address = (at == std::string::npos) ? deviceName : deviceName.substr(at + 1);
+
+	boost::mutex::scoped_lock lock(_mutex);
+	std::map<std::string, VRPNSharedConnectionRef>::iterator it = _connections.find(address);
+	if (it != _connections.end()) {
+		return it->second;
+	}
+
+	vrpn_Connection *connection = vrpn_get_connection_by_name(deviceName.c_str());
+	if (connection == nullptr) {
+		MINVR_LOG_WARNING(Logger::core()) << "VRPNConnectionRegistry: Cannot open a connection for " << deviceName << ".";
+	}
+	VRPNSharedConnectionRef shared(new VRPNSharedConnection(address, connection));
+	_connections[address] = shared;
+	return shared;
+}
+
+std::vector<VRPNConnectionStats> VRPNConnectionRegistry::_getStats()
+{
+	boost::mutex::scoped_lock lock(_mutex);
+	std::vector<VRPNConnectionStats> stats;
+	for (std::map<std::string, VRPNSharedConnectionRef>::iterator it = _connections.begin(); it != _connections.end(); ++it) {
+		stats.push_back(it->second->getStats());
+	}
+	return stats;
+}
+
+} // end namespace
+
+#endif // USE_VRPN
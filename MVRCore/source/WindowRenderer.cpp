@@ -0,0 +1,474 @@
+//========================================================================
+// MinVR
+// Platform:    Any
+// API version: 1.0
+//------------------------------------------------------------------------
+// Copyright (c) 2013 Regents of the University of Minnesota
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+//
+// * Redistributions of source code must retain the above copyright notice, this
+//   list of conditions and the following disclaimer.
+//
+// * Redistributions in binary form must reproduce the above copyright notice, this
+//   list of conditions and the following disclaimer in the documentation and/or
+//   other materials provided with the distribution.
+//
+// * Neither the name of the University of Minnesota, nor the names of its
+//   contributors may be used to endorse or promote products derived from
+//   this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+// ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+// WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+// ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+// (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+// LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+// ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+// SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//========================================================================
+
+/**
+ * \file  WindowRenderer.cpp
+ * \brief Draws the frames of one window on whichever thread has its context current
+ *
+ */
+
+#include "MVRCore/WindowRenderer.H"
+#include "MVRCore/AbstractMVREngine.H"
+#include "MVRCore/SharedResourceCache.H"
+#include "MVRCore/TimeService.H"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace MinVR {
+
+WindowRenderer::WindowRenderer(WindowRef window, int threadId, AbstractMVREngine* engine, const std::vector<WindowRef> &workerWindows) :
+	_window(window), _threadId(threadId), _engine(engine), _frameRequested(false), _swapping(false), _swapWaitNanoseconds(0),
+	_stereoProgram(0), _vertexBuffer(0), _indexBuffer(0)
+{
+	WindowSettingsRef settings = window->getSettings();
+	if (!workerWindows.empty() && settings->reprojection) {
+		_reprojector.reset(new ReprojectionRenderer(window, workerWindows[0], settings->reprojectionDeadline / 1000.0));
+	}
+	else if (!workerWindows.empty()) {
+		_splitter.reset(new SplitRenderer(window, workerWindows, SplitRenderer::parseMode(settings->splitMode)));
+	}
+}
+
+void WindowRenderer::initializeContext()
+{
+	StartupProfilerRef profiler = _engine->getStartupProfiler();
+	std::string windowStr = "(" + getName() + ")";
+	WindowSettingsRef settings = _window->getSettings();
+
+	profiler->beginPhase("Extension init " + windowStr);
+	GLExtensions::init();
+	profiler->endPhase("Extension init " + windowStr);
+
+	if (settings->swapInterval != WindowSettings::SWAPINTERVAL_DEFAULT && !_window->setSwapInterval(settings->swapInterval)) {
+		MINVR_LOG_WARNING(Logger::core()) << getName() << ": the app kit cannot set the swap interval, keeping the driver's.";
+	}
+
+	profiler->beginPhase("Stereo buffers and shader build " + windowStr);
+	initStereoCompositeQuad();
+	initStereoCompositeShader();
+	setShaderVariables();
+	buildRenderGraph();
+	profiler->endPhase("Stereo buffers and shader build " + windowStr);
+
+	FrameSinkRef captureSink = FrameCapture::createSink(_threadId, settings);
+	if (captureSink) {
+		if (PixelReadbackRing::isSupported()) {
+			_capture.reset(new FrameCapture(_threadId, settings, captureSink, _engine->getCaptureWriterPool()));
+		}
+		else {
+			MINVR_LOG_WARNING(Logger::core()) << getName() << ": the context has no pixel buffer objects or fences, frames will not be captured.";
+		}
+	}
+
+	if (settings->gpuTiming) {
+		if (GPUTimer::isSupported()) {
+			_gpuTimer.reset(new GPUTimer());
+			_window->setGPUTimer(_gpuTimer);
+		}
+		else {
+			MINVR_LOG_WARNING(Logger::core()) << getName() << ": the context has no timestamp queries, frames will not be timed on the GPU.";
+		}
+	}
+
+	GLenum err;
+	if((err = glGetError()) != GL_NO_ERROR) {
+		std::cout << "openGL ERROR before init context specific: "<<err<<std::endl;
+	}
+
+	profiler->beginPhase("Engine initializeContextSpecificVars " + windowStr);
+	_engine->initializeContextSpecificVars(_threadId, _window);
+	profiler->endPhase("Engine initializeContextSpecificVars " + windowStr);
+}
+
+void WindowRenderer::initializeApp(AbstractMVRAppRef app)
+{
+	_resourceCache = _window->getResourceCache();
+	if (_resourceCache) {
+		_resourceCache->addContext();
+	}
+
+	StartupProfilerRef profiler = _engine->getStartupProfiler();
+	std::string windowStr = "(" + getName() + ")";
+	profiler->beginPhase("App initializeContextSpecificVars " + windowStr);
+	app->initializeContextSpecificVars(_threadId, _window);
+	profiler->endPhase("App initializeContextSpecificVars " + windowStr);
+
+	if (_splitter) {
+		profiler->beginPhase("Split workers init " + windowStr);
+		_splitter->initialize(app);
+		profiler->endPhase("Split workers init " + windowStr);
+	}
+	if (_reprojector) {
+		profiler->beginPhase("Reprojection worker init " + windowStr);
+		_reprojector->initialize(app);
+		profiler->endPhase("Reprojection worker init " + windowStr);
+	}
+
+	// The app's passes go after the engine's, then the targets between them get their framebuffers
+	app->setupRenderGraph(_threadId, _window, _renderGraph);
+	_renderGraph->compile();
+	_renderGraph->logGraph(getName());
+
+	GLenum err;
+	if((err = glGetError()) != GL_NO_ERROR) {
+		std::cout << "openGL ERROR in start of render(): "<<err<<std::endl;
+	}
+}
+
+void WindowRenderer::draw(AbstractMVRAppRef app)
+{
+	if (_gpuTimer) {
+		_gpuTimer->beginFrame();
+		_gpuTimer->beginSection("Frame");
+	}
+
+	_renderGraph->execute(app, _gpuTimer);
+
+	// Start reading back the finished frame before waiting for the other windows, so the copy overlaps the wait
+	if (_capture) {
+		beginGPUSection("Capture readback");
+		_capture->captureFrame(_window->getWidth(), _window->getHeight());
+		endGPUSection();
+	}
+	if (_gpuTimer) {
+		_gpuTimer->endFrame();
+	}
+
+	LatencyTracerRef tracer = _engine->getLatencyTracer();
+	if (tracer) {
+		tracer->record(_frameTrace, LatencyTracer::STAGE_DRAW, getName());
+	}
+}
+
+void WindowRenderer::beginGPUSection(const char* name)
+{
+	if (_gpuTimer) {
+		_gpuTimer->beginSection(name);
+	}
+}
+
+void WindowRenderer::swap()
+{
+	boost::int64_t swapStart = TimeService::nanoseconds();
+	_window->swapBuffers();
+	_swapWaitNanoseconds = TimeService::nanoseconds() - swapStart;
+
+	LatencyTracerRef tracer = _engine->getLatencyTracer();
+	if (tracer) {
+		tracer->record(_frameTrace, LatencyTracer::STAGE_SWAP, getName());
+	}
+}
+
+void WindowRenderer::finish()
+{
+	if (_splitter) {
+		_splitter->finish(getName());
+	}
+	if (_reprojector) {
+		_reprojector->finish(getName());
+	}
+	if (_capture) {
+		_capture->finish();
+		_capture->logStats(getName());
+	}
+	if (_gpuTimer) {
+		_gpuTimer->logStats(getName());
+		_gpuTimer->releaseGLObjects();
+	}
+	_renderGraph->releaseGLObjects();
+	// The last context of a share group deletes the shared objects while it is still current
+	if (_resourceCache) {
+		_resourceCache->removeContext();
+		_resourceCache.reset();
+	}
+}
+
+bool WindowRenderer::takeFrameRequest()
+{
+	bool requested = _frameRequested;
+	_frameRequested = false;
+	if (requested) {
+		_frameTrace = _requestedTrace;
+		_requestedTrace.reset();
+	}
+	return requested;
+}
+
+void WindowRenderer::initStereoCompositeShader()
+{
+	// Only bother if we actually need the shader
+	if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
+		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
+		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS) {
+
+		std::string programName = "stereo-" + StereoShaders::getModeName(_window->getSettings()->stereoType);
+		const char* vs = StereoShaders::getVertexShader();
+		const char* fs = StereoShaders::getFragmentShader(_window->getSettings()->stereoType);
+
+		// Try to reuse a binary linked by another context on the same driver or by a previous run
+		bool useBinaryCache = programBinarySupported();
+		std::string cacheKey = "";
+		if (useBinaryCache) {
+			std::string driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+			cacheKey = ShaderProgramCache::makeKey(driver, programName, vs, fs);
+
+			unsigned int binaryFormat;
+			std::vector<char> binary;
+			if (ShaderProgramCache::findBinary(cacheKey, binaryFormat, binary)) {
+				_stereoProgram = glCreateProgram();
+				glProgramBinary(_stereoProgram, binaryFormat, &binary[0], (GLsizei)binary.size());
+				if (checkProgramLinked(_stereoProgram, programName, false)) {
+					return;
+				}
+
+				// The driver rejected the binary, so rebuild from source and replace it
+				glDeleteProgram(_stereoProgram);
+				ShaderProgramCache::invalidateBinary(cacheKey);
+				if (ShaderProgramCache::findBinary(cacheKey, binaryFormat, binary)) {
+					_stereoProgram = glCreateProgram();
+					glProgramBinary(_stereoProgram, binaryFormat, &binary[0], (GLsizei)binary.size());
+					if (checkProgramLinked(_stereoProgram, programName, false)) {
+						return;
+					}
+					glDeleteProgram(_stereoProgram);
+					useBinaryCache = false;
+				}
+			}
+		}
+
+		GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vs, "stereo.vert");
+		GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fs, programName + ".frag");
+	
+		_stereoProgram = glCreateProgram();
+		if (useBinaryCache) {
+			glProgramParameteri(_stereoProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
+		
+		glAttachShader(_stereoProgram,vertexShader);
+		glAttachShader(_stereoProgram,fragmentShader);
+	
+		glLinkProgram(_stereoProgram);
+
+		bool linked = checkProgramLinked(_stereoProgram, programName, true);
+
+		glDetachShader(_stereoProgram, vertexShader);
+		glDetachShader(_stereoProgram, fragmentShader);
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+
+		if (useBinaryCache) {
+			GLint binaryLength = 0;
+			if (linked) {
+				glGetProgramiv(_stereoProgram, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+			}
+			if (binaryLength > 0) {
+				std::vector<char> binary(binaryLength);
+				GLenum binaryFormat = 0;
+				GLsizei written = 0;
+				glGetProgramBinary(_stereoProgram, binaryLength, &written, &binaryFormat, &binary[0]);
+				binary.resize(written);
+				ShaderProgramCache::storeBinary(cacheKey, binaryFormat, binary);
+			}
+			else {
+				ShaderProgramCache::abandonBinary(cacheKey);
+			}
+		}
+
+		BOOST_ASSERT_MSG(linked, "Unable to link the stereo composite shader in WindowRenderer.cpp.");
+	}
+}
+
+GLuint WindowRenderer::compileShader(GLenum type, const char* source, const std::string &name)
+{
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &source, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		GLint logLength = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength > 1 ? logLength : 1, '\0');
+		glGetShaderInfoLog(shader, (GLsizei)log.size(), NULL, &log[0]);
+		std::cout << "Error compiling shader " << name << ":" << std::endl << &log[0] << std::endl;
+		BOOST_ASSERT_MSG(false, "Unable to compile the stereo composite shader in WindowRenderer.cpp.");
+	}
+	return shader;
+}
+
+bool WindowRenderer::checkProgramLinked(GLuint program, const std::string &name, bool printLog)
+{
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE && printLog) {
+		GLint logLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		std::vector<char> log(logLength > 1 ? logLength : 1, '\0');
+		glGetProgramInfoLog(program, (GLsizei)log.size(), NULL, &log[0]);
+		std::cout << "Error linking shader program " << name << ":" << std::endl << &log[0] << std::endl;
+	}
+	return status == GL_TRUE;
+}
+
+bool WindowRenderer::programBinarySupported()
+{
+#ifdef _WIN32
+	if (!pglGetProgramBinary || !pglProgramBinary || !pglProgramParameteri) {
+		return false;
+	}
+#endif
+
+	int major = 0;
+	int minor = 0;
+	const char* version = (const char*)glGetString(GL_VERSION);
+	if (version == NULL || sscanf(version, "%d.%d", &major, &minor) != 2) {
+		return false;
+	}
+	bool supported = (major > 4) || (major == 4 && minor >= 1);
+	if (!supported) {
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		supported = (extensions != NULL) && (strstr(extensions, "GL_ARB_get_program_binary") != NULL);
+	}
+
+	// Drivers may expose the entry points without supporting any binary formats
+	GLint numFormats = 0;
+	if (supported) {
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	}
+	return numFormats > 0;
+}
+
+void WindowRenderer::initStereoCompositeQuad() {
+	// Only bother if we actually need the quad for stereo
+	if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
+		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
+		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS) {
+
+		//Setup fullscreen quad vbo
+		_fullscreenVertices[0] = -1.0;
+		_fullscreenVertices[1] = -1.0;
+		_fullscreenVertices[2] = 1.0;
+		_fullscreenVertices[3] = -1.0;
+		_fullscreenVertices[4] = 1.0;
+		_fullscreenVertices[5] = 1.0;
+		_fullscreenVertices[6] = -1.0;
+		_fullscreenVertices[7] =  1.0;
+		_fullscreenIndices[0] = 0;
+		_fullscreenIndices[1] = 1;
+		_fullscreenIndices[2] = 2;
+		_fullscreenIndices[3] = 3;
+
+		//Create VBO
+		glGenBuffers( 1, &_vertexBuffer );
+		glBindBuffer( GL_ARRAY_BUFFER, _vertexBuffer );
+		glBufferData( GL_ARRAY_BUFFER, 8 * sizeof(GLfloat), _fullscreenVertices, GL_STATIC_DRAW );
+
+		//Create IBO
+		glGenBuffers( 1, &_indexBuffer );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, _indexBuffer );
+		glBufferData( GL_ELEMENT_ARRAY_BUFFER, 4 * sizeof(GLuint), _fullscreenIndices, GL_STATIC_DRAW );
+	}
+}
+
+void WindowRenderer::buildRenderGraph()
+{
+	_renderGraph.reset(new RenderGraph(_threadId, _window));
+	WindowSettingsRef settings = _window->getSettings();
+	std::vector<int> none;
+
+	// Drawn by the worker context, or re-projected if it missed the deadline
+	if (_reprojector) {
+		_renderGraph->addPass(RenderPassRef(new ReprojectionPass(_reprojector)), none, RenderGraph::OUTPUT_BACK, false);
+	}
+
+	// Split across the worker contexts
+	else if (_splitter) {
+		_renderGraph->addPass(RenderPassRef(new SplitCompositePass(_splitter)), none, RenderGraph::OUTPUT_BACK, false);
+	}
+
+	// Monoscopic
+	else if (settings->stereoType == WindowSettings::STEREOTYPE_MONO || settings->stereo == false) {
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Scene", ScenePass::EYE_MONO, ScenePass::LAYOUT_FULL, true)), none, RenderGraph::OUTPUT_BACK);
+	}
+
+	// Quad Buffered Stereo
+	else if (settings->stereoType == WindowSettings::STEREOTYPE_QUADBUFFERED) {
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Left eye", ScenePass::EYE_LEFT, ScenePass::LAYOUT_FULL, true)), none, RenderGraph::OUTPUT_BACK_LEFT);
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Right eye", ScenePass::EYE_RIGHT, ScenePass::LAYOUT_FULL, true)), none, RenderGraph::OUTPUT_BACK_RIGHT);
+	}
+
+	// Side by Side Stereo Images, Left Eye on the left half of the screen and Right Eye on the right
+	else if (settings->stereoType == WindowSettings::STEREOTYPE_SIDEBYSIDE) {
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Left eye", ScenePass::EYE_LEFT, ScenePass::LAYOUT_LEFT_HALF, true)), none, RenderGraph::OUTPUT_BACK);
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Right eye", ScenePass::EYE_RIGHT, ScenePass::LAYOUT_RIGHT_HALF, false)), none, RenderGraph::OUTPUT_BACK);
+	}
+
+	// Draw each eye into a target and interleave them with the checkerboard or interlaced shader
+	else {
+		int leftEye = _renderGraph->createTarget("Left eye");
+		int rightEye = _renderGraph->createTarget("Right eye");
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Left eye", ScenePass::EYE_LEFT, ScenePass::LAYOUT_FULL, true)), none, leftEye);
+		_renderGraph->addPass(RenderPassRef(new ScenePass("Right eye", ScenePass::EYE_RIGHT, ScenePass::LAYOUT_FULL, true)), none, rightEye);
+		std::vector<int> eyes;
+		eyes.push_back(leftEye);
+		eyes.push_back(rightEye);
+		_renderGraph->addPass(RenderPassRef(new StereoCompositePass(_stereoProgram, _vertexBuffer, _indexBuffer)), eyes, RenderGraph::OUTPUT_BACK);
+	}
+}
+
+void WindowRenderer::setShaderVariables()
+{
+	// Only bother if we actually need the textures and fbo for stereo
+	if (_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_CHECKERBOARD ||
+		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDCOLUMNS ||
+		_window->getSettings()->stereoType == WindowSettings::STEREOTYPE_INTERLACEDROWS)
+	{
+		glUseProgram(_stereoProgram);
+
+		GLint screenSizeLoc = glGetUniformLocation(_stereoProgram, "screenSize");
+		glUniform2f(screenSizeLoc, (GLfloat)_window->getWidth(), (GLfloat)_window->getHeight());
+
+		GLuint leftEyeTexLoc  = glGetUniformLocation(_stereoProgram, "leftEyeTexture");
+		GLuint rightEyeTexLoc = glGetUniformLocation(_stereoProgram, "rightEyeTexture");
+		glUniform1i(leftEyeTexLoc, 0);
+		glUniform1i(rightEyeTexLoc, 1);
+
+		glUseProgram(0);
+	}
+}
+
+} // end namespace
@@ -31,6 +31,12 @@ if (USE_APPKIT_G3D9)
         set(MVRCONFIG_DEPENDENCIES "${MVRCONFIG_DEPENDENCIES}set(minvr_AppKit_G3D9_dep G3D9)\n")
 endif(USE_APPKIT_G3D9)
 
+if (USE_APPKIT_EGL)
+	set(MVRCONFIG_AVAILABLE_COMPONENTS "${MVRCONFIG_AVAILABLE_COMPONENTS} AppKit_EGL")
+	set(MVRCONFIG_AVAILABLE_COMPONENTS_LIST "${MVRCONFIG_AVAILABLE_COMPONENTS_LIST}\n# - AppKit_EGL")
+	set(MVRCONFIG_DEPENDENCIES "${MVRCONFIG_DEPENDENCIES}set(minvr_AppKit_EGL_dep EGL)\n")
+endif(USE_APPKIT_EGL)
+
 if (USE_APPKIT_GLUT)
 	message("Appkit glut not implemented yet")
 endif(USE_APPKIT_GLUT)